@@ -0,0 +1,162 @@
+// Microbenchmark: CSV trace row formatting (ostream vs snprintf vs TraceRowEncoder)
+//
+// Build and run from the project root with "make benchmark". Needs no
+// OMNeT++; rows are synthetic but use the value ranges of real EV rows.
+
+#include "veins_inet/VeinsInetTraceRowEncoder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace veins;
+
+namespace {
+
+const size_t NUM_ROWS = 4096;
+const int NUM_PASSES = 100;
+
+std::vector<TraceRecord> makeRows()
+{
+    std::mt19937_64 rng(42);
+    std::uniform_real_distribution<double> unit(0, 1);
+    std::vector<TraceRecord> rows(NUM_ROWS);
+    for (size_t i = 0; i < rows.size(); i++) {
+        TraceRecord& r = rows[i];
+        memset(&r, 0, sizeof(r));
+        r.kind = TraceRecord::ROW;
+        r.flags = TRACE_HAS_SOC;
+        r.timestamp = i * 0.0137;
+        TraceRecord::copy(r.eventType, i % 3 ? "RECEIVED" : "SENT");
+        r.nodeId = i % 200;
+        TraceRecord::copy(r.nodeType, "ev");
+        TraceRecord::copy(r.commType, i % 5 ? "BSM" : "EV2CS");
+        r.packetSize = 200 + i % 1300;
+        r.interArrivalTime = unit(rng);
+        r.battery = 60000 * unit(rng);
+        r.energy = 100 * unit(rng);
+        TraceRecord::copy(r.srcAddress, "10.0.0.17");
+        TraceRecord::copy(r.tgtAddress, "broadcast");
+        r.isAttacker = i % 7 == 0;
+        r.isCharging = 0;
+        r.sequenceNumber = i;
+        TraceRecord::copy(r.packetName, ("BSM-" + std::to_string(i)).c_str());
+        r.posX = 13640 * unit(rng);
+        r.posY = 11500 * unit(rng);
+        r.speed = 40 * unit(rng);
+        r.txDuration = r.packetSize * 8.0 / 6e6;
+        r.packetsSent = i;
+        r.packetsReceived = 3 * i;
+        r.soc = unit(rng);
+    }
+    return rows;
+}
+
+// Before: the apps' original per-row ostream formatting
+void formatOstream(const TraceRecord& r, std::ostringstream& out)
+{
+    out << std::fixed << std::setprecision(6)
+        << r.timestamp << "," << r.eventType << "," << r.nodeId << "," << r.nodeType << ","
+        << r.commType << "," << r.packetSize << "," << r.interArrivalTime << "," << r.battery << ","
+        << r.energy << "," << r.srcAddress << "," << r.tgtAddress << "," << (r.isAttacker ? "1" : "0") << ","
+        << r.isCharging << "," << r.sequenceNumber << "," << r.packetName << "," << r.posX << ","
+        << r.posY << "," << r.speed << "," << r.txDuration << "," << r.packetsSent << ","
+        << r.packetsReceived << "," << r.soc << "\n";
+}
+
+// Before: snprintf formatting of the first trace writer thread
+void formatSnprintf(const TraceRecord& r, std::string& out)
+{
+    char line[512];
+    int n = snprintf(line, sizeof(line), "%.6f,%s,%d,%s,%s,%d,%.6f,%.6f,%.6f,%s,%s,%s,%d,%d,%s,%.6f,%.6f,%.6f,%.6f,%d,%d,%.6f\n",
+                     r.timestamp, r.eventType, r.nodeId, r.nodeType, r.commType, r.packetSize,
+                     r.interArrivalTime, r.battery, r.energy, r.srcAddress, r.tgtAddress,
+                     r.isAttacker ? "1" : "0", r.isCharging, r.sequenceNumber, r.packetName,
+                     r.posX, r.posY, r.speed, r.txDuration, r.packetsSent, r.packetsReceived, r.soc);
+    out.append(line, n);
+}
+
+template <typename F>
+double rowsPerSecond(F formatPass, size_t& bytes)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < NUM_PASSES; pass++) bytes += formatPass();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return NUM_ROWS * NUM_PASSES / elapsed.count();
+}
+
+bool checkFixed6()
+{
+    // Fast path must match printf, including ties, signs and large values
+    std::mt19937_64 rng(7);
+    std::vector<double> values = {0.0, -0.0, 0.5, 0.0000005, 0.0078125, -0.0078125, 1e-7, -1e-7, 0.9999995,
+                                  123456.7890125, 8999999999.999999, 9e9, 1e15, -1e300, NAN, INFINITY};
+    for (int i = 0; i < 2000000; i++) {
+        uint64_t bits = rng();
+        double scale = std::pow(10.0, (int) (bits % 14) - 6);
+        values.push_back((double) (int64_t) (bits >> 11) / (double) (1ull << 53) * scale * (bits & 1 ? -1 : 1));
+    }
+    for (int i = 0; i < 200000; i++) values.push_back((double) (rng() % 100000000) / 1e6 + 5e-7);
+    char expected[512], actual[TraceRowEncoder::MAX_ROW_SIZE];
+    for (double v : values) {
+        snprintf(expected, sizeof(expected), "%.6f", v);
+        *TraceRowEncoder::putFixed6(actual, v) = '\0';
+        if (strcmp(expected, actual) != 0) {
+            printf("MISMATCH for %.17g: printf \"%s\", encoder \"%s\"\n", v, expected, actual);
+            return false;
+        }
+    }
+    printf("putFixed6 matches printf(\"%%.6f\") on %zu values\n", values.size());
+    return true;
+}
+
+} // namespace
+
+int main()
+{
+    if (!checkFixed6()) return 1;
+
+    std::vector<TraceRecord> rows = makeRows();
+
+    std::ostringstream stream;
+    std::string text;
+    char line[TraceRowEncoder::MAX_ROW_SIZE];
+
+    // Output of the snprintf and encoder paths must be identical
+    std::string encoded;
+    for (auto& r : rows) formatSnprintf(r, text);
+    for (auto& r : rows) encoded.append(line, TraceRowEncoder::encode(r, TRACE_SCHEMA_SOC, line));
+    if (encoded != text) {
+        printf("MISMATCH between snprintf and TraceRowEncoder rows\n");
+        return 1;
+    }
+
+    size_t bytes = 0;
+    double ostreamRate = rowsPerSecond([&] {
+        stream.str(std::string());
+        for (auto& r : rows) formatOstream(r, stream);
+        return (size_t) stream.tellp();
+    }, bytes);
+    double snprintfRate = rowsPerSecond([&] {
+        text.clear();
+        for (auto& r : rows) formatSnprintf(r, text);
+        return text.size();
+    }, bytes);
+    double encoderRate = rowsPerSecond([&] {
+        text.clear();
+        for (auto& r : rows) text.append(line, TraceRowEncoder::encode(r, TRACE_SCHEMA_SOC, line));
+        return text.size();
+    }, bytes);
+
+    printf("%-16s %12s %9s\n", "formatter", "rows/s", "speedup");
+    printf("%-16s %12.0f %8.2fx\n", "ostream", ostreamRate, 1.0);
+    printf("%-16s %12.0f %8.2fx\n", "snprintf", snprintfRate, snprintfRate / ostreamRate);
+    printf("%-16s %12.0f %8.2fx\n", "TraceRowEncoder", encoderRate, encoderRate / ostreamRate);
+    printf("(%zu bytes formatted)\n", bytes);
+    return 0;
+}
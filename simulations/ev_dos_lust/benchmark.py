@@ -0,0 +1,196 @@
+#!/usr/bin/env python3
+"""Scaling benchmark: run configs under Cmdenv and report speed and memory per run.
+
+Runs every run of the given configs (default: Bench_Scaling, the synthetic
+toy grid swept over vehicle count, attacker count and attack packet
+interval; no SUMO needed) one at a time, so timings do not disturb each
+other, and measures for each run:
+
+  wall_time_s            wall-clock time of the process
+  sim_time_s             simulated time reached
+  sim_sec_per_wall_sec   sim_time_s / wall_time_s
+  events                 events executed (from Cmdenv's final message)
+  events_per_sec         events / wall_time_s
+  peak_rss_kb            peak resident set size of the process (POSIX only)
+  trace_bytes            bytes of trace files written to the result dir
+  module_events          per module group (e.g. "ev[*].app[0]"): number of
+                         modules and sum of their eventsHandled scalars
+
+The report goes to results/benchmarks/<name>/report.json (all fields,
+iteration variables included) and report.csv (one flat row per run).
+With --baseline, events/sec is compared per config and iteration
+variables against an earlier report.json, and the script exits with 1 if
+any run got slower by more than --tolerance.
+
+Usage (from this directory, after building ../../src):
+  ./benchmark.py
+  ./benchmark.py --runs 0..2 --baseline results/benchmarks/main/report.json
+  ./benchmark.py -c EVtoEV_DoS_HighDensity --runs 0    # LuST sizing; needs sumo-launchd
+"""
+
+import argparse
+import csv
+import json
+import os
+import re
+import subprocess
+import sys
+import time
+
+import runfarm
+
+HERE = runfarm.HERE
+NOT_TRACES = (".sca", ".vec", ".vci", ".elog", ".log")
+FINAL_MESSAGE = re.compile(r"at t=([0-9.eE+-]+)s?, event #(\d+)")
+
+
+def run_process(cmd, log_path):
+    """Run cmd; returns exit code, wall time and peak RSS in KiB (None where unavailable)."""
+    with open(log_path, "w") as log:
+        start = time.time()
+        process = subprocess.Popen(cmd, cwd=HERE, stdout=log, stderr=subprocess.STDOUT)
+        if hasattr(os, "wait4"):
+            # Resource usage of exactly this child, not of all children so far
+            _, status, usage = os.wait4(process.pid, 0)
+            process.returncode = os.waitstatus_to_exitcode(status) if hasattr(os, "waitstatus_to_exitcode") else status >> 8
+            rss = usage.ru_maxrss // 1024 if sys.platform == "darwin" else usage.ru_maxrss
+        else:
+            process.wait()
+            rss = None
+        return process.returncode, time.time() - start, rss
+
+
+def read_itervars(path):
+    """Iteration variables of a .sca file (OMNeT++ 5 "attr iterationvars" or 6 "itervar" lines)."""
+    itervars = {}
+    with open(path) as f:
+        for line in f:
+            if line.startswith("itervar "):
+                _, name, value = line.rstrip("\n").split(" ", 2)
+                itervars[name] = value.strip('"')
+            elif line.startswith("attr iterationvars "):
+                for name, value in re.findall(r"\$(\w+)=([^,\"]*)", line):
+                    itervars[name] = value.strip()
+            elif line.startswith(("scalar ", "statistic ", "vector ")):
+                break
+    return itervars
+
+
+def module_group(module):
+    # ev[17].app[0] -> ev[*].app[0]; the network name in front is dropped
+    module = module.split(".", 1)[1] if "." in module else module
+    return re.sub(r"\[\d+\]", "[*]", module, count=1)
+
+
+def measure(exe, ini, config, run, result_dir):
+    os.makedirs(result_dir, exist_ok=True)
+    log_path = os.path.join(result_dir, "run.log")
+    cmd = runfarm.omnet_command(exe, ini, config, "-r", str(run), "--result-dir=" + result_dir, "--cmdenv-express-mode=true")
+    code, wall, rss = run_process(cmd, log_path)
+
+    sim_time, events = None, None
+    with open(log_path, errors="replace") as log:
+        for match in FINAL_MESSAGE.finditer(log.read()):
+            sim_time, events = float(match.group(1)), int(match.group(2))
+
+    itervars, module_events, trace_bytes = {}, {}, 0
+    for name in sorted(os.listdir(result_dir)):
+        path = os.path.join(result_dir, name)
+        if name.endswith(".sca"):
+            itervars.update(read_itervars(path))
+            for module, scalar, value in runfarm.read_scalars(path):
+                if scalar == "eventsHandled":
+                    group = module_events.setdefault(module_group(module), {"modules": 0, "events": 0})
+                    group["modules"] += 1
+                    group["events"] += int(float(value))
+        elif os.path.isfile(path) and not name.endswith(NOT_TRACES):
+            trace_bytes += os.path.getsize(path)
+
+    return {
+        "config": config,
+        "run": run,
+        "itervars": itervars,
+        "exit_code": code,
+        "wall_time_s": round(wall, 3),
+        "sim_time_s": sim_time,
+        "sim_sec_per_wall_sec": round(sim_time / wall, 4) if sim_time is not None and wall > 0 else None,
+        "events": events,
+        "events_per_sec": round(events / wall, 1) if events is not None and wall > 0 else None,
+        "peak_rss_kb": rss,
+        "trace_bytes": trace_bytes,
+        "module_events": module_events,
+        "result_dir": os.path.relpath(result_dir, HERE),
+    }
+
+
+def run_key(result):
+    return result["config"], json.dumps(result["itervars"], sort_keys=True)
+
+
+def write_report(report_dir, results):
+    with open(os.path.join(report_dir, "report.json"), "w") as f:
+        json.dump({"created": time.strftime("%Y-%m-%dT%H:%M:%S"), "runs": results}, f, indent=2)
+
+    itervar_names = sorted({name for r in results for name in r["itervars"]})
+    group_names = sorted({group for r in results for group in r["module_events"]})
+    fields = ["config", "run"] + itervar_names + ["exit_code", "wall_time_s", "sim_time_s", "sim_sec_per_wall_sec",
+                                                  "events", "events_per_sec", "peak_rss_kb", "trace_bytes"]
+    with open(os.path.join(report_dir, "report.csv"), "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(fields + ["events:" + group for group in group_names])
+        for r in results:
+            row = [r["config"], r["run"]] + [r["itervars"].get(name, "") for name in itervar_names]
+            row += [r[field] if r[field] is not None else "" for field in fields[2 + len(itervar_names):]]
+            row += [r["module_events"].get(group, {}).get("events", "") for group in group_names]
+            writer.writerow(row)
+
+
+def compare(results, baseline_path, tolerance):
+    """Print the events/sec change per run against the baseline; returns the number of regressions."""
+    with open(baseline_path) as f:
+        baseline = {run_key(r): r for r in json.load(f)["runs"]}
+    regressions = 0
+    for r in results:
+        old = baseline.get(run_key(r))
+        if not old or not old.get("events_per_sec") or not r["events_per_sec"]:
+            continue
+        change = r["events_per_sec"] / old["events_per_sec"] - 1
+        slower = change < -tolerance
+        regressions += slower
+        print("  %s #%d %s: %.0f -> %.0f events/s (%+.1f%%)%s" % (r["config"], r["run"], r["itervars"], old["events_per_sec"],
+                                                               r["events_per_sec"], 100 * change, "  REGRESSION" if slower else ""))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-c", "--config", action="append", help="config to run (repeatable); default: Bench_Scaling")
+    parser.add_argument("-f", "--ini", default="omnetpp.ini", help="ini file (default: omnetpp.ini)")
+    parser.add_argument("--runs", help="run numbers per config, e.g. 0..4 or 0,2 (default: all)")
+    parser.add_argument("--name", default=time.strftime("bench-%Y%m%d-%H%M%S"), help="report name (directory under results/benchmarks)")
+    parser.add_argument("--baseline", help="report.json of an earlier benchmark to compare events/sec against")
+    parser.add_argument("--tolerance", type=float, default=0.1, help="allowed events/sec slowdown against the baseline (default: 0.1 = 10%%)")
+    args = parser.parse_args()
+
+    exe = runfarm.find_executable()
+    report_dir = os.path.join(HERE, "results", "benchmarks", args.name)
+    results = []
+    for config in args.config or ["Bench_Scaling"]:
+        for run in runfarm.parse_runs(args.runs, runfarm.count_runs(exe, args.ini, config)):
+            r = measure(exe, args.ini, config, run, os.path.join(report_dir, config, str(run)))
+            results.append(r)
+            print("%s #%d %s: %s, %.1fs wall, %s sim s/s, %s events/s, %s KiB peak RSS" % (
+                config, run, r["itervars"], "ok" if r["exit_code"] == 0 else "FAILED (exit %d)" % r["exit_code"],
+                r["wall_time_s"], r["sim_sec_per_wall_sec"], r["events_per_sec"], r["peak_rss_kb"]))
+
+    write_report(report_dir, results)
+    print("benchmark: report in %s" % os.path.relpath(report_dir, HERE))
+    failed = sum(1 for r in results if r["exit_code"] != 0)
+    regressions = compare(results, args.baseline, args.tolerance) if args.baseline else 0
+    if regressions:
+        print("benchmark: %d run(s) slower than the baseline by more than %.0f%%" % (regressions, 100 * args.tolerance))
+    return 1 if failed or regressions else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,248 @@
+#!/usr/bin/env python3
+"""Run a sweep of ev_dos_lust configs/repetitions in parallel.
+
+Every run uses VeinsInetManagerForker, which starts its own SUMO as a
+child process on a TraCI port that no other run of the sweep uses, so
+runs need no shared sumo-launchd and no fixed port 9999. At most --jobs
+runs (default: number of cores) are active at a time.
+
+Each run writes to <sweep>/<config>/<run>/ (result-dir: .sca/.vec, CSV
+traces, OMNeT++ and SUMO logs). When all runs are done the sweep is
+merged into a result set:
+
+  <sweep>/runs.csv        one row per run: config, run, port, exit code,
+                          wall time, result dir
+  <sweep>/scalars.csv     all scalars of all runs: config, run, module,
+                          name, value
+  <sweep>/traces/*.csv    plain CSV traces of the same name concatenated
+                          over runs, with config and run columns in front
+                          (compressed and columnar traces stay per run)
+
+Usage (from this directory, after building ../../src):
+  ./runfarm.py                               # the High/Medium/Low DoS sweep
+  ./runfarm.py -c LuST_DoS -c LuST_Baseline -j 8 --sweep charging
+  ./runfarm.py --runs 0..1 --dry-run
+  ./runfarm.py -c LuST_DoS -c LuST_Baseline --warm-start
+"""
+
+import argparse
+import csv
+import glob
+import os
+import re
+import shutil
+import socket
+import subprocess
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor, as_completed
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+SIMULATIONS = os.path.dirname(HERE)
+SRC = os.path.normpath(os.path.join(SIMULATIONS, "..", "src"))
+
+DEFAULT_CONFIGS = [
+    "EVtoEV_DoS_HighDensity",
+    "EVtoCS_DoS_HighDensity",
+    "EVtoRSU_DoS_HighDensity",
+    "AllTypes_DoS_HighDensity",
+    "EVtoEV_DoS_MediumDensity",
+    "EVtoEV_DoS_LowDensity",
+]
+
+FORKER = "evattack.veins_inet.VeinsInetManagerForker"
+# Failures that a run on another port can fix
+PORT_ERRORS = re.compile(r"Address already in use|Could not connect|Connection refused|could not bind", re.I)
+
+
+class PortPool:
+    """Free TCP ports, never handing out one that an active run holds."""
+
+    def __init__(self):
+        self.lock = threading.Lock()
+        self.active = set()
+
+    def acquire(self):
+        with self.lock:
+            while True:
+                with socket.socket(socket.AF_INET, socket.SOCK_STREAM) as s:
+                    s.bind(("127.0.0.1", 0))
+                    port = s.getsockname()[1]
+                if port not in self.active:
+                    self.active.add(port)
+                    return port
+
+    def release(self, port):
+        with self.lock:
+            self.active.discard(port)
+
+
+def find_executable():
+    for name in ("evAttack", "evAttack.exe", "evAttack_dbg", "evAttack_dbg.exe", "evattack", "evattack.exe"):
+        path = os.path.join(SRC, name)
+        if os.path.isfile(path):
+            return path
+    sys.exit("runfarm: no evAttack executable in %s; build the project first" % SRC)
+
+
+def omnet_command(exe, ini, config, *extra):
+    return [exe, "-u", "Cmdenv", "-n", SIMULATIONS + os.pathsep + SRC, "-f", ini, "-c", config] + list(extra)
+
+
+def count_runs(exe, ini, config):
+    out = subprocess.run(omnet_command(exe, ini, config, "-s", "-q", "numruns"), cwd=HERE,
+                         stdout=subprocess.PIPE, stderr=subprocess.STDOUT, universal_newlines=True)
+    numbers = re.findall(r"\d+", out.stdout)
+    if out.returncode != 0 or not numbers:
+        sys.exit("runfarm: cannot query the runs of %s:\n%s" % (config, out.stdout))
+    return int(numbers[-1])
+
+
+def parse_runs(spec, count):
+    """'0..2,4' -> [0, 1, 2, 4], limited to the runs the config has."""
+    if not spec:
+        return list(range(count))
+    runs = []
+    for part in spec.split(","):
+        if ".." in part:
+            first, last = part.split("..")
+            runs.extend(range(int(first), int(last) + 1))
+        else:
+            runs.append(int(part))
+    return [r for r in runs if r < count]
+
+
+def execute(job, exe, ini, ports, sumo_command, retries, options):
+    config, run, result_dir = job
+    os.makedirs(result_dir, exist_ok=True)
+    prefix = "runfarm-%d-%s-%d." % (os.getpid(), config, run)
+    for attempt in range(retries + 1):
+        port = ports.acquire()
+        start = time.time()
+        try:
+            cmd = omnet_command(exe, ini, config, "-r", str(run),
+                                "--result-dir=" + result_dir,
+                                "--*.veinsManager.typename=\"%s\"" % FORKER,
+                                "--*.veinsManager.port=%d" % port,
+                                "--*.veinsManager.command=\"%s\"" % sumo_command,
+                                # keep the SUMO outputs of parallel runs apart; moved into result_dir below
+                                "--*.veinsManager.commandLine=\"$command --remote-port $port --seed $seed"
+                                " --configuration-file $configFile --output-prefix %s\"" % prefix,
+                                *options)
+            with open(os.path.join(result_dir, "run.log"), "w") as log:
+                code = subprocess.call(cmd, cwd=HERE, stdout=log, stderr=subprocess.STDOUT)
+        finally:
+            ports.release(port)
+        elapsed = time.time() - start
+        collect_sumo_outputs(prefix, result_dir)
+        if code == 0 or attempt == retries:
+            break
+        with open(os.path.join(result_dir, "run.log")) as log:
+            if not PORT_ERRORS.search(log.read()):
+                break
+    return {"config": config, "run": run, "port": port, "exit_code": code,
+            "wall_time_s": "%.1f" % elapsed, "result_dir": os.path.relpath(result_dir, HERE)}
+
+
+def collect_sumo_outputs(prefix, result_dir):
+    # SUMO writes its outputs next to the config it was given, under our prefix
+    for path in glob.glob(os.path.join(HERE, "**", prefix + "*"), recursive=True):
+        target = os.path.join(result_dir, "sumo", os.path.basename(path)[len(prefix):])
+        os.makedirs(os.path.dirname(target), exist_ok=True)
+        shutil.move(path, target)
+
+
+def read_scalars(path):
+    """Scalars of one .sca file as (module, name, value)."""
+    with open(path) as f:
+        for line in f:
+            if line.startswith("scalar "):
+                parts = line.split(None, 3)
+                if len(parts) == 4:
+                    yield parts[1], parts[2], parts[3].strip()
+
+
+def merge(sweep_dir, results):
+    with open(os.path.join(sweep_dir, "runs.csv"), "w", newline="") as f:
+        writer = csv.DictWriter(f, fieldnames=["config", "run", "port", "exit_code", "wall_time_s", "result_dir"])
+        writer.writeheader()
+        writer.writerows(sorted(results, key=lambda r: (r["config"], r["run"])))
+
+    with open(os.path.join(sweep_dir, "scalars.csv"), "w", newline="") as f:
+        writer = csv.writer(f)
+        writer.writerow(["config", "run", "module", "name", "value"])
+        for r in sorted(results, key=lambda r: (r["config"], r["run"])):
+            for sca in sorted(glob.glob(os.path.join(HERE, r["result_dir"], "*.sca"))):
+                for module, name, value in read_scalars(sca):
+                    writer.writerow([r["config"], r["run"], module, name, value])
+
+    # Plain CSV traces: one file per trace name, rows of all runs
+    traces_dir = os.path.join(sweep_dir, "traces")
+    merged = {}
+    for r in sorted(results, key=lambda r: (r["config"], r["run"])):
+        for path in sorted(glob.glob(os.path.join(HERE, r["result_dir"], "*.csv"))):
+            name = os.path.basename(path)
+            with open(path) as src:
+                header = src.readline()
+                if not header:
+                    continue
+                if name not in merged:
+                    os.makedirs(traces_dir, exist_ok=True)
+                    merged[name] = open(os.path.join(traces_dir, name), "w")
+                    merged[name].write("config,run," + header)
+                for line in src:
+                    merged[name].write("%s,%d,%s" % (r["config"], r["run"], line))
+    for f in merged.values():
+        f.close()
+    return len(merged)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("-c", "--config", action="append", help="config to run (repeatable); default: the DoS density sweep")
+    parser.add_argument("-f", "--ini", default="omnetpp.ini", help="ini file (default: omnetpp.ini)")
+    parser.add_argument("-j", "--jobs", type=int, default=os.cpu_count() or 1, help="concurrent runs (default: number of cores)")
+    parser.add_argument("--runs", help="run numbers per config, e.g. 0..4 or 0,2 (default: all)")
+    parser.add_argument("--sweep", default=time.strftime("sweep-%Y%m%d-%H%M%S"), help="sweep name (directory under results/sweeps)")
+    parser.add_argument("--sumo", default="sumo", help="SUMO binary (default: sumo)")
+    parser.add_argument("--retries", type=int, default=1, help="reruns on another port after a TraCI connection failure")
+    parser.add_argument("--warm-start", action="store_true",
+                        help="load SUMO's state at firstStepAt from warmstart/ (saved by the first run) instead of"
+                             " fast-forwarding; SUMO's load-state may not reproduce the fast-forwarded trajectory exactly")
+    parser.add_argument("--dry-run", action="store_true", help="list the runs without starting them")
+    args = parser.parse_args()
+
+    exe = find_executable()
+    configs = args.config or DEFAULT_CONFIGS
+    sweep_dir = os.path.join(HERE, "results", "sweeps", args.sweep)
+
+    jobs = []
+    for config in configs:
+        for run in parse_runs(args.runs, count_runs(exe, args.ini, config)):
+            jobs.append((config, run, os.path.join(sweep_dir, config, str(run))))
+    print("runfarm: %d runs of %d configs, %d at a time -> %s" % (len(jobs), len(configs), args.jobs, sweep_dir))
+    if args.dry_run:
+        for config, run, _ in jobs:
+            print("  %s #%d" % (config, run))
+        return 0
+
+    options = ["--*.veinsManager.warmStart=true"] if args.warm_start else []
+    ports = PortPool()
+    results = []
+    with ThreadPoolExecutor(max_workers=max(1, args.jobs)) as pool:
+        futures = [pool.submit(execute, job, exe, args.ini, ports, args.sumo, args.retries, options) for job in jobs]
+        for done, future in enumerate(as_completed(futures), 1):
+            r = future.result()
+            results.append(r)
+            status = "ok" if r["exit_code"] == 0 else "FAILED (exit %d, see %s/run.log)" % (r["exit_code"], r["result_dir"])
+            print("[%d/%d] %s #%d %s in %ss" % (done, len(jobs), r["config"], r["run"], status, r["wall_time_s"]))
+
+    num_traces = merge(sweep_dir, results)
+    failed = sum(1 for r in results if r["exit_code"] != 0)
+    print("runfarm: %d ok, %d failed; merged %d trace file(s) into %s" % (len(results) - failed, failed, num_traces, sweep_dir))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
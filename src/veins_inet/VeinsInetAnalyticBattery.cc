@@ -0,0 +1,50 @@
+// Battery level as a closed-form function of time between checkpoints
+
+#include "veins_inet/VeinsInetAnalyticBattery.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace veins;
+
+AnalyticBattery::AnalyticBattery(double capacity, double energy, double time)
+    : capacity(capacity)
+    , energy(std::min(std::max(energy, 0.0), capacity))
+    , time(time)
+{
+    if (!(capacity > 0)) throw cRuntimeError("AnalyticBattery: capacity must be positive, got %g", capacity);
+}
+
+double AnalyticBattery::getEnergy(double t) const
+{
+    // Same expressions as in timeToReach(), so a bound is hit exactly at the predicted time
+    if (rate > 0 && t >= time + (capacity - energy) / rate) return capacity;
+    if (rate < 0 && t >= time + (0 - energy) / rate) return 0;
+    return std::min(std::max(energy + rate * (t - time), 0.0), capacity);
+}
+
+void AnalyticBattery::setRate(double t, double rate)
+{
+    checkpoint(t);
+    this->rate = rate;
+}
+
+void AnalyticBattery::drain(double t, double amount)
+{
+    checkpoint(t);
+    energy = std::max(energy - amount, 0.0);
+}
+
+double AnalyticBattery::timeToReach(double t, double level) const
+{
+    level = std::min(std::max(level, 0.0), capacity);
+    double current = getEnergy(t);
+    if (current == level) return t;
+    if (rate == 0 || (level > current) != (rate > 0)) return INFINITY;
+    return std::max(t, time + (level - energy) / rate);
+}
+
+void AnalyticBattery::checkpoint(double t)
+{
+    energy = getEnergy(t);
+    time = t;
+}
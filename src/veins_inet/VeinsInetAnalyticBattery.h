@@ -0,0 +1,57 @@
+// Battery level as a closed-form function of time between checkpoints
+
+#ifndef __VEINS_INET_ANALYTICBATTERY_H_
+#define __VEINS_INET_ANALYTICBATTERY_H_
+
+#include "veins_inet/veins_inet.h"
+
+namespace veins {
+
+/**
+ * Battery whose level is only stored at checkpoints and computed on demand
+ * in between: level(t) = level(checkpoint) + rate * (t - checkpoint),
+ * clamped to [0, capacity]. The rate is piecewise constant (e.g. the
+ * charging power while plugged in, 0 otherwise); discrete costs (packets,
+ * odometer deltas from mobility updates) are taken out with drain().
+ *
+ * Since the level is linear between checkpoints, the time at which it
+ * reaches a given level is known in advance (timeToReach()), so the owner
+ * can schedule one event for the next crossing instead of polling.
+ * Times are in seconds, energies in any consistent unit.
+ */
+class VEINS_INET_API AnalyticBattery {
+public:
+    AnalyticBattery(double capacity = 1, double energy = 0, double time = 0);
+
+    /** @brief level at time t (not before the last checkpoint), within [0, capacity] */
+    double getEnergy(double t) const;
+    double getSoc(double t) const { return getEnergy(t) / capacity; }
+    double getCapacity() const { return capacity; }
+    double getRate() const { return rate; }
+
+    /** @brief from time t on, change the level by rate per second (charging > 0, constant consumption < 0) */
+    void setRate(double t, double rate);
+
+    /** @brief take amount out at time t; the level does not go below 0 */
+    void drain(double t, double amount);
+
+    /**
+     * @brief earliest time not before t at which the level is at level, at the current rate
+     *
+     * Returns t if the level is there already and infinity if the rate does not lead there.
+     * Reaching 0 or capacity is exact: getEnergy() returns exactly that bound from the returned time on.
+     */
+    double timeToReach(double t, double level) const;
+
+protected:
+    double capacity;
+    double energy;  // level at the checkpoint
+    double time;  // checkpoint
+    double rate = 0;
+
+    void checkpoint(double t);
+};
+
+} // namespace veins
+
+#endif
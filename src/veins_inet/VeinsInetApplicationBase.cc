@@ -1,6 +1,7 @@
 // Base application layer for Veins-INET integration with UDP multicast support
 
 #include "veins_inet/VeinsInetApplicationBase.h"
+#include "veins_inet/VeinsInetHeadless.h"
 
 #include "inet/common/lifecycle/ModuleOperations.h"
 #include "inet/common/ModuleAccess.h"
@@ -33,6 +34,8 @@ void VeinsInetApplicationBase::initialize(int stage)
     ApplicationBase::initialize(stage);
 
     if (stage == INITSTAGE_LOCAL) {
+        headless = isHeadless();
+        mobility = veins::VeinsInetMobilityAccess().get(getParentModule());
     }
 }
 
@@ -41,6 +44,7 @@ void VeinsInetApplicationBase::handleStartOperation(LifecycleOperation* operatio
     mobility = veins::VeinsInetMobilityAccess().get(getParentModule());
     traci = mobility->getCommandInterface();
     traciVehicle = mobility->getVehicleCommandInterface();
+    vehicleControl = mobility->isControllable();
 
     // Default multicast address - child class can override this
     L3AddressResolver().tryResolve("224.0.0.1", destAddress);
@@ -61,9 +65,11 @@ void VeinsInetApplicationBase::handleStartOperation(LifecycleOperation* operatio
 #endif
     ASSERT(ie);
     socket.setMulticastOutputInterface(ie->getInterfaceId());
+    receiveFilter.resolve(getContainingNode(this), ift);
 
     Ipv4Address evMulticastGroup("224.0.0.1");
     socket.joinMulticastGroup(evMulticastGroup);
+    receiveFilter.acceptGroup(evMulticastGroup);
     EV_INFO << "EV joined multicast group: " << evMulticastGroup << endl;
 
     socket.setCallback(this);
@@ -87,17 +93,19 @@ void VeinsInetApplicationBase::handleStopOperation(LifecycleOperation* operation
     bool ok = stopApplication();
     ASSERT(ok);
 
+    receiveFilter.release();
     socket.close();
 }
 
 void VeinsInetApplicationBase::handleCrashOperation(LifecycleOperation* operation)
 {
+    receiveFilter.release();
     socket.destroy();
 }
 
 void VeinsInetApplicationBase::finish()
 {
-    ApplicationBase::finish();
+    VeinsInetEventCountingApp::finish();
 }
 
 VeinsInetApplicationBase::~VeinsInetApplicationBase()
@@ -108,9 +116,9 @@ void VeinsInetApplicationBase::refreshDisplay() const
 {
     ApplicationBase::refreshDisplay();
 
-    char buf[100];
-    sprintf(buf, "okay");
-    getDisplayString().setTagArg("t", 0, buf);
+    if (!headless) {
+        getDisplayString().setTagArg("t", 0, "okay");
+    }
 }
 
 void VeinsInetApplicationBase::handleMessageWhenUp(cMessage* msg)
@@ -129,40 +137,17 @@ void VeinsInetApplicationBase::socketDataArrived(UdpSocket* socket, Packet* pack
 {
     auto pk = std::shared_ptr<inet::Packet>(packet);
 
-    auto srcAddr = pk->getTag<L3AddressInd>()->getSrcAddress();
-    if (srcAddr == Ipv4Address::LOOPBACK_ADDRESS) {
+    // Reject self-echoes: loopback, multicast self-loopback (<unspec> source) and own addresses
+    auto addressInd = pk->getTag<L3AddressInd>();
+    if (receiveFilter.isFromSelf(addressInd->getSrcAddress())) {
         EV_DEBUG << "Ignored local echo: " << pk.get() << endl;
         return;
     }
 
-    // Filter multicast self-loopback (source is 0.0.0.0 / <unspec>)
-    if (srcAddr.isUnspecified()) {
-        EV_DEBUG << "Ignored packet with unspecified source (self-loopback)" << endl;
-        return;
-    }
-    
-    IInterfaceTable* ift = getModuleFromPar<IInterfaceTable>(par("interfaceTableModule"), this);
-    for (int i = 0; i < ift->getNumInterfaces(); i++) {
-        auto iface = ift->getInterface(i);
-        if (iface && iface->getProtocolData<inet::Ipv4InterfaceData>() != nullptr) {
-            auto ipv4Data = iface->getProtocolData<inet::Ipv4InterfaceData>();
-            auto ownAddr = ipv4Data->getIPAddress();
-            if (!ownAddr.isUnspecified() && srcAddr == ownAddr) {
-                EV_DEBUG << "Ignored packet from self: " << srcAddr << endl;
-                return;
-            }
-        }
-    }
-
     // Filter by multicast group membership
-    auto destAddr = pk->getTag<L3AddressInd>()->getDestAddress();
-    
-    if (destAddr.isMulticast()) {
-        Ipv4Address evGroup("224.0.0.1");
-        if (destAddr.toIpv4() != evGroup) {
-            EV_DEBUG << "Filtered packet for group " << destAddr << " (not in 224.0.0.1)" << endl;
-            return;
-        }
+    if (!receiveFilter.acceptsDestination(addressInd->getDestAddress())) {
+        EV_DEBUG << "Filtered packet for group " << addressInd->getDestAddress() << " (not joined)" << endl;
+        return;
     }
 
     emit(packetReceivedSignal, 1L);
@@ -8,23 +8,27 @@
 
 #include "inet/common/INETDefs.h"
 
-#include "inet/applications/base/ApplicationBase.h"
+#include "veins_inet/VeinsInetEventCountingApp.h"
 #include "inet/transportlayer/contract/udp/UdpSocket.h"
 #include "veins_inet/VeinsInetMobility.h"
+#include "veins_inet/VeinsInetReceiveFilter.h"
 #include "veins/modules/utility/TimerManager.h"
 
 namespace veins {
 
-class VEINS_INET_API VeinsInetApplicationBase : public inet::ApplicationBase, public inet::UdpSocket::ICallback {
+class VEINS_INET_API VeinsInetApplicationBase : public VeinsInetEventCountingApp, public inet::UdpSocket::ICallback {
 protected:
-    veins::VeinsInetMobility* mobility;
-    veins::TraCICommandInterface* traci;
-    veins::TraCICommandInterface::Vehicle* traciVehicle;
+    veins::VeinsInetMobility* mobility = nullptr;  // own node, resolved in INITSTAGE_LOCAL
+    veins::TraCICommandInterface* traci = nullptr;
+    veins::TraCICommandInterface::Vehicle* traciVehicle = nullptr;
+    bool vehicleControl = false;  // mobility's vehicle commands act on the vehicle (SUMO or synthetic mobility)
     veins::TimerManager timerManager{this};
+    bool headless = false;  // no display string updates or cosmetic TraCI commands (see isHeadless())
 
     inet::L3Address destAddress;
     const int portNumber = 9001;
     inet::UdpSocket socket;
+    VeinsInetReceiveFilter receiveFilter;
 
 protected:
     virtual int numInitStages() const override;
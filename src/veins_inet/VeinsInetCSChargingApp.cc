@@ -8,16 +8,9 @@
 #include "inet/networklayer/common/InterfaceTable.h"
 #include "inet/networklayer/ipv4/Ipv4InterfaceData.h"
 #include "inet/transportlayer/common/L4PortTag_m.h"
-#include "inet/applications/base/ApplicationPacket_m.h"
+#include <cstring>
 #include <sstream>
 #include <iomanip>
-#include <sys/stat.h>
-#ifdef _WIN32
-#include <direct.h>
-#define MKDIR(d) _mkdir(d)
-#else
-#define MKDIR(d) mkdir(d, 0755)
-#endif
 
 using namespace veins;
 
@@ -26,7 +19,6 @@ Define_Module(VeinsInetCSChargingApp);
 VeinsInetCSChargingApp::~VeinsInetCSChargingApp()
 {
     cancelAndDelete(csBatteryTimer);
-    cancelAndDelete(csSecTimer);
     closeCSV();
 }
 
@@ -54,9 +46,9 @@ void VeinsInetCSChargingApp::initialize(int stage)
         csBatteryTimer = new cMessage("csBatteryTimer");
 
         // Rate limiting
-        maxPktPerSecond = par("maxPktPerSecond");
-        pktsReceivedThisSec = 0;
-        csSecTimer = new cMessage("csSecTimer");
+        rateLimiter.configure(this);
+        heavyHitters.configure(this);
+        dosDetector.configure(this);
 
         packetsReceived = 0;
         chargeRequestsReceived = 0;
@@ -72,6 +64,9 @@ void VeinsInetCSChargingApp::initialize(int stage)
         slotsInUseSignal = registerSignal("slotsInUse");
 
 
+        mobility = dynamic_cast<inet::IMobility*>(getParentModule()->getSubmodule("mobility"));
+
+        traceFilter.configure(this);
         initCSV();
     }
 }
@@ -99,14 +94,17 @@ void VeinsInetCSChargingApp::handleStartOperation(inet::LifecycleOperation* op)
     if (ie) {
         socket.setMulticastOutputInterface(ie->getInterfaceId());
     }
+    receiveFilter.resolve(inet::getContainingNode(this), ift);
 
     // Join CS multicast group (224.0.0.2) - for charge requests and attack pkts
     inet::L3AddressResolver().tryResolve("224.0.0.2", csMulticastGroup);
     socket.joinMulticastGroup(csMulticastGroup);
+    receiveFilter.acceptGroup(csMulticastGroup);
 
     // Join EV/BSM multicast group (224.0.0.1) - for normal traffic logging
     inet::L3AddressResolver().tryResolve("224.0.0.1", evMulticastGroup);
     socket.joinMulticastGroup(evMulticastGroup);
+    receiveFilter.acceptGroup(evMulticastGroup);
 
     EV_INFO << getParentModule()->getFullName() << " CS Charging App started, slots="
             << maxSlots << ", battery=" << currentCSBatteryWh << "/"
@@ -114,14 +112,12 @@ void VeinsInetCSChargingApp::handleStartOperation(inet::LifecycleOperation* op)
 
     // Start periodic battery update (1 second interval)
     scheduleAt(simTime() + 1.0, csBatteryTimer);
-    // Start rate-limit counter reset (1 second interval)
-    scheduleAt(simTime() + 1.0, csSecTimer);
 }
 
 void VeinsInetCSChargingApp::handleStopOperation(inet::LifecycleOperation* op)
 {
     cancelEvent(csBatteryTimer);
-    cancelEvent(csSecTimer);
+    receiveFilter.release();
     socket.close();
     closeCSV();
 }
@@ -129,7 +125,7 @@ void VeinsInetCSChargingApp::handleStopOperation(inet::LifecycleOperation* op)
 void VeinsInetCSChargingApp::handleCrashOperation(inet::LifecycleOperation* op)
 {
     cancelEvent(csBatteryTimer);
-    cancelEvent(csSecTimer);
+    receiveFilter.release();
     socket.destroy();
     closeCSV();
 }
@@ -144,11 +140,6 @@ void VeinsInetCSChargingApp::handleMessageWhenUp(cMessage* msg)
         updateCSBattery();
         scheduleAt(simTime() + 1.0, csBatteryTimer);
     }
-    else if (msg == csSecTimer) {
-        // Reset per-second receive counter for rate limiting
-        pktsReceivedThisSec = 0;
-        scheduleAt(simTime() + 1.0, csSecTimer);
-    }
     else if (socket.belongsToSocket(msg)) {
         socket.processMessage(msg);
     }
@@ -164,45 +155,44 @@ void VeinsInetCSChargingApp::handleMessageWhenUp(cMessage* msg)
 void VeinsInetCSChargingApp::socketDataArrived(inet::UdpSocket* sock,
                                                 inet::Packet* packet)
 {
-    // Rate limiting: drop packet if over per-second cap
-    if (maxPktPerSecond > 0 && pktsReceivedThisSec >= maxPktPerSecond) {
+    // Drop our own ChargeResponses looped back by the 224.0.0.1 membership
+    auto addressInd = packet->getTag<inet::L3AddressInd>();
+    if (receiveFilter.isFromSelf(addressInd->getSrcAddress())
+        || !receiveFilter.acceptsDestination(addressInd->getDestAddress())) {
+        delete packet;
+        return;
+    }
+
+    dosDetector.observe(packet);
+
+    // Per-source flood detection: drop packet if its sender is above heavyHitterDropRate
+    if (!heavyHitters.accept(packet)) {
         EV_INFO << getParentModule()->getFullName()
-                << " CS RATE LIMIT: dropping packet (" << pktsReceivedThisSec
-                << " >= " << maxPktPerSecond << " pkts/s)" << endl;
+                << " CS HEAVY HITTER: dropping packet (" << heavyHitters.getNumDropped() << " dropped)" << endl;
+        delete packet;
+        return;
+    }
+
+    // Rate limiting: drop packet if over the receive rate
+    if (!rateLimiter.accept(packet)) {
+        EV_INFO << getParentModule()->getFullName()
+                << " CS RATE LIMIT: dropping packet (" << rateLimiter.getNumDropped() << " dropped)" << endl;
         delete packet;
         return;
     }
-    pktsReceivedThisSec++;
 
     int pktSize = packet->getByteLength();
     simtime_t iat = simTime() - lastPacketTime;
     lastPacketTime = simTime();
     packetsReceived++;
 
-    auto srcAddr = packet->getTag<inet::L3AddressInd>()->getSrcAddress();
-    std::string pktName = packet->getName();
-
-    // Extract sequence number
-    int seqNum = packetsReceived;
-    try {
-        const auto& payload = packet->peekAtFront<inet::ApplicationPacket>();
-        seqNum = payload->getSequenceNumber();
-    } catch (...) {}
+    auto srcAddr = addressInd->getSrcAddress();
+    const char* pktName = packet->getName();
 
-    // Determine communication type
-    std::string commType = "UNKNOWN";
-    if (pktName.find("ChargeReq") != std::string::npos) {
-        commType = "ChargeReq";
-    }
-    else if (pktName.find("ChargeDone") != std::string::npos) {
-        commType = "ChargeDone";
-    }
-    else if (pktName.find("EV2CS") != std::string::npos) {
-        commType = "EV2CS";
-    }
-    else if (pktName.find("BSM") != std::string::npos) {
-        commType = "BSM";
-    }
+    // Dispatch on the typed application header
+    auto payload = peekEvPayload(packet);
+    int seqNum = payload ? (int)payload->getSequenceNumber() : packetsReceived;
+    const char* commType = payload ? getCommunicationType(*payload) : "UNKNOWN";
 
     // Energy accounting
     double energy = calculateReceiveEnergy(pktSize);
@@ -215,32 +205,16 @@ void VeinsInetCSChargingApp::socketDataArrived(inet::UdpSocket* sock,
     emit(energyConsumptionSignal, energy);
     emit(txDurationSignal, txDur);
 
-    logCSV(commType.c_str(), pktSize, iat.dbl(), energy,
+    logCSV(getTraceEventClass(payload.get()), commType, pktSize, iat.dbl(), energy,
            srcAddr.str().c_str(), getParentModule()->getFullName(),
-           seqNum, pktName.c_str());
+           seqNum, pktName);
 
     // Handle charging protocol messages
-    if (commType == "ChargeReq") {
-        // Extract vehicle ID from packet name: "ChargeReq-ev[0]-soc0.15"
-        std::string vehicleId = "unknown";
-        size_t start = pktName.find("ChargeReq-");
-        if (start != std::string::npos) {
-            start += 10; // skip "ChargeReq-"
-            size_t end = pktName.find("-soc", start);
-            if (end != std::string::npos) {
-                vehicleId = pktName.substr(start, end - start);
-            }
-        }
-        handleChargeRequest(vehicleId, packet);
+    if (payload && payload->getMessageType() == EV_MSG_CHARGE_REQUEST) {
+        handleChargeRequest(static_cast<const ChargeRequest&>(*payload));
     }
-    else if (commType == "ChargeDone") {
-        // Extract vehicle ID: "ChargeDone-ev[0]"
-        std::string vehicleId = "unknown";
-        size_t start = pktName.find("ChargeDone-");
-        if (start != std::string::npos) {
-            vehicleId = pktName.substr(11);
-        }
-        handleChargeComplete(vehicleId);
+    else if (payload && payload->getMessageType() == EV_MSG_CHARGE_DONE) {
+        handleChargeComplete(static_cast<const ChargeDone&>(*payload));
     }
 
     delete packet;
@@ -281,8 +255,8 @@ void VeinsInetCSChargingApp::updateCSBattery()
     currentCSSoC = currentCSBatteryWh / csBatteryCapacity;
 
     // Log a BATTERY_UPDATE event to CSV (shows CS state every second)
-    std::string status = numCharging > 0 ? "CS_DISCHARGING" : "CS_IDLE";
-    logCSV(status.c_str(), 0, 0.0, totalEnergyDelivered,
+    const char* status = numCharging > 0 ? "CS_DISCHARGING" : "CS_IDLE";
+    logCSV(TRACE_EVENT_TICK, status, 0, 0.0, totalEnergyDelivered,
            getParentModule()->getFullName(), "grid",
            0, "BatteryTick");
 }
@@ -291,13 +265,17 @@ void VeinsInetCSChargingApp::updateCSBattery()
 // Charging protocol
 // ============================================================
 
-void VeinsInetCSChargingApp::handleChargeRequest(const std::string& vehicleId,
-                                                  inet::Packet* pkt)
+void VeinsInetCSChargingApp::handleChargeRequest(const ChargeRequest& request)
 {
+    // Requests addressed to another CS are only logged
+    if (request.getCsIndex() >= 0 && request.getCsIndex() != getParentModule()->getIndex()) return;
+
+    int vehicleId = request.getVehicleId();
     chargeRequestsReceived++;
     emit(chargeRequestReceivedSignal, (long)chargeRequestsReceived);
 
-    bool available = ((int)chargingVehicles.size() < maxSlots);
+    // A repeated request of a vehicle that already holds a slot keeps it
+    bool available = chargingVehicles.count(vehicleId) || ((int)chargingVehicles.size() < maxSlots);
 
     if (available) {
         chargingVehicles.insert(vehicleId);
@@ -306,7 +284,8 @@ void VeinsInetCSChargingApp::handleChargeRequest(const std::string& vehicleId,
     emit(slotsInUseSignal, (long)chargingVehicles.size());
 
     EV_INFO << getParentModule()->getFullName()
-            << " received ChargeReq from " << vehicleId
+            << " received ChargeReq from ev[" << vehicleId
+            << "] (SoC=" << (request.getSoc() * 100) << "%)"
             << " -> " << (available ? "AVAILABLE" : "BUSY")
             << " (slots: " << chargingVehicles.size() << "/" << maxSlots << ")"
             << endl;
@@ -314,36 +293,47 @@ void VeinsInetCSChargingApp::handleChargeRequest(const std::string& vehicleId,
     sendChargeResponse(vehicleId, available);
 }
 
-void VeinsInetCSChargingApp::handleChargeComplete(const std::string& vehicleId)
+void VeinsInetCSChargingApp::handleChargeComplete(const ChargeDone& done)
 {
+    if (done.getCsIndex() >= 0 && done.getCsIndex() != getParentModule()->getIndex()) return;
+
+    int vehicleId = done.getVehicleId();
     chargingVehicles.erase(vehicleId);
     emit(slotsInUseSignal, (long)chargingVehicles.size());
 
     EV_INFO << getParentModule()->getFullName()
-            << " received ChargeDone from " << vehicleId
-            << " (slots: " << chargingVehicles.size() << "/" << maxSlots << ")"
+            << " received ChargeDone from ev[" << vehicleId
+            << "] (slots: " << chargingVehicles.size() << "/" << maxSlots << ")"
             << endl;
 }
 
-void VeinsInetCSChargingApp::sendChargeResponse(const std::string& vehicleId,
-                                                 bool available)
+void VeinsInetCSChargingApp::sendChargeResponse(int vehicleId, bool available)
 {
+    std::ostringstream vehicleName;
+    vehicleName << "ev[" << vehicleId << "]";
+
     std::ostringstream name;
     name << "ChargeResp-" << (available ? "AVAILABLE" : "BUSY")
-         << "-" << vehicleId;
+         << "-" << vehicleName.str();
 
     int sz = 100;
-    auto payload = inet::makeShared<inet::ApplicationPacket>();
+    auto payload = inet::makeShared<ChargeResponse>();
     payload->setChunkLength(inet::B(sz));
+    payload->setVehicleId(vehicleId);
     payload->setSequenceNumber(chargeRequestsReceived);
+    payload->setStatus(available ? CHARGE_STATUS_AVAILABLE : CHARGE_STATUS_BUSY);
+    payload->setCsIndex(getParentModule()->getIndex());
+    payload->setSlotsInUse(chargingVehicles.size());
+    payload->setMaxSlots(maxSlots);
+    payload->setCsSoc(currentCSSoC);
 
     inet::Packet* pkt = new inet::Packet(name.str().c_str(), payload);
 
     // Send to EV multicast group so the requesting EV receives it
     inet::L3Address dest = inet::Ipv4Address("224.0.0.1");
 
-    logCSV("ChargeResp", sz, 0.0, 0.0,
-           getParentModule()->getFullName(), vehicleId.c_str(),
+    logCSV(TRACE_EVENT_CHARGING, "ChargeResp", sz, 0.0, 0.0,
+           getParentModule()->getFullName(), vehicleName.str().c_str(),
            chargeRequestsReceived, name.str().c_str());
 
     socket.sendTo(pkt, dest, portNumber);
@@ -364,16 +354,12 @@ double VeinsInetCSChargingApp::calculateReceiveEnergy(int pktSize)
 
 inet::Coord VeinsInetCSChargingApp::getMyPosition()
 {
-    auto mob = dynamic_cast<inet::IMobility*>(
-        getParentModule()->getSubmodule("mobility"));
-    return mob ? mob->getCurrentPosition() : inet::Coord::ZERO;
+    return mobility ? mobility->getCurrentPosition() : inet::Coord::ZERO;
 }
 
 double VeinsInetCSChargingApp::getMySpeed()
 {
-    auto mob = dynamic_cast<inet::IMobility*>(
-        getParentModule()->getSubmodule("mobility"));
-    return mob ? mob->getCurrentVelocity().length() : 0.0;
+    return mobility ? mobility->getCurrentVelocity().length() : 0.0;
 }
 
 // ============================================================
@@ -382,88 +368,82 @@ double VeinsInetCSChargingApp::getMySpeed()
 
 void VeinsInetCSChargingApp::initCSV()
 {
-    // Ensure results directory exists (static modules init before OMNeT++ creates it)
-    struct stat st;
-    if (stat("results", &st) != 0) {
-        MKDIR("results");
+    // One shared trace for the whole network if the scenario has a traceCollector
+    if (VeinsInetTraceCollector* collector = VeinsInetTraceCollectorAccess().get()) {
+        traceChannel = collector->acquire(getParentModule()->getName());
+        traceShared = true;
+        return;
     }
 
     const char* cfg = getEnvir()->getConfigEx()->getActiveConfigName();
+    TraceFormat format = TraceSink::parseFormat(par("traceFormat"));
+    TraceCompression compression = TraceSink::parseCompression(par("traceCompression"));
     std::ostringstream fn;
-    fn << "results/" << cfg << "_"
+    fn << cfg << "_"
        << getParentModule()->getName()
-       << getParentModule()->getIndex() << ".csv";
+       << getParentModule()->getIndex() << TraceSink::getFileExtension(format, compression);
 
-    csvFilePath = fn.str();
-    csvFile.open(csvFilePath.c_str());
-
-    if (!csvFile.is_open()) {
-        EV_ERROR << "CS: Failed to open CSV file: " << csvFilePath << endl;
-    }
-
-    if (csvFile.is_open()) {
-        csvFile << "timestamp,event_type,node_id,node_type,communication_type,"
-                << "packet_size,inter_arrival_time,battery_level,"
-                << "energy_consumption,source_address,target_address,"
-                << "is_attacker,is_charging,"
-                << "sequence_number,packet_name,"
-                << "pos_x,pos_y,speed,"
-                << "tx_duration_est,"
-                << "cumulative_packets_sent,cumulative_packets_received,"
-                << "soc\n";
-    }
+    csvFilePath = TraceSink::getResultPath(fn.str());
+    traceChannel = TraceSink::getInstance().openChannel(csvFilePath, TRACE_SCHEMA_SOC, format, compression, par("traceCompressionLevel"));
 }
 
-void VeinsInetCSChargingApp::logCSV(const char* commType, int pktSize,
+void VeinsInetCSChargingApp::logCSV(TraceEventClass eventClass, const char* commType, int pktSize,
     double iat, double energy, const char* srcAddr, const char* tgtAddr,
     int seqNum, const char* pktName)
 {
-    if (!csvFile.is_open()) return;
+    // Filter first: rejected rows cost no formatting
+    if (!traceChannel || !traceFilter.accept(eventClass)) return;
 
     inet::Coord pos = getMyPosition();
-    double txDur = (pktSize * 8.0) / 6e6;
 
     // Determine event type
-    std::string eventType = "RECEIVED";
-    std::string pktStr(pktName);
-    if (pktStr.find("ChargeResp") != std::string::npos) {
+    const char* eventType = "RECEIVED";
+    if (strstr(pktName, "ChargeResp") != nullptr) {
         eventType = "SENT";
     }
-    else if (pktStr.find("BatteryTick") != std::string::npos) {
+    else if (strstr(pktName, "BatteryTick") != nullptr) {
         eventType = commType; // CS_IDLE or CS_DISCHARGING
     }
 
     int numCharging = (int)chargingVehicles.size();
 
-    csvFile << std::fixed << std::setprecision(6)
-            << simTime().dbl() << ","
-            << eventType << ","
-            << getParentModule()->getIndex() << ","
-            << getParentModule()->getName() << ","
-            << commType << ","
-            << pktSize << ","
-            << iat << ","
-            << currentCSBatteryWh << ","
-            << energy << ","
-            << srcAddr << ","
-            << tgtAddr << ","
-            << "0" << ","
-            << numCharging << ","
-            << seqNum << ","
-            << pktName << ","
-            << pos.x << ","
-            << pos.y << ","
-            << "0" << ","
-            << txDur << ","
-            << numCharging << ","
-            << packetsReceived << ","
-            << currentCSSoC << "\n";
-    csvFile.flush();
+    TraceRecord& r = TraceSink::getInstance().beginRecord(traceChannel);
+    r.flags = TRACE_HAS_SOC | TRACE_NO_SPEED;
+    r.timestamp = simTime().dbl();
+    TraceRecord::copy(r.eventType, eventType);
+    r.nodeId = getParentModule()->getIndex();
+    TraceRecord::copy(r.nodeType, getParentModule()->getName());
+    TraceRecord::copy(r.commType, commType);
+    r.packetSize = pktSize;
+    r.interArrivalTime = iat;
+    r.battery = currentCSBatteryWh;
+    r.energy = energy;
+    TraceRecord::copy(r.srcAddress, srcAddr);
+    TraceRecord::copy(r.tgtAddress, tgtAddr);
+    r.isAttacker = false;
+    r.isCharging = numCharging;
+    r.sequenceNumber = seqNum;
+    TraceRecord::copy(r.packetName, pktName);
+    r.posX = pos.x;
+    r.posY = pos.y;
+    r.txDuration = (pktSize * 8.0) / 6e6;
+    r.packetsSent = numCharging;
+    r.packetsReceived = packetsReceived;
+    r.soc = currentCSSoC;
+    TraceSink::getInstance().commitRecord();
 }
 
 void VeinsInetCSChargingApp::closeCSV()
 {
-    if (csvFile.is_open()) csvFile.close();
+    if (traceChannel) {
+        if (!traceShared) {
+            TraceSink::getInstance().closeChannel(traceChannel);
+        }
+        else if (VeinsInetTraceCollector* collector = VeinsInetTraceCollectorAccess().get()) {
+            collector->release(traceChannel);
+        }
+        traceChannel = nullptr;
+    }
 }
 
 // ============================================================
@@ -472,14 +452,18 @@ void VeinsInetCSChargingApp::closeCSV()
 
 void VeinsInetCSChargingApp::finish()
 {
-    ApplicationBase::finish();
+    VeinsInetEventCountingApp::finish();
 
     recordScalar("packetsReceived", packetsReceived);
     recordScalar("chargeRequestsReceived", chargeRequestsReceived);
+    rateLimiter.recordScalars();
+    heavyHitters.recordScalars();
+    dosDetector.recordScalars();
     recordScalar("totalEnergyConsumed", totalEnergyConsumed);
     recordScalar("totalEnergyDelivered", totalEnergyDelivered);
     recordScalar("finalCSBatteryWh", currentCSBatteryWh);
     recordScalar("finalCSSoC", currentCSSoC);
+    recordScalar("traceRowsFiltered", traceFilter.getNumRejected());
     recordScalar("avgPacketRate",
                  simTime() > 0 ? packetsReceived / simTime().dbl() : 0);
 
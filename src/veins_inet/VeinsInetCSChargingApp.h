@@ -4,17 +4,24 @@
 #define __VEINS_INET_CSCHARGINGAPP_H_
 
 #include "veins_inet/veins_inet.h"
-#include "inet/applications/base/ApplicationBase.h"
+#include "veins_inet/ChargingProtocol_m.h"
+#include "veins_inet/VeinsInetDosDetector.h"
+#include "veins_inet/VeinsInetEventCountingApp.h"
+#include "veins_inet/VeinsInetHeavyHitterTracker.h"
+#include "veins_inet/VeinsInetRateLimiter.h"
+#include "veins_inet/VeinsInetReceiveFilter.h"
+#include "veins_inet/VeinsInetTraceCollector.h"
+#include "veins_inet/VeinsInetTraceFilter.h"
+#include "veins_inet/VeinsInetTraceSink.h"
 #include "inet/transportlayer/contract/udp/UdpSocket.h"
 #include "inet/mobility/contract/IMobility.h"
 #include "inet/common/geometry/common/Coord.h"
-#include <fstream>
 #include <set>
 
 namespace veins {
 
 class VEINS_INET_API VeinsInetCSChargingApp
-    : public inet::ApplicationBase
+    : public VeinsInetEventCountingApp
     , public inet::UdpSocket::ICallback
 {
 protected:
@@ -23,7 +30,7 @@ protected:
 
     // Charging slots
     int maxSlots;
-    std::set<std::string> chargingVehicles; // currently charging
+    std::set<int> chargingVehicles;      // indices of EVs currently charging
 
     // CS battery model
     double csBatteryCapacity;    // Wh (max capacity)
@@ -54,16 +61,21 @@ protected:
     // Multicast groups
     inet::L3Address csMulticastGroup;
     inet::L3Address evMulticastGroup;
+    VeinsInetReceiveFilter receiveFilter;
 
     // Rate limiting
-    int maxPktPerSecond;        // max recv pkts/s (0=unlimited)
-    int pktsReceivedThisSec;    // rolling counter, reset each second
-    cMessage* csSecTimer;       // 1-second reset timer
+    RateLimiter rateLimiter;
+    HeavyHitterTracker heavyHitters;  // per-source rates; may drop floods before the rate limiter
+    DosDetector dosDetector;  // sees all traffic, before any drop
 
     // CSV
-    std::ofstream csvFile;
+    TraceChannel* traceChannel = nullptr;
+    bool traceShared = false;   // traceChannel belongs to the network's traceCollector
+    TraceFilter traceFilter;
     std::string csvFilePath;
 
+    inet::IMobility* mobility = nullptr;  // own node, resolved once
+
 protected:
     virtual int numInitStages() const override { return inet::NUM_INIT_STAGES; }
     virtual void initialize(int stage) override;
@@ -79,9 +91,9 @@ protected:
     virtual void socketClosed(inet::UdpSocket* sock) override;
 
     // Charging protocol
-    void handleChargeRequest(const std::string& vehicleId, inet::Packet* pkt);
-    void handleChargeComplete(const std::string& vehicleId);
-    void sendChargeResponse(const std::string& vehicleId, bool available);
+    void handleChargeRequest(const ChargeRequest& request);
+    void handleChargeComplete(const ChargeDone& done);
+    void sendChargeResponse(int vehicleId, bool available);
 
     // CS battery update (called every 1s)
     void updateCSBattery();
@@ -93,7 +105,7 @@ protected:
 
     // CSV
     void initCSV();
-    void logCSV(const char* commType, int pktSize, double iat, double energy,
+    void logCSV(TraceEventClass eventClass, const char* commType, int pktSize, double iat, double energy,
                 const char* srcAddr, const char* tgtAddr,
                 int seqNum, const char* pktName);
     void closeCSV();
@@ -0,0 +1,95 @@
+// On-disk layout of the columnar EV/CS/RSU trace format (.evtc)
+
+#ifndef __VEINS_INET_COLUMNARTRACEFORMAT_H_
+#define __VEINS_INET_COLUMNARTRACEFORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+
+//
+// Columnar trace file layout (version 1). All integers and doubles are
+// little-endian: they are written in host byte order, so column blocks can
+// be used in place, and big-endian hosts are rejected at compile time
+// below. Every block starts at a multiple of 8 bytes from the file start,
+// so a reader can mmap the file and use column blocks in place.
+//
+//   file      := fileHeader rowGroup*
+//   fileHeader:= magic[8] = "EVTRACE\0", u32 version, u32 numColumns,
+//                numColumns x (u8 columnType, u8 nameLength, name bytes),
+//                padding to 8
+//   rowGroup  := u32 numRows, u32 reserved (0), numColumns x columnBlock
+//   columnBlock := u64 blockLength (multiple of 8), block bytes padded to 8
+//
+// Block contents by column type (n = numRows):
+//   F64    n x double; NaN where the text trace has no number: a missing
+//          soc in a shared trace (empty in CSV), battery_level of RSU rows
+//          and speed of CS rows (literal 0 in CSV)
+//   I32    n x i32
+//   BOOL   n x u8
+//   DICT   u32 dictSize, u32 codeWidth (1, 2 or 4 bytes, the smallest
+//          that fits dictSize), (dictSize + 1) x u32 offsets into the
+//          string bytes that follow, string bytes, padding to 4,
+//          n x codeWidth codes, padding to 4. Dictionaries are local to
+//          the row group.
+//   NAME   a DICT block of prefixes followed by n x i32 numeric suffixes;
+//          value = prefix + suffix, or just prefix if the
+//          suffix is -1 ("BSM-42" -> "BSM-", 42; "BatteryTick" -> "BatteryTick", -1).
+//
+// Row groups are only appended when full or when the trace is closed, so
+// a file cut short by a crash is readable up to its last complete group.
+//
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The columnar trace format is written in host byte order and requires a little-endian host"
+#endif
+
+namespace veins {
+
+enum ColumnarColumnType : uint8_t {
+    COLUMN_F64 = 0,
+    COLUMN_I32 = 1,
+    COLUMN_BOOL = 2,
+    COLUMN_DICT = 3,
+    COLUMN_NAME = 4,
+};
+
+struct ColumnarColumnSpec {
+    const char* name;
+    ColumnarColumnType type;
+};
+
+static const char COLUMNAR_TRACE_MAGIC[8] = {'E', 'V', 'T', 'R', 'A', 'C', 'E', '\0'};
+static const uint32_t COLUMNAR_TRACE_VERSION = 1;
+
+// Columns of the shared schema, in CSV order; soc only in the 22-column schema
+static const ColumnarColumnSpec COLUMNAR_TRACE_COLUMNS[] = {
+    {"timestamp", COLUMN_F64},
+    {"event_type", COLUMN_DICT},
+    {"node_id", COLUMN_I32},
+    {"node_type", COLUMN_DICT},
+    {"communication_type", COLUMN_DICT},
+    {"packet_size", COLUMN_I32},
+    {"inter_arrival_time", COLUMN_F64},
+    {"battery_level", COLUMN_F64},
+    {"energy_consumption", COLUMN_F64},
+    {"source_address", COLUMN_DICT},
+    {"target_address", COLUMN_DICT},
+    {"is_attacker", COLUMN_BOOL},
+    {"is_charging", COLUMN_I32},
+    {"sequence_number", COLUMN_I32},
+    {"packet_name", COLUMN_NAME},
+    {"pos_x", COLUMN_F64},
+    {"pos_y", COLUMN_F64},
+    {"speed", COLUMN_F64},
+    {"tx_duration_est", COLUMN_F64},
+    {"cumulative_packets_sent", COLUMN_I32},
+    {"cumulative_packets_received", COLUMN_I32},
+    {"soc", COLUMN_F64},
+};
+
+static const size_t COLUMNAR_TRACE_BASE_COLUMNS = 21;
+static const size_t COLUMNAR_TRACE_SOC_COLUMNS = 22;
+
+} // namespace veins
+
+#endif
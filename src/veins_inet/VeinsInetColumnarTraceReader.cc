@@ -0,0 +1,248 @@
+// Reader for columnar EV/CS/RSU traces (.evtc); no OMNeT++ dependency
+
+#include "veins_inet/VeinsInetColumnarTraceReader.h"
+#include "veins_inet/VeinsInetTraceRowEncoder.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace veins;
+
+namespace {
+
+template <typename T>
+T readValue(const char* p)
+{
+    T value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+size_t alignUp(size_t n, size_t alignment)
+{
+    return (n + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+ColumnarTraceReader::ColumnarTraceReader(const std::string& path)
+{
+    load(path);
+    parse();
+}
+
+ColumnarTraceReader::~ColumnarTraceReader()
+{
+#ifndef _WIN32
+    if (mapped) munmap(const_cast<char*>(data), size);
+#endif
+}
+
+void ColumnarTraceReader::load(const std::string& path)
+{
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("cannot open columnar trace " + path);
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            data = static_cast<const char*>(p);
+            size = st.st_size;
+            mapped = true;
+        }
+    }
+    close(fd);
+    if (mapped) return;
+#endif
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("cannot open columnar trace " + path);
+    buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    data = buffer.data();
+    size = buffer.size();
+}
+
+void ColumnarTraceReader::parse()
+{
+    if (size < 16 || memcmp(data, COLUMNAR_TRACE_MAGIC, sizeof(COLUMNAR_TRACE_MAGIC)) != 0)
+        throw std::runtime_error("not a columnar trace file");
+    if (readValue<uint32_t>(data + 8) != COLUMNAR_TRACE_VERSION)
+        throw std::runtime_error("unsupported columnar trace version");
+
+    uint32_t numColumns = readValue<uint32_t>(data + 12);
+    size_t pos = 16;
+    for (uint32_t i = 0; i < numColumns; i++) {
+        if (pos + 2 > size) throw std::runtime_error("truncated columnar trace header");
+        uint8_t type = readValue<uint8_t>(data + pos);
+        if (type > COLUMN_NAME) throw std::runtime_error("unknown column type in columnar trace header");
+        columnTypes.push_back(static_cast<ColumnarColumnType>(type));
+        uint8_t nameLength = readValue<uint8_t>(data + pos + 1);
+        if (pos + 2 + nameLength > size) throw std::runtime_error("truncated columnar trace header");
+        columnNames.emplace_back(data + pos + 2, nameLength);
+        pos += 2 + nameLength;
+    }
+    pos = alignUp(pos, 8);
+
+    // A trailing incomplete row group (e.g. after a crash) is ignored
+    while (pos + 8 <= size) {
+        RowGroup group;
+        group.numRows = readValue<uint32_t>(data + pos);
+        size_t next = pos + 8;
+        bool complete = true;
+        for (uint32_t i = 0; i < numColumns && complete; i++) {
+            if (next + 8 > size) { complete = false; break; }
+            uint64_t blockLength = readValue<uint64_t>(data + next);
+            if (blockLength > size - next - 8) { complete = false; break; }
+            // Fixed-width blocks must hold all rows; dictionary blocks are checked in getStrings()
+            static const size_t rowSize[] = {8, 4, 1, 0, 0};
+            size_t width = rowSize[columnTypes[i]];
+            if (blockLength % 8 != 0 || (width && blockLength / width < group.numRows))
+                throw std::runtime_error("corrupt columnar trace: block of column " + columnNames[i] + " has a bad length");
+            group.blocks.push_back(data + next + 8);
+            group.blockLengths.push_back(blockLength);
+            next += 8 + blockLength;
+        }
+        if (!complete) break;
+        rowGroups.push_back(std::move(group));
+        pos = next;
+    }
+}
+
+int ColumnarTraceReader::findColumn(const std::string& name) const
+{
+    for (size_t i = 0; i < columnNames.size(); i++) {
+        if (columnNames[i] == name) return i;
+    }
+    return -1;
+}
+
+size_t ColumnarTraceReader::getTotalRows() const
+{
+    size_t total = 0;
+    for (auto& group : rowGroups) total += group.numRows;
+    return total;
+}
+
+const char* ColumnarTraceReader::getBlock(size_t rowGroup, size_t column, ColumnarColumnType expected) const
+{
+    if (rowGroup >= rowGroups.size() || column >= columnTypes.size())
+        throw std::out_of_range("row group or column out of range");
+    if (columnTypes[column] != expected)
+        throw std::runtime_error("column " + columnNames[column] + " has a different type");
+    return rowGroups[rowGroup].blocks[column];
+}
+
+const double* ColumnarTraceReader::getDoubles(size_t rowGroup, size_t column) const
+{
+    return reinterpret_cast<const double*>(getBlock(rowGroup, column, COLUMN_F64));
+}
+
+const int32_t* ColumnarTraceReader::getInts(size_t rowGroup, size_t column) const
+{
+    return reinterpret_cast<const int32_t*>(getBlock(rowGroup, column, COLUMN_I32));
+}
+
+const uint8_t* ColumnarTraceReader::getBools(size_t rowGroup, size_t column) const
+{
+    return reinterpret_cast<const uint8_t*>(getBlock(rowGroup, column, COLUMN_BOOL));
+}
+
+ColumnarTraceReader::StringColumn ColumnarTraceReader::getStrings(size_t rowGroup, size_t column) const
+{
+    bool isName = column < columnTypes.size() && columnTypes[column] == COLUMN_NAME;
+    const char* block = getBlock(rowGroup, column, isName ? COLUMN_NAME : COLUMN_DICT);
+    size_t numRows = rowGroups[rowGroup].numRows;
+    size_t length = rowGroups[rowGroup].blockLengths[column];
+    std::runtime_error corrupt("corrupt columnar trace: dictionary block of column " + columnNames[column]);
+    if (length < 8) throw corrupt;
+
+    StringColumn result;
+    result.dictSize = readValue<uint32_t>(block);
+    result.codeWidth = readValue<uint32_t>(block + 4);
+    if (result.codeWidth != 1 && result.codeWidth != 2 && result.codeWidth != 4) throw corrupt;
+    if ((length - 8) / 4 < (size_t) result.dictSize + 1) throw corrupt;
+    result.offsets = reinterpret_cast<const uint32_t*>(block + 8);
+    size_t pos = 8 + 4 * ((size_t) result.dictSize + 1);
+    result.bytes = block + pos;
+    for (uint32_t i = 0; i < result.dictSize; i++) {
+        if (result.offsets[i] > result.offsets[i + 1]) throw corrupt;
+    }
+    if (result.offsets[0] != 0 || result.offsets[result.dictSize] > length - pos) throw corrupt;
+    pos = alignUp(pos + result.offsets[result.dictSize], 4);
+    if (pos > length || (length - pos) / result.codeWidth < numRows) throw corrupt;
+    result.codes = reinterpret_cast<const uint8_t*>(block + pos);
+    pos = alignUp(pos + result.codeWidth * numRows, 4);
+    if (isName && (pos > length || (length - pos) / 4 < numRows)) throw corrupt;
+    result.suffixes = isName ? reinterpret_cast<const int32_t*>(block + pos) : nullptr;
+    for (size_t row = 0; row < numRows; row++) {
+        if (result.getCode(row) >= result.dictSize) throw corrupt;
+    }
+    return result;
+}
+
+uint32_t ColumnarTraceReader::StringColumn::getCode(size_t row) const
+{
+    switch (codeWidth) {
+        case 1: return codes[row];
+        case 2: return readValue<uint16_t>(reinterpret_cast<const char*>(codes) + 2 * row);
+        default: return readValue<uint32_t>(reinterpret_cast<const char*>(codes) + 4 * row);
+    }
+}
+
+std::string ColumnarTraceReader::StringColumn::getValue(size_t row) const
+{
+    std::string value = getString(getCode(row));
+    if (suffixes && suffixes[row] >= 0) value += std::to_string(suffixes[row]);
+    return value;
+}
+
+void ColumnarTraceReader::writeCsv(std::ostream& out) const
+{
+    for (size_t c = 0; c < getNumColumns(); c++) out << (c ? "," : "") << columnNames[c];
+    out << "\n";
+
+    // NaN cells in CSV: an empty soc, a literal 0 elsewhere (see VeinsInetColumnarTraceFormat.h)
+    std::vector<const char*> nullText(getNumColumns());
+    for (size_t c = 0; c < getNumColumns(); c++) nullText[c] = columnNames[c] == "soc" ? "" : "0";
+
+    char number[TraceRowEncoder::MAX_ROW_SIZE];
+    for (size_t g = 0; g < rowGroups.size(); g++) {
+        std::vector<StringColumn> strings(getNumColumns());
+        for (size_t c = 0; c < getNumColumns(); c++) {
+            if (columnTypes[c] == COLUMN_DICT || columnTypes[c] == COLUMN_NAME) strings[c] = getStrings(g, c);
+        }
+        for (size_t row = 0; row < rowGroups[g].numRows; row++) {
+            for (size_t c = 0; c < getNumColumns(); c++) {
+                if (c) out << ",";
+                switch (columnTypes[c]) {
+                    case COLUMN_F64:
+                        if (std::isnan(getDoubles(g, c)[row])) {
+                            out << nullText[c];
+                            break;
+                        }
+                        out.write(number, TraceRowEncoder::putFixed6(number, getDoubles(g, c)[row]) - number);
+                        break;
+                    case COLUMN_I32:
+                        out << getInts(g, c)[row];
+                        break;
+                    case COLUMN_BOOL:
+                        out << (getBools(g, c)[row] ? "1" : "0");
+                        break;
+                    case COLUMN_DICT:
+                    case COLUMN_NAME:
+                        out << strings[c].getValue(row);
+                        break;
+                }
+            }
+            out << "\n";
+        }
+    }
+}
@@ -0,0 +1,89 @@
+// Reader for columnar EV/CS/RSU traces (.evtc); no OMNeT++ dependency
+
+#ifndef __VEINS_INET_COLUMNARTRACEREADER_H_
+#define __VEINS_INET_COLUMNARTRACEREADER_H_
+
+#include "veins_inet/VeinsInetColumnarTraceFormat.h"
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Maps a columnar trace file and gives typed, zero-copy access to single
+ * columns of single row groups; columns that are not asked for are never
+ * touched. Throws std::runtime_error on malformed files: block sizes are
+ * checked against the row counts when the file is opened, dictionary
+ * blocks when they are first asked for.
+ *
+ *   ColumnarTraceReader trace("results/Toy_DoS_rsu0.evtc");
+ *   int ts = trace.findColumn("timestamp");
+ *   for (size_t g = 0; g < trace.getNumRowGroups(); g++) {
+ *       const double* t = trace.getDoubles(g, ts);
+ *       ...
+ *   }
+ */
+class ColumnarTraceReader {
+public:
+    // Dictionary-encoded column: value of row i is getString(getCode(i))
+    struct StringColumn {
+        uint32_t dictSize;
+        uint32_t codeWidth;        // bytes per code: 1, 2 or 4
+        const uint32_t* offsets;
+        const char* bytes;
+        const uint8_t* codes;
+        const int32_t* suffixes;   // NAME columns only, else nullptr
+
+        uint32_t getCode(size_t row) const;
+        std::string getString(uint32_t code) const { return std::string(bytes + offsets[code], offsets[code + 1] - offsets[code]); }
+        std::string getValue(size_t row) const;
+    };
+
+    explicit ColumnarTraceReader(const std::string& path);
+    ~ColumnarTraceReader();
+    ColumnarTraceReader(const ColumnarTraceReader&) = delete;
+    ColumnarTraceReader& operator=(const ColumnarTraceReader&) = delete;
+
+    size_t getNumColumns() const { return columnNames.size(); }
+    const std::string& getColumnName(size_t column) const { return columnNames[column]; }
+    ColumnarColumnType getColumnType(size_t column) const { return columnTypes[column]; }
+    /** @brief index of the named column, or -1 */
+    int findColumn(const std::string& name) const;
+
+    size_t getNumRowGroups() const { return rowGroups.size(); }
+    size_t getNumRows(size_t rowGroup) const { return rowGroups[rowGroup].numRows; }
+    size_t getTotalRows() const;
+
+    const double* getDoubles(size_t rowGroup, size_t column) const;
+    const int32_t* getInts(size_t rowGroup, size_t column) const;
+    const uint8_t* getBools(size_t rowGroup, size_t column) const;
+    StringColumn getStrings(size_t rowGroup, size_t column) const;
+
+    /** @brief write the trace back as CSV in the format of the text trace writer */
+    void writeCsv(std::ostream& out) const;
+
+protected:
+    struct RowGroup {
+        size_t numRows;
+        std::vector<const char*> blocks;
+        std::vector<size_t> blockLengths;
+    };
+
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::vector<char> buffer;    // used where mmap is not available
+
+    std::vector<std::string> columnNames;
+    std::vector<ColumnarColumnType> columnTypes;
+    std::vector<RowGroup> rowGroups;
+
+    void load(const std::string& path);
+    void parse();
+    const char* getBlock(size_t rowGroup, size_t column, ColumnarColumnType expected) const;
+};
+
+} // namespace veins
+
+#endif
@@ -0,0 +1,188 @@
+// Row-group encoder for the columnar trace format
+
+#include "veins_inet/VeinsInetColumnarTraceWriter.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+using namespace veins;
+
+namespace {
+
+void appendRaw(std::string& out, const void* data, size_t length)
+{
+    out.append(static_cast<const char*>(data), length);
+}
+
+template <typename T>
+void appendValue(std::string& out, T value)
+{
+    appendRaw(out, &value, sizeof(value));
+}
+
+void pad(std::string& out, size_t alignment)
+{
+    while (out.size() % alignment) out.push_back('\0');
+}
+
+} // namespace
+
+// ============================================================
+// Dictionary
+// ============================================================
+
+void ColumnarTraceWriter::Dictionary::add(const char* value, size_t length)
+{
+    auto it = index.find(std::string(value, length));
+    if (it == index.end()) {
+        it = index.emplace(std::string(value, length), (uint32_t) entries.size()).first;
+        entries.push_back(&it->first);
+    }
+    codes.push_back(it->second);
+}
+
+void ColumnarTraceWriter::Dictionary::encode(std::string& out) const
+{
+    uint32_t codeWidth = entries.size() <= 0x100 ? 1 : entries.size() <= 0x10000 ? 2 : 4;
+    appendValue<uint32_t>(out, entries.size());
+    appendValue<uint32_t>(out, codeWidth);
+    uint32_t offset = 0;
+    appendValue<uint32_t>(out, offset);
+    for (auto entry : entries) {
+        offset += entry->size();
+        appendValue<uint32_t>(out, offset);
+    }
+    for (auto entry : entries) out.append(*entry);
+    pad(out, 4);
+    for (uint32_t code : codes) appendRaw(out, &code, codeWidth);  // low bytes first on the (little-endian) host
+    pad(out, 4);
+}
+
+void ColumnarTraceWriter::Dictionary::clear()
+{
+    index.clear();
+    entries.clear();
+    codes.clear();
+}
+
+// ============================================================
+// Writer
+// ============================================================
+
+ColumnarTraceWriter::ColumnarTraceWriter(TraceSchema schema, size_t rowGroupSize)
+    : numColumns(schema == TRACE_SCHEMA_SOC ? COLUMNAR_TRACE_SOC_COLUMNS : COLUMNAR_TRACE_BASE_COLUMNS),
+      rowGroupSize(rowGroupSize),
+      columns(numColumns)
+{
+    for (size_t i = 0; i < numColumns; i++) {
+        columns[i].type = COLUMNAR_TRACE_COLUMNS[i].type;
+    }
+}
+
+bool ColumnarTraceWriter::writeFileHeader(FILE* file) const
+{
+    std::string header;
+    appendRaw(header, COLUMNAR_TRACE_MAGIC, sizeof(COLUMNAR_TRACE_MAGIC));
+    appendValue<uint32_t>(header, COLUMNAR_TRACE_VERSION);
+    appendValue<uint32_t>(header, numColumns);
+    for (size_t i = 0; i < numColumns; i++) {
+        const char* name = COLUMNAR_TRACE_COLUMNS[i].name;
+        appendValue<uint8_t>(header, COLUMNAR_TRACE_COLUMNS[i].type);
+        appendValue<uint8_t>(header, strlen(name));
+        header.append(name);
+    }
+    pad(header, 8);
+    return fwrite(header.data(), 1, header.size(), file) == header.size();
+}
+
+void ColumnarTraceWriter::addName(Column& column, const char* name)
+{
+    // Split "<prefix>-<number>" so the prefix dictionary stays small
+    size_t length = strlen(name);
+    const char* dash = strrchr(name, '-');
+    if (dash != nullptr) {
+        const char* digits = dash + 1;
+        size_t numDigits = name + length - digits;
+        bool numeric = numDigits > 0 && numDigits <= 9 && (digits[0] != '0' || numDigits == 1);
+        for (size_t i = 0; numeric && i < numDigits; i++) numeric = digits[i] >= '0' && digits[i] <= '9';
+        if (numeric) {
+            column.dict.add(name, digits - name);
+            column.i32.push_back(atoi(digits));
+            return;
+        }
+    }
+    column.dict.add(name, length);
+    column.i32.push_back(-1);
+}
+
+void ColumnarTraceWriter::append(const TraceRecord& r)
+{
+    Column* c = columns.data();
+    c[0].f64.push_back(r.timestamp);
+    c[1].dict.add(r.eventType, strlen(r.eventType));
+    c[2].i32.push_back(r.nodeId);
+    c[3].dict.add(r.nodeType, strlen(r.nodeType));
+    c[4].dict.add(r.commType, strlen(r.commType));
+    c[5].i32.push_back(r.packetSize);
+    c[6].f64.push_back(r.interArrivalTime);
+    c[7].f64.push_back((r.flags & TRACE_NO_BATTERY) ? std::nan("") : r.battery);
+    c[8].f64.push_back(r.energy);
+    c[9].dict.add(r.srcAddress, strlen(r.srcAddress));
+    c[10].dict.add(r.tgtAddress, strlen(r.tgtAddress));
+    c[11].flags.push_back(r.isAttacker ? 1 : 0);
+    c[12].i32.push_back(r.isCharging);
+    c[13].i32.push_back(r.sequenceNumber);
+    addName(c[14], r.packetName);
+    c[15].f64.push_back(r.posX);
+    c[16].f64.push_back(r.posY);
+    c[17].f64.push_back((r.flags & TRACE_NO_SPEED) ? std::nan("") : r.speed);
+    c[18].f64.push_back(r.txDuration);
+    c[19].i32.push_back(r.packetsSent);
+    c[20].i32.push_back(r.packetsReceived);
+    if (numColumns > COLUMNAR_TRACE_BASE_COLUMNS) c[21].f64.push_back((r.flags & TRACE_HAS_SOC) ? r.soc : std::nan(""));
+    numRows++;
+}
+
+bool ColumnarTraceWriter::writeRowGroup(FILE* file)
+{
+    if (numRows == 0) return true;
+
+    std::string header;
+    appendValue<uint32_t>(header, numRows);
+    appendValue<uint32_t>(header, 0);
+    bool written = fwrite(header.data(), 1, header.size(), file) == header.size();
+
+    for (auto& column : columns) {
+        block.clear();
+        switch (column.type) {
+            case COLUMN_F64:
+                appendRaw(block, column.f64.data(), column.f64.size() * sizeof(double));
+                column.f64.clear();
+                break;
+            case COLUMN_I32:
+                appendRaw(block, column.i32.data(), column.i32.size() * sizeof(int32_t));
+                column.i32.clear();
+                break;
+            case COLUMN_BOOL:
+                appendRaw(block, column.flags.data(), column.flags.size());
+                column.flags.clear();
+                break;
+            case COLUMN_DICT:
+                column.dict.encode(block);
+                column.dict.clear();
+                break;
+            case COLUMN_NAME:
+                column.dict.encode(block);
+                appendRaw(block, column.i32.data(), column.i32.size() * sizeof(int32_t));
+                column.dict.clear();
+                column.i32.clear();
+                break;
+        }
+        pad(block, 8);
+        uint64_t blockLength = block.size();
+        written &= fwrite(&blockLength, sizeof(blockLength), 1, file) == 1;
+        written &= fwrite(block.data(), 1, block.size(), file) == block.size();
+    }
+    numRows = 0;
+    return written;
+}
@@ -0,0 +1,64 @@
+// Row-group encoder for the columnar trace format
+
+#ifndef __VEINS_INET_COLUMNARTRACEWRITER_H_
+#define __VEINS_INET_COLUMNARTRACEWRITER_H_
+
+#include "veins_inet/VeinsInetTraceRecord.h"
+#include "veins_inet/VeinsInetColumnarTraceFormat.h"
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Collects TraceRecords column by column and appends them to a file as
+ * row groups (see VeinsInetColumnarTraceFormat.h). Used by the trace
+ * writer thread only; not thread-safe.
+ */
+class ColumnarTraceWriter {
+public:
+    ColumnarTraceWriter(TraceSchema schema, size_t rowGroupSize);
+
+    /** @brief write the file header; call once on the empty file; false if it could not be written */
+    bool writeFileHeader(FILE* file) const;
+
+    void append(const TraceRecord& r);
+
+    bool isFull() const { return numRows >= rowGroupSize; }
+
+    /** @brief append the buffered rows as one row group (no-op if empty) and reset; false if it could not be written */
+    bool writeRowGroup(FILE* file);
+
+protected:
+    struct Dictionary {
+        std::unordered_map<std::string, uint32_t> index;
+        std::vector<const std::string*> entries;
+        std::vector<uint32_t> codes;
+
+        void add(const char* value, size_t length);
+        void encode(std::string& out) const;
+        void clear();
+    };
+
+    struct Column {
+        ColumnarColumnType type;
+        std::vector<double> f64;
+        std::vector<int32_t> i32;      // I32 values, or NAME suffixes
+        std::vector<uint8_t> flags;
+        Dictionary dict;               // DICT values, or NAME prefixes
+    };
+
+    size_t numColumns;
+    size_t rowGroupSize;
+    size_t numRows = 0;
+    std::vector<Column> columns;
+    std::string block;
+
+    void addName(Column& column, const char* name);
+};
+
+} // namespace veins
+
+#endif
@@ -0,0 +1,172 @@
+// Online DoS detector over sliding-window traffic features of received packets
+
+#include "veins_inet/VeinsInetDosDetector.h"
+#include "veins_inet/ChargingProtocol_m.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace veins;
+
+void DosDetector::configure(cComponent* module)
+{
+    this->module = module;
+    alarmSignal = cComponent::registerSignal("dosAlarm");
+    latencySignal = cComponent::registerSignal("dosDetectionLatency");
+
+    window = module->par("detectorWindow");
+    if (window < 0) throw cRuntimeError("detectorWindow must not be negative");
+    int numSlots = module->par("detectorSlots");
+    if (numSlots < 1) throw cRuntimeError("detectorSlots must be at least 1");
+    slotLength = window / numSlots;
+    sizeBucket = module->par("detectorSizeBucket");
+    if (sizeBucket < 1) throw cRuntimeError("detectorSizeBucket must be at least 1B");
+    minPackets = module->par("detectorMinPackets").intValue();
+    minVotes = module->par("detectorMinVotes");
+    rateThreshold = module->par("detectorRateThreshold");
+    iatCvThreshold = module->par("detectorIatCvThreshold");
+    entropyThreshold = module->par("detectorEntropyThreshold");
+    bsmRatioThreshold = module->par("detectorBsmRatioThreshold");
+
+    int enabled = (rateThreshold > 0) + (iatCvThreshold > 0) + (entropyThreshold > 0) + (bsmRatioThreshold > 0);
+    if (isEnabled() && (minVotes < 1 || minVotes > enabled))
+        throw cRuntimeError("detectorMinVotes must be between 1 and the number of enabled thresholds (%d)", enabled);
+
+    slots.assign(isEnabled() ? numSlots : 0, Slot());
+    total = Slot();
+    currentSlot = isEnabled() ? (long) std::floor(simTime().dbl() / slotLength) : 0;
+}
+
+void DosDetector::observe(const inet::Packet* packet)
+{
+    if (!isEnabled()) return;
+    double now = simTime().dbl();
+    advance(now);
+
+    Slot& slot = slots[currentSlot % slots.size()];
+    auto payload = peekEvPayload(packet);
+    bool isBsm = payload && payload->getMessageType() == EV_MSG_BSM;
+    bool isAttack = payload && payload->getMessageType() == EV_MSG_ATTACK;
+    int bucket = std::min((int) (packet->getByteLength() / sizeBucket), SIZE_BUCKETS - 1);
+    for (Slot* s : {&slot, &total}) {
+        s->packets++;
+        s->bsms += isBsm;
+        s->attacks += isAttack;
+        s->sizes[bucket]++;
+        if (lastArrival >= 0) {
+            double iat = now - lastArrival;
+            s->iats++;
+            s->iatSum += iat;
+            s->iatSquares += iat * iat;
+        }
+    }
+    lastArrival = now;
+
+    if (isAttack && onset < 0) {
+        onset = now;
+        episodes++;
+    }
+    if (alarm || classify()) setAlarm(true, now);  // also dates an episode starting under a raised alarm
+}
+
+double DosDetector::getIatMean() const
+{
+    return total.iats > 0 ? total.iatSum / total.iats : 0;
+}
+
+double DosDetector::getIatVariance() const
+{
+    if (total.iats < 2) return 0;
+    double mean = getIatMean();
+    return std::max(total.iatSquares / total.iats - mean * mean, 0.0);
+}
+
+double DosDetector::getSizeEntropy() const
+{
+    // H = log2 n - sum(c log2 c) / n
+    if (total.packets == 0) return 0;
+    double sum = 0;
+    for (long count : total.sizes) {
+        if (count > 0) sum += count * std::log2((double) count);
+    }
+    return std::log2((double) total.packets) - sum / total.packets;
+}
+
+void DosDetector::recordScalars()
+{
+    if (!isEnabled()) return;
+    advance(simTime().dbl());
+    module->recordScalar("dosTruePositives", confusion[1][1]);
+    module->recordScalar("dosFalsePositives", confusion[0][1]);
+    module->recordScalar("dosTrueNegatives", confusion[0][0]);
+    module->recordScalar("dosFalseNegatives", confusion[1][0]);
+    module->recordScalar("dosAlarms", alarms);
+    module->recordScalar("dosAttackEpisodes", episodes);
+    module->recordScalar("dosAttackEpisodesDetected", episodesDetected);
+    if (episodesDetected > 0) {
+        module->recordScalar("dosFirstDetectionLatency", firstLatency);
+        module->recordScalar("dosMeanDetectionLatency", latencySum / episodesDetected);
+    }
+}
+
+void DosDetector::advance(double now)
+{
+    long target = (long) std::floor(now / slotLength);
+    while (currentSlot < target) {
+        if (total.packets == 0 && !alarm && onset < 0) {
+            // Nothing left in the window: the remaining slots are all quiet
+            confusion[0][0] += target - currentSlot;
+            currentSlot = target;
+            break;
+        }
+        closeSlot((currentSlot + 1) * slotLength);
+        currentSlot++;
+        Slot& oldest = slots[currentSlot % slots.size()];
+        total.packets -= oldest.packets;
+        total.bsms -= oldest.bsms;
+        total.attacks -= oldest.attacks;
+        total.iats -= oldest.iats;
+        total.iatSum -= oldest.iatSum;
+        total.iatSquares -= oldest.iatSquares;
+        for (int i = 0; i < SIZE_BUCKETS; i++) total.sizes[i] -= oldest.sizes[i];
+        if (total.packets == 0) total = Slot();  // no rounding residue in the sums
+        oldest = Slot();
+    }
+}
+
+bool DosDetector::classify() const
+{
+    if (total.packets == 0 || total.packets < minPackets) return false;
+    int votes = 0;
+    if (rateThreshold > 0 && getRate() > rateThreshold) votes++;
+    if (iatCvThreshold > 0 && total.iats >= 2 && getIatMean() > 0 && std::sqrt(getIatVariance()) / getIatMean() < iatCvThreshold) votes++;
+    if (entropyThreshold > 0 && getSizeEntropy() < entropyThreshold) votes++;
+    if (bsmRatioThreshold > 0 && getBsmRatio() < bsmRatioThreshold) votes++;
+    return votes >= minVotes;
+}
+
+void DosDetector::setAlarm(bool raised, double time)
+{
+    if (raised != alarm) {
+        alarm = raised;
+        if (raised) alarms++;
+        module->emit(alarmSignal, (long) raised);
+    }
+    if (alarm && onset >= 0 && !detected) {
+        detected = true;
+        double latency = time - onset;
+        if (episodesDetected++ == 0) firstLatency = latency;
+        latencySum += latency;
+        module->emit(latencySignal, latency);
+    }
+}
+
+void DosDetector::closeSlot(double end)
+{
+    setAlarm(classify(), end);
+    bool attack = total.attacks > 0;
+    confusion[attack][alarm]++;
+    if (!attack) {
+        onset = -1;
+        detected = false;
+    }
+}
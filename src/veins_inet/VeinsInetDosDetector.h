@@ -0,0 +1,110 @@
+// Online DoS detector over sliding-window traffic features of received packets
+
+#ifndef __VEINS_INET_DOSDETECTOR_H_
+#define __VEINS_INET_DOSDETECTOR_H_
+
+#include "veins_inet/veins_inet.h"
+#include "inet/common/packet/Packet.h"
+#include <vector>
+
+namespace veins {
+
+/**
+ * Flags DoS traffic at a receiving CS or RSU while the simulation runs,
+ * from the features the offline analysis derives from the packet_size,
+ * inter_arrival_time and communication_type trace columns: packet rate,
+ * mean and coefficient of variation of the inter-arrival time, entropy of
+ * the packet size histogram and share of BSMs. Configured from the module
+ * parameters detectorWindow (0: off), detectorSlots, detectorSizeBucket,
+ * detectorMinPackets, detectorMinVotes and the detector*Threshold ones.
+ *
+ * The window is a ring of detectorSlots slots of running sums; a packet
+ * updates its slot and the window totals, and the slot falling out of the
+ * window is subtracted once, so every packet costs O(1) however high the
+ * rate. Slots are closed on the next packet, without timers.
+ *
+ * Each enabled threshold (> 0) is a vote; with at least detectorMinVotes
+ * votes the alarm is raised, checked on every packet, and it is cleared
+ * only at a slot boundary. Raising and clearing are emitted as the
+ * module's dosAlarm signal (1/0).
+ *
+ * Ground truth: AttackPayload packets, which only apps with isAttacker
+ * send, and only during their attack. An attack episode starts with the
+ * first such packet and ends once the window holds none; its detection
+ * latency (alarm time - start) is emitted as dosDetectionLatency. Every
+ * closed slot counts as one true/false positive/negative for the
+ * dos{True,False}{Positives,Negatives} scalars.
+ */
+class VEINS_INET_API DosDetector {
+protected:
+    static const int SIZE_BUCKETS = 16;
+
+    struct Slot {
+        long packets = 0;
+        long bsms = 0;
+        long attacks = 0;  // ground truth
+        long iats = 0;  // packets with a predecessor
+        double iatSum = 0;
+        double iatSquares = 0;
+        long sizes[SIZE_BUCKETS] = {};  // packets per detectorSizeBucket bytes; the last one open-ended
+    };
+
+    cComponent* module = nullptr;
+    simsignal_t alarmSignal = 0;
+    simsignal_t latencySignal = 0;
+    double window = 0;  // 0: off
+    double slotLength = 0;
+    int sizeBucket = 0;  // bytes
+    long minPackets = 0;
+    int minVotes = 0;
+    double rateThreshold = 0;  // votes above; 0: no vote
+    double iatCvThreshold = 0;  // votes below
+    double entropyThreshold = 0;  // bits; votes below
+    double bsmRatioThreshold = 0;  // votes below
+
+    std::vector<Slot> slots;  // ring; slot n at n % detectorSlots
+    Slot total;  // sum of slots
+    long currentSlot = 0;  // floor(t / slotLength) of the newest slot
+    double lastArrival = -1;
+    bool alarm = false;
+    double onset = -1;  // first attack packet of the current episode; -1: no episode
+    bool detected = false;  // current episode has had its latency emitted
+
+    long confusion[2][2] = {};  // closed slots by [attack][alarm]
+    long alarms = 0;
+    long episodes = 0;
+    long episodesDetected = 0;
+    double firstLatency = -1;
+    double latencySum = 0;
+
+public:
+    /** @brief read the detector parameters of module, which must declare the dosAlarm and dosDetectionLatency signals */
+    void configure(cComponent* module);
+
+    bool isEnabled() const { return window > 0; }
+
+    /** @brief account packet, received now, and update the alarm */
+    void observe(const inet::Packet* packet);
+
+    bool isAlarmRaised() const { return alarm; }
+
+    /** @brief features over the current window */
+    double getRate() const { return total.packets / window; }
+    double getIatMean() const;
+    double getIatVariance() const;
+    double getSizeEntropy() const;
+    double getBsmRatio() const { return total.packets > 0 ? (double) total.bsms / total.packets : 0; }
+
+    /** @brief close the slots up to now and record the confusion matrix, alarm and latency scalars */
+    void recordScalars();
+
+protected:
+    void advance(double now);
+    bool classify() const;
+    void setAlarm(bool raised, double time);
+    void closeSlot(double end);
+};
+
+} // namespace veins
+
+#endif
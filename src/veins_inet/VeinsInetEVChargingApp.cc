@@ -7,11 +7,11 @@
 #include "inet/networklayer/common/InterfaceTable.h"
 #include "inet/networklayer/ipv4/Ipv4InterfaceData.h"
 #include "inet/transportlayer/common/L4PortTag_m.h"
-#include "inet/applications/base/ApplicationPacket_m.h"
 #include "inet/mobility/contract/IMobility.h"
 #include "veins/modules/mobility/traci/TraCICommandInterface.h"
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 #include <cmath>
 #include <climits>
 
@@ -37,8 +37,10 @@ VeinsInetEVChargingApp::VeinsInetEVChargingApp()
     rerouteScheduled = false;
     batteryDead = false;
     destIndex = 0;
-    pktsReceivedThisSec = 0;
-    secTimer = nullptr;
+    selectedCS = -1;
+    selectedCSName = "cs[0]";
+    busyResponses = 0;
+    stationSwitches = 0;
     positionInitialized = false;
     packetsSent = 0;
     packetsReceived = 0;
@@ -56,7 +58,6 @@ VeinsInetEVChargingApp::~VeinsInetEVChargingApp()
     cancelAndDelete(batteryTimer);
     cancelAndDelete(normalTrafficTimer);
     cancelAndDelete(chargeRetryTimer);
-    cancelAndDelete(secTimer);
     closeCSV();
 }
 
@@ -88,10 +89,22 @@ void VeinsInetEVChargingApp::initialize(int stage)
         chargingRange = par("chargingRange").doubleValueInUnit("m");
         physicalChargingRange = par("physicalChargingRange").doubleValueInUnit("m");
         csEdgeId = par("csEdgeId").stdstringValue();
+        csEdgeIds = cStringTokenizer(par("csEdgeIds")).asVector();
+        std::string batteryModel = par("batteryModel").stdstringValue();
+        if (batteryModel != "tick" && batteryModel != "analytic")
+            throw cRuntimeError("Unknown batteryModel '%s' (expected tick or analytic)", batteryModel.c_str());
+        analyticBattery = batteryModel == "analytic";
+
+        // Charging station selection
+        csSelection = par("csSelection").stdstringValue();
+        if (csSelection != "distance" && csSelection != "eta" && csSelection != "fixed")
+            throw cRuntimeError("Unknown csSelection '%s' (expected distance, eta or fixed)", csSelection.c_str());
+        csSearchRange = par("csSearchRange").doubleValueInUnit("m");
+        csStateTimeout = par("csStateTimeout");
+        csBusyPenalty = par("csBusyPenalty").doubleValueInUnit("s");
 
         // Rate limiting
-        maxPktPerSecond = par("maxPktPerSecond");
-        secTimer = new cMessage("secTimer");
+        rateLimiter.configure(this);
 
         // Parse destinations: space-separated edge IDs to visit after charging
         std::string destStr = par("destinations").stdstringValue();
@@ -126,6 +139,10 @@ void VeinsInetEVChargingApp::initialize(int stage)
         senderSpeedSignal = registerSignal("senderSpeed");
         txDurationSignal = registerSignal("txDuration");
 
+        // Node lookups, resolved once
+        nodeRegistry = VeinsInetNodeRegistryAccess().get();
+
+        traceFilter.configure(this);
         initCSV();
     }
     else if (stage == INITSTAGE_APPLICATION_LAYER) {
@@ -133,12 +150,34 @@ void VeinsInetEVChargingApp::initialize(int stage)
         if (isAttacker) {
             scheduleAt(simTime() + attackStartTime, attackTimer);
         }
-        // Battery update every 1 second
-        scheduleAt(simTime() + 1.0, batteryTimer);
+        // Battery update every 1 second, with the fleet's ticks, or at predicted crossings
+        if (analyticBattery) {
+            battery = AnalyticBattery(batteryCapacity, currentBatteryWh, simTime().dbl());
+            if (mobility) {
+                lastOdometer = mobility->getOdometer();
+                mobility->subscribe(inet::IMobility::mobilityStateChangedSignal, this);
+            }
+            // First check as with the tick model; later events are scheduled at the crossings
+            scheduleAt(simTime() + 1.0, batteryTimer);
+        }
+        else if ((fleetEnergy = VeinsInetFleetEnergyManagerAccess().get())) {
+            VeinsInetFleetEnergyManager::Battery battery;
+            battery.energy = currentBatteryWh;
+            battery.capacity = batteryCapacity;
+            battery.drainPerMeter = mobility ? energyPerMeter : 0;
+            battery.chargePerTick = chargingPowerW / 3600.0 * fleetEnergy->getTickInterval().dbl();
+            battery.lowSoc = socThreshold;
+            battery.detectDead = true;
+            fleetSlot = fleetEnergy->add(this, mobility, battery);
+            // Destination advances are triggered by the position updates, not by watching every tick
+            if (vehicleControl && !destList.empty()) mobility->subscribe(inet::IMobility::mobilityStateChangedSignal, this);
+            updateFleetWatch();
+        }
+        else {
+            scheduleAt(simTime() + 1.0, batteryTimer);
+        }
         // Normal BSM traffic with random offset
         scheduleAt(simTime() + 1.0 + uniform(0.0, 0.5), normalTrafficTimer);
-        // Rate-limit counter reset every 1 second
-        scheduleAt(simTime() + 1.0, secTimer);
     }
 }
 
@@ -174,6 +213,7 @@ void VeinsInetEVChargingApp::handleStartOperation(inet::LifecycleOperation* op)
 
 void VeinsInetEVChargingApp::handleMessageWhenUp(cMessage* msg)
 {
+    syncBattery();
     if (msg == attackTimer) {
         startAttack();
     }
@@ -197,15 +237,15 @@ void VeinsInetEVChargingApp::handleMessageWhenUp(cMessage* msg)
         chargingRequested = false;
         chargeResponseAvailable = false;
     }
-    else if (msg == secTimer) {
-        // Reset per-second receive counter for rate limiting
-        pktsReceivedThisSec = 0;
-        scheduleAt(simTime() + 1.0, secTimer);
-    }
     else if (msg == batteryTimer) {
-        updateBattery();
-        checkChargingNeed();
-        scheduleAt(simTime() + 1.0, batteryTimer);
+        if (analyticBattery) {
+            updateAnalyticBattery();
+        }
+        else {
+            updateBattery();
+            checkChargingNeed();
+            scheduleAt(simTime() + 1.0, batteryTimer);
+        }
     }
     else if (msg == normalTrafficTimer) {
         sendNormalTraffic();
@@ -225,14 +265,12 @@ void VeinsInetEVChargingApp::processPacket(std::shared_ptr<inet::Packet> pk)
     // Stop processing if battery is dead
     if (batteryDead) return;
 
-    // Rate limiting: drop packet if over the per-second cap
-    if (maxPktPerSecond > 0 && pktsReceivedThisSec >= maxPktPerSecond) {
+    // Rate limiting: drop packet if over the receive rate
+    if (!rateLimiter.accept(pk.get())) {
         EV_INFO << getParentModule()->getFullName()
-                << " RATE LIMIT: dropping packet (" << pktsReceivedThisSec
-                << " >= " << maxPktPerSecond << " pkts/s)" << endl;
+                << " RATE LIMIT: dropping packet (" << rateLimiter.getNumDropped() << " dropped)" << endl;
         return;
     }
-    pktsReceivedThisSec++;
 
     packetsReceived++;
     int pktSize = pk->getByteLength();
@@ -242,37 +280,35 @@ void VeinsInetEVChargingApp::processPacket(std::shared_ptr<inet::Packet> pk)
 
     // Receive energy cost
     double recvEnergy = calculatePacketEnergy(pktSize) * 0.1;
-    totalEnergyConsumed += recvEnergy;
-    currentBatteryWh -= recvEnergy;
-    if (currentBatteryWh < 0) currentBatteryWh = 0;
-    currentSoC = currentBatteryWh / batteryCapacity;
+    consumeEnergy(recvEnergy);
 
-    // Extract info from packet
-    std::string pktName = pk->getName();
-    int seqNum = packetsReceived;
-    try {
-        const auto& payload = pk->peekAtFront<inet::ApplicationPacket>();
-        seqNum = payload->getSequenceNumber();
-    } catch (...) {}
+    // Dispatch on the typed application header
+    const char* pktName = pk->getName();
+    auto payload = peekEvPayload(pk.get());
+    int seqNum = payload ? (int)payload->getSequenceNumber() : packetsReceived;
 
     auto srcAddr = pk->getTag<inet::L3AddressInd>()->getSrcAddress();
-
-    // Check if this is a ChargeResponse for us
-    std::string myName = getParentModule()->getFullName();
-    if (pktName.find("ChargeResp") != std::string::npos &&
-        pktName.find(myName) != std::string::npos) {
-        handleChargeResponse(pktName);
+    const char* myName = getParentModule()->getFullName();
+
+    const char* commType = "UNKNOWN";
+    if (payload) {
+        commType = getCommunicationType(*payload);
+        if (payload->getMessageType() == EV_MSG_CHARGE_RESPONSE) {
+            commType = "CS2EV";
+            // Every response advertises the state of its CS
+            const ChargeResponse& response = static_cast<const ChargeResponse&>(*payload);
+            updateStationState(response);
+            // Only react to responses addressed to this vehicle, from the CS it asked
+            if (payload->getVehicleId() == getParentModule()->getIndex()
+                && (response.getCsIndex() < 0 || response.getCsIndex() == selectedCS)) {
+                handleChargeResponse(response);
+            }
+        }
+        else if (payload->getMessageType() == EV_MSG_CHARGE_REQUEST) {
+            commType = "EV2CS";
+        }
     }
 
-    // Determine comm type
-    std::string commType = "UNKNOWN";
-    if (pktName.find("EV2EV") != std::string::npos)  commType = "EV2EV";
-    else if (pktName.find("EV2CS") != std::string::npos)  commType = "EV2CS";
-    else if (pktName.find("EV2RSU") != std::string::npos) commType = "EV2RSU";
-    else if (pktName.find("BSM") != std::string::npos)    commType = "BSM";
-    else if (pktName.find("ChargeResp") != std::string::npos) commType = "CS2EV";
-    else if (pktName.find("ChargeReq") != std::string::npos)  commType = "EV2CS";
-
     double txDur = (pktSize * 8.0) / 6e6;
     emit(packetSizeSignal, (long)pktSize);
     emit(interArrivalTimeSignal, iat.dbl());
@@ -282,8 +318,8 @@ void VeinsInetEVChargingApp::processPacket(std::shared_ptr<inet::Packet> pk)
     emit(txDurationSignal, txDur);
     emit(senderSpeedSignal, getMySpeed());
 
-    logCSV("RECEIVED", commType.c_str(), pktSize, iat.dbl(),
-           srcAddr.str().c_str(), myName.c_str(), seqNum, pktName.c_str());
+    logCSV(getTraceEventClass(payload.get()), "RECEIVED", commType, pktSize, iat.dbl(),
+           srcAddr.str().c_str(), myName, seqNum, pktName);
 }
 
 // ============================================================
@@ -309,20 +345,20 @@ void VeinsInetEVChargingApp::sendAttackPacket()
     if (currentBatteryWh < energy) return;
 
     if (targetType == "EV") {
-        sendToTarget("224.0.0.1", "EV2EV", "EV2EV", "ev[1]");
+        sendToTarget("224.0.0.1", "EV2EV", ATTACK_TARGET_EV, "ev[1]");
     }
     else if (targetType == "CS") {
         std::string ta = targetAddress.empty() ? "cs[0]" : targetAddress;
-        sendToTarget("224.0.0.2", "EV2CS", "EV2CS", ta.c_str());
+        sendToTarget("224.0.0.2", "EV2CS", ATTACK_TARGET_CS, ta.c_str());
     }
     else if (targetType == "RSU") {
         std::string ta = targetAddress.empty() ? "rsu[0]" : targetAddress;
-        sendToTarget("224.0.0.3", "EV2RSU", "EV2RSU", ta.c_str());
+        sendToTarget("224.0.0.3", "EV2RSU", ATTACK_TARGET_RSU, ta.c_str());
     }
 }
 
 void VeinsInetEVChargingApp::sendToTarget(const char* mcastAddr,
-    const char* prefix, const char* commType, const char* destAddr)
+    const char* prefix, AttackTarget target, const char* destAddr)
 {
     destAddress = inet::Ipv4Address(mcastAddr);
 
@@ -336,17 +372,16 @@ void VeinsInetEVChargingApp::sendToTarget(const char* mcastAddr,
     std::ostringstream name;
     name << prefix << "-" << packetsSent;
 
-    auto payload = makeShared<inet::ApplicationPacket>();
+    auto payload = makeShared<AttackPayload>();
     payload->setChunkLength(inet::B(sz));
+    payload->setVehicleId(getParentModule()->getIndex());
     payload->setSequenceNumber(packetsSent);
+    payload->setTarget(target);
     std::unique_ptr<inet::Packet> pkt(new inet::Packet(name.str().c_str(), payload));
 
     // Energy accounting
     double energy = calculatePacketEnergy(sz);
-    totalEnergyConsumed += energy;
-    currentBatteryWh -= energy;
-    if (currentBatteryWh < 0) currentBatteryWh = 0;
-    currentSoC = currentBatteryWh / batteryCapacity;
+    consumeEnergy(energy);
 
     packetsSent++;
     totalBytesSent += sz;
@@ -360,7 +395,7 @@ void VeinsInetEVChargingApp::sendToTarget(const char* mcastAddr,
     emit(socSignal, currentSoC);
     emit(energyConsumptionSignal, energy);
 
-    logCSV("SENT", commType, sz, iat.dbl(),
+    logCSV(TRACE_EVENT_ATTACK, "SENT", prefix, sz, iat.dbl(),
            getParentModule()->getFullName(), destAddr, packetsSent - 1,
            name.str().c_str());
 
@@ -379,7 +414,7 @@ void VeinsInetEVChargingApp::sendPacket(std::unique_ptr<inet::Packet> pk)
 
 void VeinsInetEVChargingApp::updateBattery()
 {
-    inet::Coord curPos = getNodePosition(getParentModule()->getFullName());
+    inet::Coord curPos = getMyPosition();
 
     // Driving energy consumption based on distance
     if (positionInitialized) {
@@ -400,8 +435,8 @@ void VeinsInetEVChargingApp::updateBattery()
         }
 
         // Log charging event to CSV so is_charging=1 is visible
-        logCSV("CHARGING", "CS2EV", 0, 1.0,
-               "cs[0]", getParentModule()->getFullName(),
+        logCSV(TRACE_EVENT_TICK, "CHARGING", "CS2EV", 0, 1.0,
+               selectedCSName.c_str(), getParentModule()->getFullName(),
                0, "ChargingTick");
     }
 
@@ -409,14 +444,20 @@ void VeinsInetEVChargingApp::updateBattery()
     if (currentBatteryWh < 0) currentBatteryWh = 0;
     currentSoC = currentBatteryWh / batteryCapacity;
 
+    batteryUpdated();
+}
+
+void VeinsInetEVChargingApp::batteryUpdated()
+{
     // Dead battery: vehicle stops permanently, no more packets
     if (!batteryDead && currentBatteryWh <= 0 && !isCharging) {
         batteryDead = true;
-        if (traciVehicle) traciVehicle->setSpeed(0);
+        if (fleetEnergy) fleetEnergy->setDead(fleetSlot);
+        if (vehicleControl) mobility->setSpeed(0);
         cancelEvent(normalTrafficTimer);
         cancelEvent(attackTimer);
         cancelEvent(packetTimer);
-        logCSV("BATTERY_DEAD", "NONE", 0, 0.0,
+        logCSV(TRACE_EVENT_CHARGING, "BATTERY_DEAD", "NONE", 0, 0.0,
                getParentModule()->getFullName(), "none", 0, "BatteryDead");
         EV_INFO << getParentModule()->getFullName() << " BATTERY DEAD at t="
                 << simTime() << endl;
@@ -429,18 +470,18 @@ void VeinsInetEVChargingApp::updateBattery()
     emit(isChargingSignal, isCharging);
 
     // Advance to next destination when route is nearly finished
-    if (!isCharging && !needsCharging && traciVehicle && !destList.empty()) {
-        auto roads = traciVehicle->getPlannedRoadIds();
-        if ((int)roads.size() <= 1) {
+    // (remaining route tracked by the mobility module from the per-step updates, no TraCI query)
+    if (!isCharging && !needsCharging && vehicleControl && !destList.empty()) {
+        if (mobility->getRemainingRoadCount() <= 1) {
             if (destIndex < (int)destList.size()) {
-                traciVehicle->changeTarget(destList[destIndex]);
+                mobility->changeTarget(destList[destIndex]);
                 EV_INFO << getParentModule()->getFullName()
                         << " advancing to destination " << destList[destIndex] << endl;
                 destIndex++;
             } else {
                 // Cycle: loop back through destinations
                 destIndex = 0;
-                traciVehicle->changeTarget(destList[destIndex]);
+                mobility->changeTarget(destList[destIndex]);
                 destIndex++;
             }
         }
@@ -452,6 +493,135 @@ void VeinsInetEVChargingApp::updateBattery()
     }
 }
 
+void VeinsInetEVChargingApp::energyTick(int events)
+{
+    // The fleet has already integrated driving and charging; log the charging
+    // tick as updateBattery() does, with the SoC from before the tick
+    destinationDue = false;
+    currentBatteryWh = fleetEnergy->getEnergy(fleetSlot);
+    if (isCharging) {
+        logCSV(TRACE_EVENT_TICK, "CHARGING", "CS2EV", 0, fleetEnergy->getTickInterval().dbl(),
+               selectedCSName.c_str(), getParentModule()->getFullName(),
+               0, "ChargingTick");
+    }
+    currentSoC = fleetEnergy->getSoc(fleetSlot);
+
+    batteryUpdated();
+    checkChargingNeed();
+    updateFleetWatch();
+}
+
+void VeinsInetEVChargingApp::updateFleetWatch()
+{
+    // Ticks without a crossing only matter while charging or heading to a
+    // charger, and for a due destination advance; the battery signals are
+    // emitted at the callbacks only
+    bool watched = !batteryDead && (isCharging || needsCharging || destinationDue);
+    fleetEnergy->setWatched(fleetSlot, watched);
+}
+
+void VeinsInetEVChargingApp::consumeEnergy(double wh)
+{
+    totalEnergyConsumed += wh;
+    if (analyticBattery) {
+        battery.drain(simTime().dbl(), wh);
+        syncBattery();
+        scheduleBatteryEvent();
+        return;
+    }
+    if (fleetEnergy) {
+        fleetEnergy->drain(fleetSlot, wh);
+        syncBattery();
+        return;
+    }
+    currentBatteryWh -= wh;
+    if (currentBatteryWh < 0) currentBatteryWh = 0;
+    currentSoC = currentBatteryWh / batteryCapacity;
+}
+
+void VeinsInetEVChargingApp::syncBattery()
+{
+    if (analyticBattery) {
+        currentBatteryWh = battery.getEnergy(simTime().dbl());
+        currentSoC = currentBatteryWh / batteryCapacity;
+        return;
+    }
+    if (!fleetEnergy || fleetSlot < 0) return;
+    currentBatteryWh = fleetEnergy->getEnergy(fleetSlot);
+    currentSoC = fleetEnergy->getSoc(fleetSlot);
+}
+
+void VeinsInetEVChargingApp::updateAnalyticBattery()
+{
+    lastBatteryCheck = simTime();
+    destinationDue = false;
+    syncBattery();
+    batteryUpdated();
+    checkChargingNeed();
+    scheduleBatteryEvent();
+}
+
+void VeinsInetEVChargingApp::scheduleBatteryEvent()
+{
+    // A dead vehicle stays parked: nothing left to check
+    if (batteryDead) {
+        cancelEvent(batteryTimer);
+        return;
+    }
+    syncBattery();
+
+    // Something to act on now: threshold crossed, battery empty, or route nearly finished
+    double now = simTime().dbl();
+    double next = INFINITY;
+    if ((!isCharging && !needsCharging && currentSoC <= socThreshold)
+        || (!batteryDead && !isCharging && currentBatteryWh <= 0) || destinationDue) {
+        next = now;
+    }
+    else {
+        // Otherwise the next predicted crossing; the level only moves continuously at a nonzero rate
+        if (isCharging) next = battery.timeToReach(now, batteryCapacity);
+        else if (!needsCharging) next = battery.timeToReach(now, socThreshold * batteryCapacity);
+        else if (!batteryDead) next = battery.timeToReach(now, 0);
+        // Heading to a charger: request and plug-in depend on the distance, checked every second
+        if (needsCharging && !isCharging) next = std::min(next, (lastBatteryCheck + 1.0).dbl());
+    }
+
+    if (next == INFINITY) {
+        cancelEvent(batteryTimer);
+        return;
+    }
+    // Round up, so the level has reached the crossing when the event arrives
+    simtime_t at = std::max(simtime_t(next), simTime());
+    if (at.dbl() < next) at += SimTime(1, (SimTimeUnit) SimTime::getScaleExp());
+    // Position updates call this about 10 times per second, mostly for an unchanged time
+    if (batteryTimer->isScheduled()) {
+        if (batteryTimer->getArrivalTime() == at) return;
+        cancelEvent(batteryTimer);
+    }
+    scheduleAt(at, batteryTimer);
+}
+
+void VeinsInetEVChargingApp::receiveSignal(cComponent* source, simsignal_t signalID, cObject* obj, cObject* details)
+{
+    Enter_Method_Silent();
+
+    // Driving energy of the distance since the last position update (the fleet integrates its own)
+    if (analyticBattery) {
+        double odometer = mobility->getOdometer();
+        double driven = odometer - lastOdometer;
+        lastOdometer = odometer;
+        if (driven > 0) consumeEnergy(driven * energyPerMeter);
+    }
+
+    // The destination advance of batteryUpdated() runs at a battery event or fleet tick; trigger one when it is due
+    if (!destinationDue && !batteryDead && !isCharging && !needsCharging && vehicleControl && !destList.empty()
+        && mobility->getRemainingRoadCount() <= 1) {
+        destinationDue = true;
+        if (analyticBattery) scheduleBatteryEvent();
+        else if (fleetEnergy) updateFleetWatch();
+    }
+}
+
 void VeinsInetEVChargingApp::checkChargingNeed()
 {
     if (isCharging) return;
@@ -463,17 +633,21 @@ void VeinsInetEVChargingApp::checkChargingNeed()
 
     if (!needsCharging) return;
 
-    double dist = distanceTo("cs[0]");
+    // Pick a station once per charging need; a BUSY answer may move us to another one
+    if (selectedCS < 0) selectChargingStation();
+
+    double dist = distanceTo(selectedCSName.c_str());
 
     // --- Reroute to CS (called once, or retried if reroute didn't take) ---
     // Use TraCI changeTarget so SUMO computes the shortest path to the CS edge.
-    if (traciVehicle && (!rerouteScheduled || dist > chargingRange * 2)) {
-        traciVehicle->changeTarget(csEdgeId);
+    if (vehicleControl && (!rerouteScheduled || dist > chargingRange * 2)) {
+        const std::string& edge = getStationEdge(selectedCS);
+        mobility->changeTarget(edge);
         rerouteScheduled = true;
         // Show white in SUMO: "heading to charger"
-        traciVehicle->setColor(TraCIColor(255, 255, 255, 255));
+        if (!headless) mobility->setColor(TraCIColor(255, 255, 255, 255));
         EV_INFO << getParentModule()->getFullName()
-                << " rerouted to CS edge=" << csEdgeId
+                << " rerouted to " << selectedCSName << " edge=" << edge
                 << "  dist=" << dist << "m  SoC=" << (currentSoC * 100) << "%" << endl;
     }
 
@@ -481,10 +655,10 @@ void VeinsInetEVChargingApp::checkChargingNeed()
     if (dist < chargingRange && !chargingRequested) {
         EV_INFO << getParentModule()->getFullName()
                 << " in wireless range (" << dist << "m) -> sending ChargeReq" << endl;
-        logCSV("WAITING", "ChargeReq", 0, 0.0,
-               getParentModule()->getFullName(), "cs[0]", 0, "WaitingForSlot");
+        logCSV(TRACE_EVENT_CHARGING, "WAITING", "ChargeReq", 0, 0.0,
+               getParentModule()->getFullName(), selectedCSName.c_str(), 0, "WaitingForSlot");
         sendChargeRequest();
-        if (traciVehicle) traciVehicle->setSpeed(-1); // keep moving
+        if (vehicleControl) mobility->setSpeed(-1); // keep moving
         return;
     }
 
@@ -507,9 +681,12 @@ void VeinsInetEVChargingApp::sendChargeRequest()
          << std::setprecision(2) << currentSoC;
 
     int sz = 100; // Small control packet
-    auto payload = makeShared<inet::ApplicationPacket>();
+    auto payload = makeShared<ChargeRequest>();
     payload->setChunkLength(inet::B(sz));
+    payload->setVehicleId(getParentModule()->getIndex());
     payload->setSequenceNumber(packetsSent);
+    payload->setSoc(currentSoC);
+    payload->setCsIndex(selectedCS);
     std::unique_ptr<inet::Packet> pkt(new inet::Packet(name.str().c_str(), payload));
 
     packetsSent++;
@@ -518,11 +695,11 @@ void VeinsInetEVChargingApp::sendChargeRequest()
     // Send to CS multicast group
     destAddress = inet::Ipv4Address("224.0.0.2");
 
-    logCSV("SENT", "ChargeReq", sz, 0.0,
-           myName.c_str(), "cs[0]", packetsSent - 1, name.str().c_str());
+    logCSV(TRACE_EVENT_CHARGING, "SENT", "ChargeReq", sz, 0.0,
+           myName.c_str(), selectedCSName.c_str(), packetsSent - 1, name.str().c_str());
 
-    EV_INFO << myName << " sent ChargeRequest (SoC=" << (currentSoC * 100)
-            << "%, dist=" << distanceTo("cs[0]") << "m)" << endl;
+    EV_INFO << myName << " sent ChargeRequest to " << selectedCSName << " (SoC=" << (currentSoC * 100)
+            << "%, dist=" << distanceTo(selectedCSName.c_str()) << "m)" << endl;
     socket.sendTo(pkt.release(), destAddress, portNumber);
 
     // Schedule retry: if no response in 5s, reset chargingRequested
@@ -530,11 +707,11 @@ void VeinsInetEVChargingApp::sendChargeRequest()
     scheduleAt(simTime() + 5.0, chargeRetryTimer);
 }
 
-void VeinsInetEVChargingApp::handleChargeResponse(const std::string& pktName)
+void VeinsInetEVChargingApp::handleChargeResponse(const ChargeResponse& response)
 {
     cancelEvent(chargeRetryTimer);
 
-    if (pktName.find("AVAILABLE") != std::string::npos) {
+    if (response.getStatus() == CHARGE_STATUS_AVAILABLE) {
         // CS has a free slot. Set flag and keep driving to get within physical range.
         chargeResponseAvailable = true;
         EV_INFO << getParentModule()->getFullName()
@@ -542,20 +719,33 @@ void VeinsInetEVChargingApp::handleChargeResponse(const std::string& pktName)
                 << physicalChargingRange << "m required)" << endl;
 
         // Keep vehicle moving toward CS (do NOT stop here)
-        if (traciVehicle) {
-            traciVehicle->setSpeed(-1); // restore SUMO default speed
+        if (vehicleControl) {
+            mobility->setSpeed(-1); // restore SUMO default speed
         }
         // checkChargingNeed() will call beginCharging() once dist < physicalChargingRange
     }
-    else if (pktName.find("BUSY") != std::string::npos) {
-        // CS is full. Reset so we can retry after 3 seconds.
+    else {
         chargeResponseAvailable = false;
+        busyResponses++;
+
+        // The CS now advertises itself as full; a free one in range is worth the detour
+        if (selectChargingStation()) {
+            chargingRequested = false;  // ask the new station once in range
+            EV_INFO << getParentModule()->getFullName()
+                    << " received BUSY -> switching to " << selectedCSName << endl;
+            if (vehicleControl) {
+                mobility->setSpeed(-1);
+            }
+            return;
+        }
+
+        // CS is full. Reset so we can retry after 3 seconds.
         EV_INFO << getParentModule()->getFullName()
                 << " received BUSY -> keep driving, retry in 3s" << endl;
 
         // Keep vehicle moving toward CS while waiting for free slot
-        if (traciVehicle) {
-            traciVehicle->setSpeed(-1);
+        if (vehicleControl) {
+            mobility->setSpeed(-1);
         }
         scheduleAt(simTime() + 3.0, chargeRetryTimer);
     }
@@ -564,17 +754,19 @@ void VeinsInetEVChargingApp::handleChargeResponse(const std::string& pktName)
 void VeinsInetEVChargingApp::beginCharging()
 {
     isCharging = true;
+    if (fleetEnergy) fleetEnergy->setCharging(fleetSlot, true);
+    if (analyticBattery) battery.setRate(simTime().dbl(), chargingPowerW / 3600.0);  // Wh per second
     emit(isChargingSignal, true);
 
     // Stop the vehicle in SUMO
-    if (traciVehicle) {
-        traciVehicle->setSpeed(0);
+    if (vehicleControl) {
+        mobility->setSpeed(0);
         // Blue = charging
-        traciVehicle->setColor(TraCIColor(0, 100, 255, 255));
+        if (!headless) mobility->setColor(TraCIColor(0, 100, 255, 255));
     }
 
-    logCSV("CHARGE_START", "CS2EV", 0, 0.0,
-           "cs[0]", getParentModule()->getFullName(),
+    logCSV(TRACE_EVENT_CHARGING, "CHARGE_START", "CS2EV", 0, 0.0,
+           selectedCSName.c_str(), getParentModule()->getFullName(),
            0, "ChargeStart");
 
     EV_INFO << getParentModule()->getFullName()
@@ -584,34 +776,39 @@ void VeinsInetEVChargingApp::beginCharging()
 void VeinsInetEVChargingApp::endCharging()
 {
     isCharging = false;
+    if (fleetEnergy) fleetEnergy->setCharging(fleetSlot, false);
+    if (analyticBattery) battery.setRate(simTime().dbl(), 0);
     needsCharging = false;
     chargingRequested = false;
     chargeResponseAvailable = false;
     rerouteScheduled = false;  // allow rerouting next time SoC drops
     emit(isChargingSignal, false);
 
-    logCSV("CHARGE_END", "CS2EV", 0, 0.0,
-           "cs[0]", getParentModule()->getFullName(),
+    logCSV(TRACE_EVENT_CHARGING, "CHARGE_END", "CS2EV", 0, 0.0,
+           selectedCSName.c_str(), getParentModule()->getFullName(),
            0, "ChargeEnd");
 
     // Resume speed + restore original color
-    if (traciVehicle) {
-        traciVehicle->setSpeed(-1);
+    if (vehicleControl) {
+        mobility->setSpeed(-1);
         // Restore color: red for attacker, yellow for normal
-        if (isAttacker)
-            traciVehicle->setColor(TraCIColor(255, 0, 0, 255));
-        else
-            traciVehicle->setColor(TraCIColor(255, 255, 0, 255));
+        if (!headless) {
+            if (isAttacker)
+                mobility->setColor(TraCIColor(255, 0, 0, 255));
+            else
+                mobility->setColor(TraCIColor(255, 255, 0, 255));
+        }
     }
 
     sendChargeComplete();
+    selectedCS = -1;  // choose again on the next charging need
     EV_INFO << getParentModule()->getFullName() << " DONE charging, SoC="
             << (currentSoC * 100) << "%" << endl;
 
     // Route to next destination so vehicle doesn't disappear at CS edge
-    if (traciVehicle && !destList.empty()) {
+    if (vehicleControl && !destList.empty()) {
         if (destIndex >= (int)destList.size()) destIndex = 0;  // cycle
-        traciVehicle->changeTarget(destList[destIndex]);
+        mobility->changeTarget(destList[destIndex]);
         EV_INFO << getParentModule()->getFullName()
                 << " post-charge -> heading to " << destList[destIndex] << endl;
         destIndex++;
@@ -625,9 +822,11 @@ void VeinsInetEVChargingApp::sendChargeComplete()
     name << "ChargeDone-" << myName;
 
     int sz = 50;
-    auto payload = makeShared<inet::ApplicationPacket>();
+    auto payload = makeShared<ChargeDone>();
     payload->setChunkLength(inet::B(sz));
+    payload->setVehicleId(getParentModule()->getIndex());
     payload->setSequenceNumber(packetsSent);
+    payload->setCsIndex(selectedCS);
     std::unique_ptr<inet::Packet> pkt(new inet::Packet(name.str().c_str(), payload));
 
     packetsSent++;
@@ -635,12 +834,106 @@ void VeinsInetEVChargingApp::sendChargeComplete()
 
     destAddress = inet::Ipv4Address("224.0.0.2");
 
-    logCSV("SENT", "ChargeDone", sz, 0.0,
-           myName.c_str(), "cs[0]", packetsSent - 1, name.str().c_str());
+    logCSV(TRACE_EVENT_CHARGING, "SENT", "ChargeDone", sz, 0.0,
+           myName.c_str(), selectedCSName.c_str(), packetsSent - 1, name.str().c_str());
 
     socket.sendTo(pkt.release(), destAddress, portNumber);
 }
 
+// ============================================================
+// Charging station selection
+// ============================================================
+
+void VeinsInetEVChargingApp::updateStationState(const ChargeResponse& response)
+{
+    int index = response.getCsIndex();
+    if (index < 0) return;
+    if (index >= (int)stationStates.size()) stationStates.resize(index + 1);
+
+    StationState& state = stationStates[index];
+    state.slotsInUse = response.getSlotsInUse();
+    state.maxSlots = response.getMaxSlots();
+    state.soc = response.getCsSoc();
+    state.updated = simTime();
+}
+
+bool VeinsInetEVChargingApp::isStationFull(int csIndex)
+{
+    if (csIndex >= (int)stationStates.size()) return false;
+    const StationState& state = stationStates[csIndex];
+    if (state.maxSlots < 0 || simTime() - state.updated > csStateTimeout) return false;  // unknown or stale
+    return state.slotsInUse >= state.maxSlots || state.soc <= 0;
+}
+
+double VeinsInetEVChargingApp::getStationCost(int csIndex, double distance)
+{
+    if (csSelection != "eta") return distance;
+
+    // Driving time at the current speed (at least 5 m/s, e.g. while waiting at lights)
+    double eta = distance / std::max(getMySpeed(), 5.0);
+    return isStationFull(csIndex) ? eta + csBusyPenalty : eta;
+}
+
+const std::string& VeinsInetEVChargingApp::getStationEdge(int csIndex)
+{
+    return csIndex >= 0 && csIndex < (int)csEdgeIds.size() ? csEdgeIds[csIndex] : csEdgeId;
+}
+
+bool VeinsInetEVChargingApp::selectChargingStation()
+{
+    int best = 0;
+    if (csSelection != "fixed") {
+        // Candidates: stations within csSearchRange, else the nearest one
+        std::vector<int> candidates;
+        if (nodeRegistry) {
+            inet::Coord myPos = getMyPosition();
+            std::vector<cModule*> stations;
+            nodeRegistry->getNodesInRange("cs", myPos, csSearchRange, stations);
+            if (stations.empty()) {
+                if (cModule* nearest = nodeRegistry->getNearestNode("cs", myPos)) stations.push_back(nearest);
+            }
+            for (cModule* station : stations) candidates.push_back(station->getIndex());
+        }
+        else {
+            // No spatial index: every cs[i] of the network
+            for (int i = 0; VeinsInetNodeRegistry::resolveMobility(("cs[" + std::to_string(i) + "]").c_str()); i++)
+                candidates.push_back(i);
+        }
+
+        // "distance": free stations first, then the nearest; "eta": lowest ETA incl. busy penalty.
+        // Ties go to the lower index, so the choice does not depend on the index's internal order.
+        best = -1;
+        double bestCost = 0;
+        bool bestFull = false;
+        for (int index : candidates) {
+            double cost = getStationCost(index, distanceTo(("cs[" + std::to_string(index) + "]").c_str()));
+            bool full = isStationFull(index);
+            bool better;
+            if (best < 0) better = true;
+            else if (csSelection == "distance" && full != bestFull) better = !full;
+            else better = cost < bestCost || (cost == bestCost && index < best);
+            if (better) {
+                best = index;
+                bestCost = cost;
+                bestFull = full;
+            }
+        }
+        if (best < 0) best = 0;
+
+        // All candidates full: stay with the current station instead of hopping between them
+        if (bestFull && selectedCS >= 0) best = selectedCS;
+    }
+
+    if (best == selectedCS) return false;
+    if (selectedCS >= 0) stationSwitches++;
+    selectedCS = best;
+    selectedCSName = "cs[" + std::to_string(best) + "]";
+    rerouteScheduled = false;
+    EV_INFO << getParentModule()->getFullName() << " selected charging station " << selectedCSName
+            << " (" << csSelection << ")" << endl;
+    return true;
+}
+
 // ============================================================
 // Normal BSM traffic
 // ============================================================
@@ -659,15 +952,13 @@ void VeinsInetEVChargingApp::sendNormalTraffic()
     std::ostringstream name;
     name << "BSM-" << packetsSent;
 
-    auto payload = makeShared<inet::ApplicationPacket>();
+    auto payload = makeShared<Bsm>();
     payload->setChunkLength(inet::B(sz));
+    payload->setVehicleId(getParentModule()->getIndex());
     payload->setSequenceNumber(packetsSent);
     std::unique_ptr<inet::Packet> pkt(new inet::Packet(name.str().c_str(), payload));
 
-    totalEnergyConsumed += energy;
-    currentBatteryWh -= energy;
-    if (currentBatteryWh < 0) currentBatteryWh = 0;
-    currentSoC = currentBatteryWh / batteryCapacity;
+    consumeEnergy(energy);
 
     packetsSent++;
     totalBytesSent += sz;
@@ -682,18 +973,18 @@ void VeinsInetEVChargingApp::sendNormalTraffic()
     emit(energyConsumptionSignal, energy);
     emit(packetSentSignal, (long)packetsSent);
 
-    logCSV("SENT", "BSM", sz, iat.dbl(),
+    logCSV(TRACE_EVENT_BSM, "SENT", "BSM", sz, iat.dbl(),
            getParentModule()->getFullName(), "broadcast",
            packetsSent - 1, name.str().c_str());
 
     socket.sendTo(pkt.release(), bsmDest, portNumber);
 
     if (!isCharging && !needsCharging && (packetsSent % 2 == 0)) {
-            if (traciVehicle) {
+            if (vehicleControl) {
                 const char* randomEdges[] = {"A0B0", "A2B2"};
                 int randomIndex = intuniform(0, 1);
 
-                traciVehicle->changeTarget(randomEdges[randomIndex]);
+                mobility->changeTarget(randomEdges[randomIndex]);
             }
     }
 }
@@ -704,13 +995,14 @@ void VeinsInetEVChargingApp::sendNormalTraffic()
 
 void VeinsInetEVChargingApp::setSumoColor()
 {
-    if (!traciVehicle) return;
+    // Cosmetic only: skipped in headless runs
+    if (!traciVehicle || headless) return;
 
     if (sumoColor == "red") {
-        traciVehicle->setColor(TraCIColor(255, 0, 0, 255));
+        mobility->setColor(TraCIColor(255, 0, 0, 255));
     }
     else {
-        traciVehicle->setColor(TraCIColor(255, 255, 0, 255));
+        mobility->setColor(TraCIColor(255, 255, 0, 255));
     }
 }
 
@@ -731,24 +1023,25 @@ double VeinsInetEVChargingApp::calculatePacketEnergy(int pktSize)
 
 inet::Coord VeinsInetEVChargingApp::getNodePosition(const char* nodeName)
 {
-    // Search from network level (ev[0], cs[0], rsu[0] are direct children)
-    cModule* mod = getSystemModule()->getModuleByPath(nodeName);
-    if (!mod) mod = getParentModule(); // fallback: own EV module
-
-    auto mob = dynamic_cast<inet::IMobility*>(mod->getSubmodule("mobility"));
+    // Network level node (cs[0], rsu[0] are direct children); static ones are cached by the registry
+    inet::IMobility* mob = nodeRegistry ? nodeRegistry->getMobility(nodeName) : VeinsInetNodeRegistry::resolveMobility(nodeName);
+    if (!mob) mob = mobility; // fallback: own EV module
     return mob ? mob->getCurrentPosition() : inet::Coord::ZERO;
 }
 
+inet::Coord VeinsInetEVChargingApp::getMyPosition()
+{
+    return mobility ? mobility->getCurrentPosition() : inet::Coord::ZERO;
+}
+
 double VeinsInetEVChargingApp::getMySpeed()
 {
-    auto mob = dynamic_cast<inet::IMobility*>(
-        getParentModule()->getSubmodule("mobility"));
-    return mob ? mob->getCurrentVelocity().length() : 0.0;
+    return mobility ? mobility->getCurrentVelocity().length() : 0.0;
 }
 
 double VeinsInetEVChargingApp::distanceTo(const char* nodeName)
 {
-    inet::Coord myPos = getNodePosition(getParentModule()->getFullName());
+    inet::Coord myPos = getMyPosition();
     inet::Coord tgtPos = getNodePosition(nodeName);
     return myPos.distance(tgtPos);
 }
@@ -759,64 +1052,70 @@ double VeinsInetEVChargingApp::distanceTo(const char* nodeName)
 
 void VeinsInetEVChargingApp::initCSV()
 {
+    // One shared trace for the whole network if the scenario has a traceCollector
+    if (VeinsInetTraceCollector* collector = VeinsInetTraceCollectorAccess().get()) {
+        traceChannel = collector->acquire(getParentModule()->getName());
+        traceShared = true;
+        return;
+    }
+
     const char* cfg = getEnvir()->getConfigEx()->getActiveConfigName();
     std::ostringstream fn;
-    fn << "results/" << cfg << "_ev" << getParentModule()->getIndex() << ".csv";
-    csvFilePath = fn.str();
-    csvFile.open(csvFilePath.c_str());
-
-    if (csvFile.is_open()) {
-        csvFile << "timestamp,event_type,node_id,node_type,communication_type,"
-                << "packet_size,inter_arrival_time,battery_level,"
-                << "energy_consumption,source_address,target_address,"
-                << "is_attacker,is_charging,"
-                << "sequence_number,packet_name,"
-                << "pos_x,pos_y,speed,"
-                << "tx_duration_est,"
-                << "cumulative_packets_sent,cumulative_packets_received,"
-                << "soc\n";
-    }
+    TraceFormat format = TraceSink::parseFormat(par("traceFormat"));
+    TraceCompression compression = TraceSink::parseCompression(par("traceCompression"));
+    fn << cfg << "_ev" << getParentModule()->getIndex()
+       << TraceSink::getFileExtension(format, compression);
+    csvFilePath = TraceSink::getResultPath(fn.str());
+    traceChannel = TraceSink::getInstance().openChannel(csvFilePath, TRACE_SCHEMA_SOC, format, compression, par("traceCompressionLevel"));
 }
 
-void VeinsInetEVChargingApp::logCSV(const char* eventType, const char* commType,
+void VeinsInetEVChargingApp::logCSV(TraceEventClass eventClass, const char* eventType, const char* commType,
     int pktSize, double iat, const char* srcAddr, const char* tgtAddr,
     int seqNum, const char* pktName)
 {
-    if (!csvFile.is_open()) return;
-
-    inet::Coord pos = getNodePosition(getParentModule()->getFullName());
-    double spd = getMySpeed();
-    double txDur = (pktSize * 8.0) / 6e6;
-
-    csvFile << std::fixed << std::setprecision(6)
-            << simTime().dbl() << ","
-            << eventType << ","
-            << getParentModule()->getIndex() << ","
-            << getParentModule()->getName() << ","
-            << commType << ","
-            << pktSize << ","
-            << iat << ","
-            << currentBatteryWh << ","
-            << totalEnergyConsumed << ","
-            << srcAddr << ","
-            << tgtAddr << ","
-            << (isAttacker ? "1" : "0") << ","
-            << (isCharging ? "1" : "0") << ","
-            << seqNum << ","
-            << pktName << ","
-            << pos.x << ","
-            << pos.y << ","
-            << spd << ","
-            << txDur << ","
-            << packetsSent << ","
-            << packetsReceived << ","
-            << currentSoC << "\n";
-    csvFile.flush();
+    // Filter first: rejected rows cost no formatting
+    if (!traceChannel || !traceFilter.accept(eventClass)) return;
+
+    inet::Coord pos = getMyPosition();
+
+    TraceRecord& r = TraceSink::getInstance().beginRecord(traceChannel);
+    r.flags = TRACE_HAS_SOC;
+    r.timestamp = simTime().dbl();
+    TraceRecord::copy(r.eventType, eventType);
+    r.nodeId = getParentModule()->getIndex();
+    TraceRecord::copy(r.nodeType, getParentModule()->getName());
+    TraceRecord::copy(r.commType, commType);
+    r.packetSize = pktSize;
+    r.interArrivalTime = iat;
+    r.battery = currentBatteryWh;
+    r.energy = totalEnergyConsumed + (fleetEnergy && fleetSlot >= 0 ? fleetEnergy->getDriveEnergy(fleetSlot) : 0);
+    TraceRecord::copy(r.srcAddress, srcAddr);
+    TraceRecord::copy(r.tgtAddress, tgtAddr);
+    r.isAttacker = isAttacker;
+    r.isCharging = isCharging ? 1 : 0;
+    r.sequenceNumber = seqNum;
+    TraceRecord::copy(r.packetName, pktName);
+    r.posX = pos.x;
+    r.posY = pos.y;
+    r.speed = getMySpeed();
+    r.txDuration = (pktSize * 8.0) / 6e6;
+    r.packetsSent = packetsSent;
+    r.packetsReceived = packetsReceived;
+    r.soc = currentSoC;
+    TraceSink::getInstance().commitRecord();
 }
 
 void VeinsInetEVChargingApp::closeCSV()
 {
-    if (csvFile.is_open()) csvFile.close();
+    if (traceChannel) {
+        if (!traceShared) {
+            TraceSink::getInstance().closeChannel(traceChannel);
+        }
+        else if (VeinsInetTraceCollector* collector = VeinsInetTraceCollectorAccess().get()) {
+            collector->release(traceChannel);
+        }
+        traceChannel = nullptr;
+    }
 }
 
 // ============================================================
@@ -827,13 +1126,27 @@ void VeinsInetEVChargingApp::finish()
 {
     VeinsInetApplicationBase::finish();
 
+    syncBattery();
+    if (mobility && mobility->isSubscribed(inet::IMobility::mobilityStateChangedSignal, this))
+        mobility->unsubscribe(inet::IMobility::mobilityStateChangedSignal, this);
+    double driveEnergy = 0;
+    if (fleetEnergy && fleetSlot >= 0) {
+        driveEnergy = fleetEnergy->getDriveEnergy(fleetSlot);
+        fleetEnergy->remove(fleetSlot);
+        fleetSlot = -1;
+    }
+
     recordScalar("packetsSent", packetsSent);
     recordScalar("packetsReceived", packetsReceived);
-    recordScalar("totalEnergyConsumed", totalEnergyConsumed);
+    recordScalar("totalEnergyConsumed", totalEnergyConsumed + driveEnergy);
     recordScalar("finalBatteryWh", currentBatteryWh);
     recordScalar("finalSoC", currentSoC);
     recordScalar("totalBytesSent", (double)totalBytesSent);
     recordScalar("totalBytesReceived", (double)totalBytesReceived);
+    recordScalar("traceRowsFiltered", traceFilter.getNumRejected());
+    recordScalar("chargeBusyResponses", busyResponses);
+    recordScalar("chargeStationSwitches", stationSwitches);
+    rateLimiter.recordScalars();
 
     double dur = simTime().dbl();
     recordScalar("packetSendRate", dur > 0 ? packetsSent / dur : 0);
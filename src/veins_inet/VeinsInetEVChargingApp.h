@@ -3,10 +3,17 @@
 #ifndef __VEINS_INET_EVCHARGINGAPP_H_
 #define __VEINS_INET_EVCHARGINGAPP_H_
 
+#include "veins_inet/VeinsInetAnalyticBattery.h"
 #include "veins_inet/VeinsInetApplicationBase.h"
+#include "veins_inet/VeinsInetFleetEnergyManager.h"
+#include "veins_inet/VeinsInetNodeRegistry.h"
+#include "veins_inet/VeinsInetRateLimiter.h"
+#include "veins_inet/VeinsInetTraceCollector.h"
+#include "veins_inet/VeinsInetTraceFilter.h"
+#include "veins_inet/VeinsInetTraceSink.h"
+#include "veins_inet/ChargingProtocol_m.h"
 #include "inet/common/geometry/common/Coord.h"
 #include "veins/modules/mobility/traci/TraCIColor.h"
-#include <fstream>
 #include <vector>
 #include <string>
 
@@ -15,7 +22,7 @@ using namespace inet;
 
 namespace veins {
 
-class VEINS_INET_API VeinsInetEVChargingApp : public VeinsInetApplicationBase
+class VEINS_INET_API VeinsInetEVChargingApp : public VeinsInetApplicationBase, public VeinsInetFleetEnergyManager::Client, public cListener
 {
 protected:
     // Attack config
@@ -37,6 +44,24 @@ protected:
     double chargingRange;           // meters: wireless range to send ChargeReq
     double physicalChargingRange;   // meters: must be THIS close to physically charge
     std::string csEdgeId;           // SUMO edge id at the CS location (for rerouting)
+    std::vector<std::string> csEdgeIds;  // per-CS edge ids by CS index; csEdgeId where missing
+
+    // Charging station selection
+    struct StationState {
+        int slotsInUse = -1;        // -1: nothing advertised yet
+        int maxSlots = -1;
+        double soc = -1;
+        simtime_t updated;
+    };
+    std::string csSelection;        // "distance", "eta" or "fixed" (always cs[0])
+    double csSearchRange;           // meters: candidate stations around the EV
+    simtime_t csStateTimeout;       // advertised CS state older than this is ignored
+    double csBusyPenalty;           // seconds added to the ETA of a full station
+    std::vector<StationState> stationStates;  // by CS index, from overheard ChargeResponses
+    int selectedCS;                 // CS index, -1 if none selected
+    std::string selectedCSName;     // "cs[<selectedCS>]", for logs
+    int busyResponses;
+    int stationSwitches;
 
     // Charging state machine
     bool needsCharging;
@@ -45,6 +70,17 @@ protected:
     bool isCharging;
     bool rerouteScheduled;          // true after we issued changeTarget() to CS
 
+    // Event-driven battery (batteryModel = "analytic")
+    bool analyticBattery = false;
+    AnalyticBattery battery;
+    double lastOdometer = 0;        // mobility's odometer at the last position update
+    bool destinationDue = false;    // route nearly finished; advance at the next battery event (or fleet tick)
+    simtime_t lastBatteryCheck;     // last battery event, for the 1 s check while heading to a charger
+
+    // Fleet-wide battery ticks (replace batteryTimer when the network has a fleetEnergy module)
+    VeinsInetFleetEnergyManager* fleetEnergy = nullptr;
+    int fleetSlot = -1;
+
     // Dead battery
     bool batteryDead;               // true when Wh reaches 0; vehicle stops permanently
 
@@ -53,9 +89,7 @@ protected:
     int destIndex;                      // next waypoint index
 
     // Rate limiting
-    int maxPktPerSecond;            // max recv pkts/s (0=unlimited)
-    int pktsReceivedThisSec;        // rolling counter, reset every 1s
-    cMessage* secTimer;             // 1-second reset timer
+    RateLimiter rateLimiter;
 
     // Display
     std::string sumoColor;
@@ -98,9 +132,14 @@ protected:
     long totalBytesReceived;
 
     // CSV
-    std::ofstream csvFile;
+    TraceChannel* traceChannel = nullptr;
+    bool traceShared = false;   // traceChannel belongs to the network's traceCollector
+    TraceFilter traceFilter;
     std::string csvFilePath;
 
+    // Node lookups (own node: VeinsInetApplicationBase::mobility)
+    VeinsInetNodeRegistry* nodeRegistry = nullptr;  // nullptr: resolve nodes without cache
+
 public:
     VeinsInetEVChargingApp();
     virtual ~VeinsInetEVChargingApp();
@@ -119,13 +158,26 @@ protected:
     void stopAttack();
     void sendAttackPacket();
     void sendToTarget(const char* mcastAddr, const char* prefix,
-                      const char* commType, const char* destAddr);
+                      AttackTarget target, const char* destAddr);
 
     // Battery & Charging
     void updateBattery();
+    void batteryUpdated();
+    void consumeEnergy(double wh);
+    void syncBattery();
+    void updateFleetWatch();
+    virtual void energyTick(int events) override;
+    void updateAnalyticBattery();
+    void scheduleBatteryEvent();
+    virtual void receiveSignal(cComponent* source, simsignal_t signalID, cObject* obj, cObject* details) override;
     void checkChargingNeed();
     void sendChargeRequest();
-    void handleChargeResponse(const std::string& pktName);
+    void handleChargeResponse(const ChargeResponse& response);
+    void updateStationState(const ChargeResponse& response);
+    bool selectChargingStation();
+    double getStationCost(int csIndex, double distance);
+    bool isStationFull(int csIndex);
+    const std::string& getStationEdge(int csIndex);
     void beginCharging();
     void endCharging();
     void sendChargeComplete();
@@ -137,12 +189,13 @@ protected:
     void setSumoColor();
     double calculatePacketEnergy(int pktSize);
     inet::Coord getNodePosition(const char* nodeName);
+    inet::Coord getMyPosition();
     double getMySpeed();
     double distanceTo(const char* nodeName);
 
     // CSV
     void initCSV();
-    void logCSV(const char* eventType, const char* commType, int pktSize,
+    void logCSV(TraceEventClass eventClass, const char* eventType, const char* commType, int pktSize,
                 double iat, const char* srcAddr, const char* tgtAddr,
                 int seqNum, const char* pktName);
     void closeCSV();
@@ -7,11 +7,11 @@
 #include "inet/networklayer/common/InterfaceTable.h"
 #include "inet/networklayer/ipv4/Ipv4InterfaceData.h"
 #include "inet/transportlayer/common/L4PortTag_m.h"
-#include "inet/applications/base/ApplicationPacket_m.h"
 #include <sstream>
 #include <iomanip>
 #include <climits>
 #include <cmath>
+#include <limits>
 #include "inet/mobility/contract/IMobility.h"
 
 using namespace veins;
@@ -93,6 +93,10 @@ void VeinsInetEVDoSApplication::initialize(int stage)
         txDurationSignal = registerSignal("txDuration");
         
         // Initialize CSV logging
+        // Node lookups, resolved once
+        nodeRegistry = VeinsInetNodeRegistryAccess().get();
+        
+        traceFilter.configure(this);
         initializeCSVLogging();
     }
     else if (stage == INITSTAGE_APPLICATION_LAYER) {
@@ -107,8 +111,21 @@ void VeinsInetEVDoSApplication::initialize(int stage)
             scheduleAt(simTime() + attackStartTime, attackTimer);
         }
         
-        // Schedule periodic battery check
-        scheduleAt(simTime() + 1.0, chargingTimer);
+        // Schedule periodic battery check, or take part in the fleet's ticks
+        fleetEnergy = VeinsInetFleetEnergyManagerAccess().get();
+        if (fleetEnergy) {
+            VeinsInetFleetEnergyManager::Battery battery;
+            battery.energy = currentBatteryLevel;
+            battery.capacity = batteryCapacity;
+            battery.minEnergy = -std::numeric_limits<double>::infinity();  // packet costs may run the level negative
+            battery.chargePerTick = chargingPower * fleetEnergy->getTickInterval().dbl();
+            battery.lowEnergy = chargingThreshold;
+            fleetSlot = fleetEnergy->add(this, nullptr, battery);
+            updateFleetWatch();
+        }
+        else {
+            scheduleAt(simTime() + 1.0, chargingTimer);
+        }
         
         // Schedule normal V2X background traffic for ALL EVs
         // Start after 1s with random offset to avoid synchronization
@@ -138,6 +155,7 @@ void VeinsInetEVDoSApplication::handleStartOperation(inet::LifecycleOperation* o
 
 void VeinsInetEVDoSApplication::handleMessageWhenUp(cMessage* msg)
 {
+    syncBattery();
     if (msg == attackTimer) {
         startAttack();
     }
@@ -186,17 +204,13 @@ void VeinsInetEVDoSApplication::processPacket(std::shared_ptr<inet::Packet> pk)
     lastPacketTime = simTime();
     
     double recvEnergy = calculatePacketEnergy(pktSize) * 0.1;
-    totalEnergyConsumed += recvEnergy;
-    currentBatteryLevel -= recvEnergy;
+    consumeEnergy(recvEnergy);
     
-    // Extract sequence number from packet payload
-    int seqNum = packetsReceived;
-    try {
-        const auto& payload = pk->peekAtFront<inet::ApplicationPacket>();
-        seqNum = payload->getSequenceNumber();
-    } catch (...) {}
+    // Sequence number from the typed application header
+    auto payload = peekEvPayload(pk.get());
+    int seqNum = payload ? (int)payload->getSequenceNumber() : packetsReceived;
     
-    std::string pktName = pk->getName();
+    const char* pktName = pk->getName();
     
     // Compute estimated tx duration (visible in Qtenv as "duration")
     double txDur = (pktSize * 8.0) / 6e6;
@@ -210,17 +224,17 @@ void VeinsInetEVDoSApplication::processPacket(std::shared_ptr<inet::Packet> pk)
     
     auto srcAddr = pk->getTag<inet::L3AddressInd>()->getSrcAddress();
     
-    // Determine communication type from packet name
-    std::string commType = "UNKNOWN";
-    if (pktName.find("EV2EV") != std::string::npos) commType = "EV2EV";
-    else if (pktName.find("EV2CS") != std::string::npos) commType = "EV2CS";
-    else if (pktName.find("EV2RSU") != std::string::npos) commType = "EV2RSU";
-    else if (pktName.find("BSM") != std::string::npos) commType = "BSM";
+    // Determine communication type from the message type
+    const char* commType = "UNKNOWN";
+    if (payload && (payload->getMessageType() == EV_MSG_ATTACK
+                    || payload->getMessageType() == EV_MSG_BSM)) {
+        commType = getCommunicationType(*payload);
+    }
     
-    logPacketToCSV("RECEIVED", commType.c_str(), pktSize, iat.dbl(), 
+    logPacketToCSV(getTraceEventClass(payload.get()), "RECEIVED", commType, pktSize, iat.dbl(), 
                   currentBatteryLevel, recvEnergy, 
                   srcAddr.str().c_str(), getParentModule()->getFullName(),
-                  seqNum, pktName.c_str());
+                  seqNum, pktName);
 }
 
 void VeinsInetEVDoSApplication::startAttack()
@@ -263,17 +277,17 @@ void VeinsInetEVDoSApplication::sendAttackPacket()
 
 void VeinsInetEVDoSApplication::sendToEV(const char* destAddr)
 {
-    sendToTarget("224.0.0.1", "EV2EV", "EV2EV", destAddr);
+    sendToTarget("224.0.0.1", "EV2EV", ATTACK_TARGET_EV, destAddr);
 }
 
 void VeinsInetEVDoSApplication::sendToCS(const char* destAddr)
 {
-    sendToTarget("224.0.0.2", "EV2CS", "EV2CS", destAddr);
+    sendToTarget("224.0.0.2", "EV2CS", ATTACK_TARGET_CS, destAddr);
 }
 
 void VeinsInetEVDoSApplication::sendToRSU(const char* destAddr)
 {
-    sendToTarget("224.0.0.3", "EV2RSU", "EV2RSU", destAddr);
+    sendToTarget("224.0.0.3", "EV2RSU", ATTACK_TARGET_RSU, destAddr);
 }
 
 void VeinsInetEVDoSApplication::sendNormalTraffic()
@@ -294,8 +308,9 @@ void VeinsInetEVDoSApplication::sendNormalTraffic()
     std::ostringstream str;
     str << "BSM-" << packetsSent;
     
-    auto payload = makeShared<inet::ApplicationPacket>();
+    auto payload = makeShared<Bsm>();
     payload->setChunkLength(inet::B(normalPktSize));
+    payload->setVehicleId(getParentModule()->getIndex());
     payload->setSequenceNumber(packetsSent);
     
     std::unique_ptr<inet::Packet> packet(new inet::Packet(str.str().c_str(), payload));
@@ -305,8 +320,7 @@ void VeinsInetEVDoSApplication::sendNormalTraffic()
     if (normalPktSize < minSentPktSize) minSentPktSize = normalPktSize;
     if (normalPktSize > maxSentPktSize) maxSentPktSize = normalPktSize;
     
-    totalEnergyConsumed += sendEnergy;
-    currentBatteryLevel -= sendEnergy;
+    consumeEnergy(sendEnergy);
     
     simtime_t iat = simTime() - lastSentTimestamp;
     lastSentTimestamp = simTime();
@@ -321,7 +335,7 @@ void VeinsInetEVDoSApplication::sendNormalTraffic()
     emit(energyConsumptionSignal, sendEnergy);
     
     // Log as SENT with communication type "BSM" (normal V2X)
-    logPacketToCSV("SENT", "BSM", normalPktSize, iatVal, 
+    logPacketToCSV(TRACE_EVENT_BSM, "SENT", "BSM", normalPktSize, iatVal, 
                   currentBatteryLevel, sendEnergy, 
                   getParentModule()->getFullName(), "broadcast",
                   packetsSent - 1, str.str().c_str());
@@ -332,7 +346,7 @@ void VeinsInetEVDoSApplication::sendNormalTraffic()
 
 void VeinsInetEVDoSApplication::sendToTarget(const char* mcastAddr, 
                                              const char* prefix, 
-                                             const char* commType, 
+                                             AttackTarget target, 
                                              const char* destAddr)
 {
     destAddress = inet::Ipv4Address(mcastAddr);
@@ -349,9 +363,11 @@ void VeinsInetEVDoSApplication::sendToTarget(const char* mcastAddr,
     std::ostringstream str;
     str << prefix << "-" << packetsSent;
     
-    auto payload = makeShared<inet::ApplicationPacket>();
+    auto payload = makeShared<AttackPayload>();
     payload->setChunkLength(inet::B(actualPktSize));
+    payload->setVehicleId(getParentModule()->getIndex());
     payload->setSequenceNumber(packetsSent);
+    payload->setTarget(target);
     
     std::unique_ptr<inet::Packet> packet(new inet::Packet(str.str().c_str(), payload));
     
@@ -361,8 +377,7 @@ void VeinsInetEVDoSApplication::sendToTarget(const char* mcastAddr,
     if (actualPktSize > maxSentPktSize) maxSentPktSize = actualPktSize;
     
     double sendEnergy = calculatePacketEnergy(actualPktSize);
-    totalEnergyConsumed += sendEnergy;
-    currentBatteryLevel -= sendEnergy;
+    consumeEnergy(sendEnergy);
     
     simtime_t iat = simTime() - lastPacketTime;
     lastPacketTime = simTime();
@@ -375,9 +390,9 @@ void VeinsInetEVDoSApplication::sendToTarget(const char* mcastAddr,
     emit(interArrivalTimeSignal, iatVal);
     emit(batteryLevelSignal, currentBatteryLevel);
     emit(energyConsumptionSignal, sendEnergy);
-    emit(communicationTypeSignal, commType);
+    emit(communicationTypeSignal, prefix);
     
-    logPacketToCSV("SENT", commType, actualPktSize, iatVal, 
+    logPacketToCSV(TRACE_EVENT_ATTACK, "SENT", prefix, actualPktSize, iatVal, 
                   currentBatteryLevel, sendEnergy, 
                   getParentModule()->getFullName(), destAddr,
                   packetsSent - 1, str.str().c_str());
@@ -417,10 +432,7 @@ void VeinsInetEVDoSApplication::updateBatteryLevel()
 void VeinsInetEVDoSApplication::checkChargingNeed()
 {
     if (currentBatteryLevel < chargingThreshold && !isCharging) {
-        inet::Coord csPos = getNodePosition("cs[0]");
-        inet::Coord myPos = getNodePosition(getParentModule()->getFullName());
-        
-        if (isInRange(csPos, ev2csRange)) {
+        if (isCSInRange(ev2csRange)) {
             startCharging();
         }
     }
@@ -429,15 +441,50 @@ void VeinsInetEVDoSApplication::checkChargingNeed()
     }
 }
 
+void VeinsInetEVDoSApplication::energyTick(int events)
+{
+    // The fleet has already added the charge of this tick
+    currentBatteryLevel = fleetEnergy->getEnergy(fleetSlot);
+    emit(batteryLevelSignal, currentBatteryLevel);
+    checkChargingNeed();
+    updateFleetWatch();
+}
+
+void VeinsInetEVDoSApplication::updateFleetWatch()
+{
+    // Every tick only while charging or below the threshold waiting for a CS in range;
+    // otherwise the fleet calls back at the crossing (EVENT_LOW), where batteryLevel is emitted
+    fleetEnergy->setWatched(fleetSlot, isCharging || currentBatteryLevel < chargingThreshold);
+}
+
+void VeinsInetEVDoSApplication::consumeEnergy(double energy)
+{
+    totalEnergyConsumed += energy;
+    if (fleetEnergy) {
+        fleetEnergy->drain(fleetSlot, energy);
+        currentBatteryLevel = fleetEnergy->getEnergy(fleetSlot);
+    }
+    else {
+        currentBatteryLevel -= energy;
+    }
+}
+
+void VeinsInetEVDoSApplication::syncBattery()
+{
+    if (fleetEnergy && fleetSlot >= 0) currentBatteryLevel = fleetEnergy->getEnergy(fleetSlot);
+}
+
 void VeinsInetEVDoSApplication::startCharging()
 {
     isCharging = true;
+    if (fleetEnergy) fleetEnergy->setCharging(fleetSlot, true);
     emit(isChargingSignal, true);
 }
 
 void VeinsInetEVDoSApplication::stopCharging()
 {
     isCharging = false;
+    if (fleetEnergy) fleetEnergy->setCharging(fleetSlot, false);
     emit(isChargingSignal, false);
 }
 
@@ -457,28 +504,41 @@ double VeinsInetEVDoSApplication::calculatePacketEnergy(int pktSize)
 
 bool VeinsInetEVDoSApplication::isInRange(inet::Coord targetPos, double range)
 {
-    inet::Coord myPos = getNodePosition(getParentModule()->getFullName());
+    inet::Coord myPos = getMyPosition();
     double distance = myPos.distance(targetPos);
     return distance <= range;
 }
 
+bool VeinsInetEVDoSApplication::isCSInRange(double range)
+{
+    // Any charging station; the registry's spatial index avoids a distance check per CS
+    if (nodeRegistry) {
+        return nodeRegistry->getNearestNode("cs", getMyPosition(), range) != nullptr;
+    }
+    return isInRange(getNodePosition("cs[0]"), range);
+}
+
 inet::Coord VeinsInetEVDoSApplication::getNodePosition(const char* nodeName)
 {
-    cModule* targetModule = getModuleByPath(nodeName);
-    if (targetModule == nullptr) {
-        targetModule = getParentModule();
+    // Network level node; static ones (cs[*], rsu[*]) are cached by the registry
+    inet::IMobility* nodeMobility = nodeRegistry ? nodeRegistry->getMobility(nodeName)
+                                                 : VeinsInetNodeRegistry::resolveMobility(nodeName);
+    if (nodeMobility == nullptr) {
+        nodeMobility = mobility;  // fallback: own node
     }
     
-    auto mobility = check_and_cast<inet::IMobility*>(
-        targetModule->getSubmodule("mobility"));
-    
-    if (mobility != nullptr) {
-        return mobility->getCurrentPosition();
+    if (nodeMobility != nullptr) {
+        return nodeMobility->getCurrentPosition();
     }
     
     return inet::Coord::ZERO;
 }
 
+inet::Coord VeinsInetEVDoSApplication::getMyPosition()
+{
+    return mobility != nullptr ? mobility->getCurrentPosition() : inet::Coord::ZERO;
+}
+
 std::string VeinsInetEVDoSApplication::determineCommType(const char* destAddr)
 {
     std::string addr(destAddr);
@@ -498,10 +558,6 @@ std::string VeinsInetEVDoSApplication::determineCommType(const char* destAddr)
 
 double VeinsInetEVDoSApplication::getMySpeed()
 {
-    cModule* parentMod = getParentModule();
-    if (!parentMod) return 0.0;
-    
-    auto mobility = dynamic_cast<inet::IMobility*>(parentMod->getSubmodule("mobility"));
     if (mobility != nullptr) {
         return mobility->getCurrentVelocity().length();
     }
@@ -510,30 +566,28 @@ double VeinsInetEVDoSApplication::getMySpeed()
 
 void VeinsInetEVDoSApplication::initializeCSVLogging()
 {
+    // One shared trace for the whole network if the scenario has a traceCollector
+    if (VeinsInetTraceCollector* collector = VeinsInetTraceCollectorAccess().get()) {
+        traceChannel = collector->acquire(getParentModule()->getName());
+        traceShared = true;
+        return;
+    }
+
     std::ostringstream filename;
     
     const char* configName = getEnvir()->getConfigEx()->getActiveConfigName();
+    TraceFormat format = TraceSink::parseFormat(par("traceFormat"));
+    TraceCompression compression = TraceSink::parseCompression(par("traceCompression"));
     
-    filename << "results/" << configName << "_ev" 
+    filename << configName << "_ev" 
              << getParentModule()->getIndex() 
-             << ".csv";
-    
-    csvFilePath = filename.str();
-    csvFile.open(csvFilePath.c_str());
+             << TraceSink::getFileExtension(format, compression);
     
-    if (csvFile.is_open()) {
-        csvFile << "timestamp,event_type,node_id,node_type,communication_type,"
-                << "packet_size,inter_arrival_time,battery_level,"
-                << "energy_consumption,source_address,target_address,"
-                << "is_attacker,is_charging,"
-                << "sequence_number,packet_name,"
-                << "pos_x,pos_y,speed,"
-                << "tx_duration_est,"
-                << "cumulative_packets_sent,cumulative_packets_received\n";
-    }
+    csvFilePath = TraceSink::getResultPath(filename.str());
+    traceChannel = TraceSink::getInstance().openChannel(csvFilePath, TRACE_SCHEMA_BASE, format, compression, par("traceCompressionLevel"));
 }
 
-void VeinsInetEVDoSApplication::logPacketToCSV(const char* eventType, 
+void VeinsInetEVDoSApplication::logPacketToCSV(TraceEventClass eventClass, const char* eventType, 
                                                const char* commType,
                                                int pktSize, 
                                                double iat, 
@@ -544,45 +598,47 @@ void VeinsInetEVDoSApplication::logPacketToCSV(const char* eventType,
                                                int seqNum,
                                                const char* pktName)
 {
-    if (!csvFile.is_open()) {
-        return;
-    }
+    // Filter first: rejected rows cost no formatting
+    if (!traceChannel || !traceFilter.accept(eventClass)) return;
     
     // Get position and speed of this node
-    inet::Coord myPos = getNodePosition(getParentModule()->getFullName());
-    double mySpeed = getMySpeed();
-    double txDur = (pktSize * 8.0) / 6e6;
-    
-    csvFile << std::fixed << std::setprecision(6)
-            << simTime().dbl() << ","
-            << eventType << ","
-            << getParentModule()->getIndex() << ","
-            << getParentModule()->getName() << ","
-            << commType << ","
-            << pktSize << ","
-            << iat << ","
-            << battery << ","
-            << energy << ","
-            << srcAddress << ","
-            << targetAddress << ","
-            << (isAttacker ? "1" : "0") << ","
-            << (isCharging ? "1" : "0") << ","
-            << seqNum << ","
-            << pktName << ","
-            << myPos.x << ","
-            << myPos.y << ","
-            << mySpeed << ","
-            << txDur << ","
-            << packetsSent << ","
-            << packetsReceived << "\n";
-    
-    csvFile.flush();
+    inet::Coord myPos = getMyPosition();
+    
+    TraceRecord& r = TraceSink::getInstance().beginRecord(traceChannel);
+    r.timestamp = simTime().dbl();
+    TraceRecord::copy(r.eventType, eventType);
+    r.nodeId = getParentModule()->getIndex();
+    TraceRecord::copy(r.nodeType, getParentModule()->getName());
+    TraceRecord::copy(r.commType, commType);
+    r.packetSize = pktSize;
+    r.interArrivalTime = iat;
+    r.battery = battery;
+    r.energy = energy;
+    TraceRecord::copy(r.srcAddress, srcAddress);
+    TraceRecord::copy(r.tgtAddress, targetAddress);
+    r.isAttacker = isAttacker;
+    r.isCharging = isCharging ? 1 : 0;
+    r.sequenceNumber = seqNum;
+    TraceRecord::copy(r.packetName, pktName);
+    r.posX = myPos.x;
+    r.posY = myPos.y;
+    r.speed = getMySpeed();
+    r.txDuration = (pktSize * 8.0) / 6e6;
+    r.packetsSent = packetsSent;
+    r.packetsReceived = packetsReceived;
+    TraceSink::getInstance().commitRecord();
 }
 
 void VeinsInetEVDoSApplication::closeCSVLogging()
 {
-    if (csvFile.is_open()) {
-        csvFile.close();
+    if (traceChannel) {
+        if (!traceShared) {
+            TraceSink::getInstance().closeChannel(traceChannel);
+        }
+        else if (VeinsInetTraceCollector* collector = VeinsInetTraceCollectorAccess().get()) {
+            collector->release(traceChannel);
+        }
+        traceChannel = nullptr;
     }
 }
 
@@ -590,6 +646,12 @@ void VeinsInetEVDoSApplication::finish()
 {
     VeinsInetApplicationBase::finish();
     
+    syncBattery();
+    if (fleetEnergy && fleetSlot >= 0) {
+        fleetEnergy->remove(fleetSlot);
+        fleetSlot = -1;
+    }
+    
     // Basic counters
     recordScalar("packetsSent", packetsSent);
     recordScalar("packetsReceived", packetsReceived);
@@ -599,6 +661,7 @@ void VeinsInetEVDoSApplication::finish()
     // Byte-level stats
     recordScalar("totalBytesSent", (double)totalBytesSent);
     recordScalar("totalBytesReceived", (double)totalBytesReceived);
+    recordScalar("traceRowsFiltered", traceFilter.getNumRejected());
     
     // Rate metrics
     double simDur = simTime().dbl();
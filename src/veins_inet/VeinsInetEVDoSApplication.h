@@ -4,17 +4,22 @@
 #define __VEINS_INET_EVDOSAPPLICATION_H_
 
 #include "veins_inet/VeinsInetApplicationBase.h"
+#include "veins_inet/VeinsInetFleetEnergyManager.h"
+#include "veins_inet/VeinsInetNodeRegistry.h"
+#include "veins_inet/VeinsInetTraceCollector.h"
+#include "veins_inet/VeinsInetTraceFilter.h"
+#include "veins_inet/VeinsInetTraceSink.h"
+#include "veins_inet/ChargingProtocol_m.h"
 #include "inet/power/storage/SimpleEpEnergyStorage.h"
 #include "inet/networklayer/common/L3AddressResolver.h"
 #include "inet/common/geometry/common/Coord.h"
-#include <fstream>
 
 using namespace omnetpp;
 using namespace inet;
 
 namespace veins {
 
-class VEINS_INET_API VeinsInetEVDoSApplication : public VeinsInetApplicationBase
+class VEINS_INET_API VeinsInetEVDoSApplication : public VeinsInetApplicationBase, public VeinsInetFleetEnergyManager::Client
 {
 protected:
     bool isAttacker;
@@ -31,6 +36,10 @@ protected:
     double chargingThreshold;
     bool isCharging;
     
+    // Fleet-wide battery ticks (replace chargingTimer when the network has a fleetEnergy module)
+    VeinsInetFleetEnergyManager* fleetEnergy = nullptr;
+    int fleetSlot = -1;
+    
     double ev2evRange;
     double ev2csRange;
     double ev2rsuRange;
@@ -67,9 +76,14 @@ protected:
     double sumIATSq;    // Sum of IAT squared (for std)
     int iatCount;       // Number of IAT samples
     
-    std::ofstream csvFile;
+    TraceChannel* traceChannel = nullptr;
+    bool traceShared = false;   // traceChannel belongs to the network's traceCollector
+    TraceFilter traceFilter;
     std::string csvFilePath;
     
+    // own node: VeinsInetApplicationBase::mobility
+    VeinsInetNodeRegistry* nodeRegistry = nullptr;  // nullptr: resolve nodes without cache
+    
     power::SimpleEpEnergyStorage* energyStorage;
 
 public:
@@ -93,8 +107,8 @@ protected:
     virtual void sendToCS(const char* destAddr);
     virtual void sendToRSU(const char* destAddr);
     virtual void sendMixedAttack();
-    virtual void sendToTarget(const char* mcastAddr, const char* prefix, 
-                             const char* commType, const char* destAddr);
+    virtual void sendToTarget(const char* mcastAddr, const char* prefix,
+                              AttackTarget target, const char* destAddr);
     
     virtual void sendNormalTraffic();
     
@@ -104,15 +118,21 @@ protected:
     virtual void checkChargingNeed();
     virtual void startCharging();
     virtual void stopCharging();
+    virtual void consumeEnergy(double energy);
+    virtual void syncBattery();
+    virtual void updateFleetWatch();
+    virtual void energyTick(int events) override;
     virtual double calculatePacketEnergy(int pktSize);
     
     virtual bool isInRange(inet::Coord targetPos, double range);
+    virtual bool isCSInRange(double range);
     virtual inet::Coord getNodePosition(const char* nodeName);
+    virtual inet::Coord getMyPosition();
     virtual double getMySpeed();
     virtual std::string determineCommType(const char* destAddr);
     
     virtual void initializeCSVLogging();
-    virtual void logPacketToCSV(const char* eventType, const char* commType, 
+    virtual void logPacketToCSV(TraceEventClass eventClass, const char* eventType, const char* commType, 
                                 int pktSize, double iat, double battery, 
                                 double energy, const char* srcAddress,
                                 const char* targetAddress,
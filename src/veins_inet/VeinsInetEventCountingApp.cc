@@ -0,0 +1,18 @@
+// Application base that counts the messages an app handles, for the eventsHandled scalar
+
+#include "veins_inet/VeinsInetEventCountingApp.h"
+
+using namespace veins;
+
+void VeinsInetEventCountingApp::handleMessage(cMessage* msg)
+{
+    // OperationalMixin passes the message on to handleMessageWhenUp() in the same case
+    if (isUp()) eventsHandled++;
+    ApplicationBase::handleMessage(msg);
+}
+
+void VeinsInetEventCountingApp::finish()
+{
+    ApplicationBase::finish();
+    recordScalar("eventsHandled", eventsHandled);
+}
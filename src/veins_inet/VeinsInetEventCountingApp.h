@@ -0,0 +1,27 @@
+// Application base that counts the messages an app handles, for the eventsHandled scalar
+
+#ifndef __VEINS_INET_EVENTCOUNTINGAPP_H_
+#define __VEINS_INET_EVENTCOUNTINGAPP_H_
+
+#include "veins_inet/veins_inet.h"
+#include "inet/applications/base/ApplicationBase.h"
+
+namespace veins {
+
+/**
+ * inet::ApplicationBase that counts every message handled while the app
+ * is up (timers and packets, the calls of handleMessageWhenUp()) and
+ * records the count as the eventsHandled scalar in finish(). Base of the
+ * EV, CS and RSU apps, so benchmarks can attribute events per app.
+ */
+class VEINS_INET_API VeinsInetEventCountingApp : public inet::ApplicationBase {
+protected:
+    long eventsHandled = 0;
+
+    virtual void handleMessage(cMessage* msg) override;
+    virtual void finish() override;
+};
+
+} // namespace veins
+
+#endif
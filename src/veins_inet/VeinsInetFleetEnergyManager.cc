@@ -0,0 +1,182 @@
+// Battery state of all EVs in contiguous arrays, advanced in one event per tick
+
+#include "veins_inet/VeinsInetFleetEnergyManager.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace veins;
+
+Define_Module(VeinsInetFleetEnergyManager);
+
+VeinsInetFleetEnergyManager::~VeinsInetFleetEnergyManager()
+{
+    cancelAndDelete(tickMsg);
+}
+
+void VeinsInetFleetEnergyManager::initialize()
+{
+    tickInterval = par("tickInterval");
+    if (tickInterval <= 0) throw cRuntimeError("VeinsInetFleetEnergyManager: tickInterval must be positive");
+    tickMsg = new cMessage("fleetEnergyTick");
+    scheduleAt(simTime() + tickInterval, tickMsg);
+}
+
+void VeinsInetFleetEnergyManager::handleMessage(cMessage* msg)
+{
+    if (msg != tickMsg) throw cRuntimeError("This module only handles its own tick timer");
+    tick();
+    scheduleAt(simTime() + tickInterval, tickMsg);
+}
+
+void VeinsInetFleetEnergyManager::finish()
+{
+    recordScalar("fleetMaxVehicles", maxVehicles);
+    recordScalar("fleetTicks", numTicks);
+    recordScalar("fleetCallbacks", numCallbacks);
+}
+
+int VeinsInetFleetEnergyManager::add(Client* client, inet::IMobility* mobility, const Battery& battery)
+{
+    if (battery.capacity <= 0) throw cRuntimeError("VeinsInetFleetEnergyManager: battery capacity must be positive");
+    if (battery.drainPerMeter != 0 && !mobility) throw cRuntimeError("VeinsInetFleetEnergyManager: driving consumption needs a mobility");
+
+    int slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+    else {
+        slot = flags.size();
+        resize(slot + 1);
+    }
+
+    energy[slot] = battery.energy;
+    soc[slot] = battery.energy / battery.capacity;
+    capacity[slot] = battery.capacity;
+    minEnergy[slot] = battery.minEnergy;
+    drainPerMeter[slot] = battery.drainPerMeter;
+    chargePerTick[slot] = battery.chargePerTick;
+    lowSoc[slot] = battery.lowSoc;
+    lowEnergy[slot] = battery.lowEnergy;
+    driven[slot] = 0;
+    lastX[slot] = 0;
+    lastY[slot] = 0;
+    flags[slot] = FLAG_USED | (battery.detectDead ? FLAG_DETECT_DEAD : 0);
+    clients[slot] = client;
+    mobilities[slot] = mobility;
+    addedAt[slot] = simTime();
+
+    numVehicles++;
+    maxVehicles = std::max(maxVehicles, numVehicles);
+    return slot;
+}
+
+void VeinsInetFleetEnergyManager::remove(int slot)
+{
+    ASSERT(flags[slot] & FLAG_USED);
+    flags[slot] = 0;
+    clients[slot] = nullptr;
+    mobilities[slot] = nullptr;
+    freeSlots.push_back(slot);
+    numVehicles--;
+}
+
+void VeinsInetFleetEnergyManager::drain(int slot, double amount)
+{
+    energy[slot] = std::max(energy[slot] - amount, minEnergy[slot]);
+    soc[slot] = energy[slot] / capacity[slot];
+}
+
+void VeinsInetFleetEnergyManager::tick()
+{
+    numTicks++;
+    size_t n = flags.size();
+
+    // Gather: current positions and this tick's masks; a slot starts with the first tick after its registration
+    simtime_t now = simTime();
+    for (size_t i = 0; i < n; i++) {
+        uint8_t f = flags[i];
+        if ((f & FLAG_USED) && !(f & FLAG_ACTIVE) && addedAt[i] < now) f = flags[i] = f | FLAG_ACTIVE;
+        bool active = f & FLAG_ACTIVE;
+        if (active && mobilities[i]) {
+            inet::Coord position = mobilities[i]->getCurrentPosition();
+            posX[i] = position.x;
+            posY[i] = position.y;
+            moving[i] = (f & FLAG_HAS_POSITION) ? 1 : 0;
+            if (!(f & FLAG_HAS_POSITION)) flags[i] |= FLAG_HAS_POSITION;
+        }
+        else {
+            posX[i] = lastX[i];
+            posY[i] = lastY[i];
+            moving[i] = 0;
+        }
+        charging[i] = active && (f & FLAG_CHARGING) ? 1 : 0;
+    }
+
+    // Advance: no branches and no calls, so the compiler can vectorize it
+    double* e = energy.data();
+    double* s = soc.data();
+    double* d = driven.data();
+    double* lx = lastX.data();
+    double* ly = lastY.data();
+    const double* px = posX.data();
+    const double* py = posY.data();
+    const double* mv = moving.data();
+    const double* ch = charging.data();
+    const double* cap = capacity.data();
+    const double* lo = minEnergy.data();
+    const double* perMeter = drainPerMeter.data();
+    const double* perTick = chargePerTick.data();
+    for (size_t i = 0; i < n; i++) {
+        double dx = px[i] - lx[i];
+        double dy = py[i] - ly[i];
+        double drive = std::sqrt(dx * dx + dy * dy) * perMeter[i] * mv[i];
+        double level = e[i] - drive;
+        double charged = std::min(level + perTick[i], cap[i]);
+        level = ch[i] != 0 ? charged : level;
+        level = std::max(level, lo[i]);
+        d[i] += drive;
+        e[i] = level;
+        s[i] = level / cap[i];
+        lx[i] = px[i];
+        ly[i] = py[i];
+    }
+
+    // Crossings: collect first, since callbacks may register, remove or drain slots
+    events.clear();
+    for (size_t i = 0; i < n; i++) {
+        uint8_t f = flags[i];
+        if (!(f & FLAG_ACTIVE)) continue;
+        bool isCharging = f & FLAG_CHARGING;
+        bool low = !isCharging && (soc[i] <= lowSoc[i] || energy[i] < lowEnergy[i]);
+        int event = 0;
+        if (f & FLAG_WATCHED) event |= EVENT_TICK;
+        if (low && !(f & FLAG_LOW)) event |= EVENT_LOW;
+        if ((f & FLAG_DETECT_DEAD) && !(f & FLAG_DEAD) && !isCharging && energy[i] <= 0) {
+            event |= EVENT_DEAD;
+            f |= FLAG_DEAD;
+        }
+        flags[i] = low ? f | FLAG_LOW : f & ~FLAG_LOW;
+        if (event) {
+            events.push_back(i);
+            events.push_back(event);
+        }
+    }
+    for (size_t k = 0; k < events.size(); k += 2) {
+        int slot = events[k];
+        // Skip slots removed by an earlier callback of this tick (a slot reused since is not active yet)
+        if (!(flags[slot] & FLAG_ACTIVE)) continue;
+        numCallbacks++;
+        clients[slot]->energyTick(events[k + 1]);
+    }
+}
+
+void VeinsInetFleetEnergyManager::resize(size_t size)
+{
+    for (auto array : {&energy, &soc, &minEnergy, &drainPerMeter, &chargePerTick, &lowSoc, &lowEnergy, &driven, &lastX, &lastY, &posX, &posY, &moving, &charging}) array->resize(size, 0);
+    capacity.resize(size, 1);
+    flags.resize(size, 0);
+    clients.resize(size, nullptr);
+    mobilities.resize(size, nullptr);
+    addedAt.resize(size);
+}
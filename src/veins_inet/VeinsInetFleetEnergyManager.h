@@ -0,0 +1,145 @@
+// Battery state of all EVs in contiguous arrays, advanced in one event per tick
+
+#ifndef __VEINS_INET_FLEETENERGYMANAGER_H_
+#define __VEINS_INET_FLEETENERGYMANAGER_H_
+
+#include "veins_inet/veins_inet.h"
+#include "inet/mobility/contract/IMobility.h"
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Keeps the batteries of all EVs as structure of arrays (energy, SoC,
+ * last position, charging flag, thresholds) and advances them together
+ * once per tick: a gather of the current positions, then one branch-free
+ * loop over the arrays for driving consumption, charging and clamping.
+ *
+ * An app registers its battery with add() and gets a slot. The energy
+ * unit is the app's (Wh or J); the manager only needs the amounts to be
+ * consistent. After each tick, the app's energyTick() is called only for
+ * slots that are watched (the app needs every tick) or that crossed a
+ * threshold: SoC at or below lowSoc, energy below lowEnergy, or an empty
+ * battery while not charging (EVENT_DEAD, if enabled for the slot). Both
+ * are edge-triggered: EVENT_LOW once per drop below the thresholds (again
+ * after charging or a rise above them), EVENT_DEAD once per slot.
+ *
+ * Energy changes between ticks (packet costs) go through drain(), so the
+ * arrays stay the only copy of the battery state.
+ */
+class VEINS_INET_API VeinsInetFleetEnergyManager : public cSimpleModule {
+public:
+    enum Event {
+        EVENT_TICK = 1,  // slot is watched
+        EVENT_LOW = 2,   // soc <= lowSoc or energy < lowEnergy while not charging, and not so on the last tick
+        EVENT_DEAD = 4,  // energy <= 0 while not charging, first time
+    };
+
+    /** @brief implemented by the apps whose battery is kept here */
+    class Client {
+    public:
+        virtual ~Client() = default;
+        /** @brief a tick has updated the battery; events is a bit set of Event */
+        virtual void energyTick(int events) = 0;
+    };
+
+    /** @brief initial state and constants of a battery, for add() */
+    struct Battery {
+        double energy = 0;
+        double capacity = 1;
+        double minEnergy = 0;  // energy is clamped to this after every change
+        double drainPerMeter = 0;  // driving consumption; needs a mobility in add()
+        double chargePerTick = 0;  // while charging, capped at capacity
+        double lowSoc = -std::numeric_limits<double>::infinity();  // EVENT_LOW at or below (default: never)
+        double lowEnergy = -std::numeric_limits<double>::infinity();  // EVENT_LOW below (default: never)
+        bool detectDead = false;  // report EVENT_DEAD
+    };
+
+    virtual ~VeinsInetFleetEnergyManager();
+
+    /** @brief register a battery; it is advanced from the first tick later than now */
+    int add(Client* client, inet::IMobility* mobility, const Battery& battery);
+    /** @brief unregister; the slot is reused */
+    void remove(int slot);
+
+    double getEnergy(int slot) const { return energy[slot]; }
+    double getSoc(int slot) const { return soc[slot]; }
+    /** @brief driving consumption of the slot so far */
+    double getDriveEnergy(int slot) const { return driven[slot]; }
+    simtime_t getTickInterval() const { return tickInterval; }
+
+    /** @brief take amount out of the battery now (clamped at minEnergy) */
+    void drain(int slot, double amount);
+    void setCharging(int slot, bool charging) { flags[slot] = charging ? flags[slot] | FLAG_CHARGING : flags[slot] & ~FLAG_CHARGING; }
+    /** @brief no more EVENT_DEAD for the slot */
+    void setDead(int slot) { flags[slot] |= FLAG_DEAD; }
+    /** @brief call the client's energyTick() on every tick, not only on crossings */
+    void setWatched(int slot, bool watched) { flags[slot] = watched ? flags[slot] | FLAG_WATCHED : flags[slot] & ~FLAG_WATCHED; }
+
+protected:
+    enum Flag : uint8_t {
+        FLAG_USED = 1,  // slot is registered
+        FLAG_ACTIVE = 2,  // advanced by ticks (from the first tick after registration)
+        FLAG_CHARGING = 4,
+        FLAG_WATCHED = 8,
+        FLAG_DEAD = 16,
+        FLAG_DETECT_DEAD = 32,
+        FLAG_HAS_POSITION = 64,  // lastX/lastY are set
+        FLAG_LOW = 128,  // below the thresholds and not charging on the last tick
+    };
+
+    simtime_t tickInterval;
+    cMessage* tickMsg = nullptr;
+
+    // One entry per slot
+    std::vector<double> energy;
+    std::vector<double> soc;
+    std::vector<double> capacity;
+    std::vector<double> minEnergy;
+    std::vector<double> drainPerMeter;
+    std::vector<double> chargePerTick;
+    std::vector<double> lowSoc;
+    std::vector<double> lowEnergy;
+    std::vector<double> driven;
+    std::vector<double> lastX;
+    std::vector<double> lastY;
+    std::vector<uint8_t> flags;
+    std::vector<Client*> clients;
+    std::vector<inet::IMobility*> mobilities;
+    std::vector<simtime_t> addedAt;
+
+    // Per-tick scratch arrays
+    std::vector<double> posX;
+    std::vector<double> posY;
+    std::vector<double> moving;  // 1 if the slot drives this tick
+    std::vector<double> charging;  // 1 if the slot charges this tick
+    std::vector<int> events;
+    std::vector<int> freeSlots;
+
+    long numVehicles = 0;
+    long maxVehicles = 0;
+    long numTicks = 0;
+    long numCallbacks = 0;
+
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage* msg) override;
+    virtual void finish() override;
+
+    void tick();
+    void resize(size_t size);
+};
+
+class VEINS_INET_API VeinsInetFleetEnergyManagerAccess {
+public:
+    /** @brief the network's fleetEnergy, or nullptr if every app keeps its own battery timer */
+    VeinsInetFleetEnergyManager* get()
+    {
+        return dynamic_cast<VeinsInetFleetEnergyManager*>(getSimulation()->getSystemModule()->getSubmodule("fleetEnergy"));
+    };
+};
+
+} // namespace veins
+
+#endif
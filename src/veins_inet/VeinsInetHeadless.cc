@@ -0,0 +1,19 @@
+// Headless mode: no display-string updates or cosmetic TraCI commands
+
+#include "veins_inet/VeinsInetHeadless.h"
+#include <string>
+
+using namespace veins;
+
+Register_PerRunConfigOption(CFGID_VEINS_INET_HEADLESS, "veins-inet-headless", CFG_STRING, "auto",
+    "Skip display-string updates and cosmetic TraCI commands (SUMO vehicle colors): "
+    "\"true\", \"false\" or \"auto\" (headless unless running under a GUI).");
+
+bool veins::isHeadless()
+{
+    std::string mode = getEnvir()->getConfig()->getAsString(CFGID_VEINS_INET_HEADLESS);
+    if (mode == "auto") return !getEnvir()->isGUI();
+    if (mode == "true") return true;
+    if (mode == "false") return false;
+    throw cRuntimeError("Invalid value '%s' for veins-inet-headless (expected true, false or auto)", mode.c_str());
+}
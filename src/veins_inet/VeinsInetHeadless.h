@@ -0,0 +1,23 @@
+// Headless mode: no display-string updates or cosmetic TraCI commands
+
+#ifndef __VEINS_INET_HEADLESS_H_
+#define __VEINS_INET_HEADLESS_H_
+
+#include "veins_inet/veins_inet.h"
+
+namespace veins {
+
+/**
+ * @brief whether modules should skip display-string updates and cosmetic
+ * TraCI commands (vehicle colors) in this run
+ *
+ * Set by the per-run configuration option veins-inet-headless: "true",
+ * "false" or "auto" (the default: headless unless running under a GUI
+ * such as Qtenv). Looks the option up on every call; modules read it once
+ * during initialization.
+ */
+VEINS_INET_API bool isHeadless();
+
+} // namespace veins
+
+#endif
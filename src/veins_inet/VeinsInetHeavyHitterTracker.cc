@@ -0,0 +1,183 @@
+// Per-source heavy hitters of received packets in fixed memory (time-decayed Space-Saving)
+
+#include "veins_inet/VeinsInetHeavyHitterTracker.h"
+#include "inet/networklayer/common/L3AddressTag_m.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+
+using namespace veins;
+
+namespace {
+
+// Rescale the forward-decayed weights before exp() gets anywhere near overflow
+const double MAX_EXPONENT = 500;
+
+} // namespace
+
+void HeavyHitterTracker::configure(cComponent* module)
+{
+    this->module = module;
+    topTalkerRateSignal = cComponent::registerSignal("topTalkerRate");
+    topTalkerShareSignal = cComponent::registerSignal("topTalkerShare");
+    droppedSignal = cComponent::registerSignal("heavyHitterDropped");
+
+    int capacityPar = module->par("heavyHitterCapacity");
+    if (capacityPar < 0) throw cRuntimeError("heavyHitterCapacity must not be negative");
+    capacity = capacityPar;
+    double halfLife = module->par("heavyHitterHalfLife");
+    if (!(halfLife > 0)) throw cRuntimeError("heavyHitterHalfLife must be positive");
+    lambda = std::log(2.0) / halfLife;
+    topK = module->par("heavyHitterTopK");
+    reportInterval = module->par("heavyHitterReportInterval");
+    dropRate = module->par("heavyHitterDropRate");
+
+    heap.clear();
+    heap.reserve(capacity);
+    index.clear();
+    index.reserve(capacity);
+    landmark = simTime().dbl();
+    totalWeight = 0;
+    nextReport = landmark + reportInterval;
+}
+
+bool HeavyHitterTracker::accept(const inet::Packet* packet)
+{
+    if (capacity == 0) return true;
+    auto addressInd = packet->findTag<inet::L3AddressInd>();
+    if (!addressInd) return true;
+    const inet::L3Address& address = addressInd->getSrcAddress();
+
+    double now = simTime().dbl();
+    if (lambda * (now - landmark) > MAX_EXPONENT) rescale(now);
+    double weight = std::exp(lambda * (now - landmark));
+    totalWeight += weight;
+
+    uint64_t key = getKey(address);
+    size_t i;
+    auto it = index.find(key);
+    if (it != index.end()) {
+        i = it->second;
+        heap[i].weight += weight;
+        heap[i].packets++;
+        siftDown(i);
+        i = index[key];
+    }
+    else if (heap.size() < capacity) {
+        heap.push_back({key, address, weight, 0, 1});
+        i = heap.size() - 1;
+        index[key] = i;
+        siftUp(i);
+        i = index[key];
+    }
+    else {
+        // Take over the smallest counter; its count becomes our error
+        Counter& smallest = heap[0];
+        index.erase(smallest.key);
+        smallest.error = smallest.weight;
+        smallest.weight += weight;
+        smallest.key = key;
+        smallest.address = address;
+        smallest.packets = 1;
+        index[key] = 0;
+        siftDown(0);
+        i = index[key];
+    }
+
+    if (reportInterval >= 0 && now >= nextReport) {
+        nextReport = now + reportInterval;
+        auto top = std::max_element(heap.begin(), heap.end(), [](const Counter& a, const Counter& b) { return a.weight < b.weight; });
+        module->emit(topTalkerRateSignal, top->weight * decayNow() * lambda);
+        module->emit(topTalkerShareSignal, top->weight / totalWeight);
+    }
+
+    if (dropRate > 0 && (heap[i].weight - heap[i].error) * decayNow() * lambda > dropRate) {
+        dropped++;
+        module->emit(droppedSignal, dropped);
+        return false;
+    }
+    return true;
+}
+
+void HeavyHitterTracker::getTopTalkers(size_t k, std::vector<Talker>& talkers) const
+{
+    std::vector<const Counter*> sorted;
+    sorted.reserve(heap.size());
+    for (const Counter& counter : heap) sorted.push_back(&counter);
+    k = std::min(k, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + k, sorted.end(), [](const Counter* a, const Counter* b) { return a->weight > b->weight; });
+
+    double scale = decayNow() * lambda;
+    talkers.clear();
+    for (size_t i = 0; i < k; i++) {
+        const Counter& counter = *sorted[i];
+        talkers.push_back({counter.address, counter.weight * scale, (counter.weight - counter.error) * scale, counter.packets});
+    }
+}
+
+void HeavyHitterTracker::recordScalars()
+{
+    if (capacity == 0) return;
+    std::vector<Talker> talkers;
+    getTopTalkers(topK, talkers);
+    for (const Talker& talker : talkers) {
+        std::string prefix = "topTalker:" + talker.address.str();
+        module->recordScalar((prefix + ":rate").c_str(), talker.rate);
+        module->recordScalar((prefix + ":packets").c_str(), talker.packets);
+    }
+    if (dropRate > 0) module->recordScalar("heavyHitterDropped", dropped);
+}
+
+double HeavyHitterTracker::decayNow() const
+{
+    return std::exp(-lambda * (simTime().dbl() - landmark));
+}
+
+void HeavyHitterTracker::rescale(double now)
+{
+    // Move the landmark to now; scaling all weights alike keeps the heap order
+    double factor = std::exp(-lambda * (now - landmark));
+    for (Counter& counter : heap) {
+        counter.weight *= factor;
+        counter.error *= factor;
+    }
+    totalWeight *= factor;
+    landmark = now;
+}
+
+void HeavyHitterTracker::siftUp(size_t i)
+{
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap[parent].weight <= heap[i].weight) break;
+        swapCounters(i, parent);
+        i = parent;
+    }
+}
+
+void HeavyHitterTracker::siftDown(size_t i)
+{
+    for (;;) {
+        size_t smallest = i;
+        size_t left = 2 * i + 1, right = left + 1;
+        if (left < heap.size() && heap[left].weight < heap[smallest].weight) smallest = left;
+        if (right < heap.size() && heap[right].weight < heap[smallest].weight) smallest = right;
+        if (smallest == i) break;
+        swapCounters(i, smallest);
+        i = smallest;
+    }
+}
+
+void HeavyHitterTracker::swapCounters(size_t i, size_t j)
+{
+    std::swap(heap[i], heap[j]);
+    index[heap[i].key] = i;
+    index[heap[j].key] = j;
+}
+
+uint64_t HeavyHitterTracker::getKey(const inet::L3Address& address)
+{
+    if (address.getType() == inet::L3Address::IPv4) return address.toIpv4().getInt();
+    return std::hash<std::string>()(address.str()) | (uint64_t) 1 << 63;  // apart from IPv4 keys
+}
@@ -0,0 +1,100 @@
+// Per-source heavy hitters of received packets in fixed memory (time-decayed Space-Saving)
+
+#ifndef __VEINS_INET_HEAVYHITTERTRACKER_H_
+#define __VEINS_INET_HEAVYHITTERTRACKER_H_
+
+#include "veins_inet/veins_inet.h"
+#include "inet/common/packet/Packet.h"
+#include "inet/networklayer/common/L3Address.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Estimates the packet rate of the busiest senders, keyed by the L3
+ * source address, with a fixed number of counters however many nodes
+ * send. Configured from the module parameters heavyHitterCapacity (number
+ * of counters; 0: off), heavyHitterHalfLife, heavyHitterTopK,
+ * heavyHitterReportInterval and heavyHitterDropRate.
+ *
+ * Space-Saving: a source without a counter takes over the smallest one and
+ * inherits its value as error, so every source whose share exceeds
+ * 1/capacity of the traffic is guaranteed to hold a counter. Counts decay
+ * exponentially with heavyHitterHalfLife (forward decay: each packet
+ * weighs exp(lambda * (t - landmark)), so counters only grow and the heap
+ * order stays valid); a count C corresponds to a rate of C * lambda
+ * packets per second.
+ *
+ * At most once per heavyHitterReportInterval, on packet arrival, the rate
+ * of the top sender and its share of all traffic are emitted as the
+ * module's topTalkerRate and topTalkerShare signals. With a
+ * heavyHitterDropRate, packets of a source whose rate is above it even
+ * without the Space-Saving error are dropped (signal heavyHitterDropped).
+ */
+class VEINS_INET_API HeavyHitterTracker {
+public:
+    struct Talker {
+        inet::L3Address address;
+        double rate;  // packets/s, upper bound
+        double minRate;  // packets/s, without the inherited error
+        long packets;  // since the source took its counter
+    };
+
+protected:
+    struct Counter {
+        uint64_t key;
+        inet::L3Address address;
+        double weight;  // forward-decayed count, relative to landmark
+        double error;  // weight inherited from the evicted source
+        long packets;
+    };
+
+    cComponent* module = nullptr;
+    simsignal_t topTalkerRateSignal = 0;
+    simsignal_t topTalkerShareSignal = 0;
+    simsignal_t droppedSignal = 0;
+    size_t capacity = 0;
+    double lambda = 0;  // decay rate, ln 2 / half-life
+    int topK = 0;
+    double reportInterval = 0;
+    double dropRate = 0;  // 0: never drop
+
+    std::vector<Counter> heap;  // min-heap on weight
+    std::unordered_map<uint64_t, size_t> index;  // key -> position in heap
+    double landmark = 0;
+    double totalWeight = 0;
+    double nextReport = 0;
+    long dropped = 0;
+
+public:
+    /** @brief read the heavy hitter parameters of module, which must declare the signals above */
+    void configure(cComponent* module);
+
+    bool isEnabled() const { return capacity > 0; }
+
+    /** @brief count packet, received now; false if its source is to be dropped */
+    bool accept(const inet::Packet* packet);
+
+    /** @brief the k busiest sources, busiest first */
+    void getTopTalkers(size_t k, std::vector<Talker>& talkers) const;
+
+    /** @brief number of packets dropped so far */
+    long getNumDropped() const { return dropped; }
+
+    /** @brief record the top heavyHitterTopK sources as scalars topTalker:<address>:rate and :packets */
+    void recordScalars();
+
+protected:
+    double decayNow() const;
+    void rescale(double now);
+    void siftUp(size_t i);
+    void siftDown(size_t i);
+    void swapCounters(size_t i, size_t j);
+    static uint64_t getKey(const inet::L3Address& address);
+};
+
+} // namespace veins
+
+#endif
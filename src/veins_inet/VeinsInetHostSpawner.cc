@@ -0,0 +1,84 @@
+// Creates vehicle modules and feeds their mobility like TraCIScenarioManager, for the managers without TraCI
+
+#include "veins_inet/VeinsInetHostSpawner.h"
+#include "veins_inet/VeinsInetMobility.h"
+#include "veins/modules/mobility/traci/TraCIScenarioManager.h"
+#include "inet/common/scenario/ScenarioManager.h"
+
+using namespace veins;
+
+void VeinsInetHostSpawner::configure(cModule* owner)
+{
+    this->owner = owner;
+    nodeRegistry = VeinsInetNodeRegistryAccess().get();
+}
+
+cModule* VeinsInetHostSpawner::createHost(const char* type, const char* name, int index, const std::string& displayString)
+{
+    // Same steps as TraCIScenarioManager::addModule()
+    cModuleType* nodeType = cModuleType::get(type);
+    if (!nodeType) throw cRuntimeError("Module Type \"%s\" not found", type);
+
+    cModule* parent = owner->getParentModule();
+    cModule* mod = index >= 0 ? nodeType->create(name, parent, index + 1, index) : nodeType->create(name, parent);
+    mod->finalizeParameters();
+    if (!displayString.empty()) mod->getDisplayString().parse(displayString.c_str());
+    mod->buildInside();
+    mod->scheduleStart(simTime());
+    return mod;
+}
+
+void VeinsInetHostSpawner::initializeHost(cModule* mod, const std::string& nodeId, const inet::Coord& position, const std::string& road_id, double speed, double heading)
+{
+    preInitialize(mod, nodeId, position, road_id, speed, heading);
+    owner->emit(TraCIScenarioManager::traciModulePreInitSignal, mod);
+#if INET_VERSION >= 0x0402
+    auto* notification = new inet::cPreModuleInitNotification();
+    notification->module = mod;
+    getSimulation()->getSystemModule()->emit(POST_MODEL_CHANGE, notification, NULL);
+#endif
+
+    mod->callInitialize();
+    owner->emit(TraCIScenarioManager::traciModuleAddedSignal, mod);
+}
+
+void VeinsInetHostSpawner::deleteHost(cModule* mod)
+{
+    owner->emit(TraCIScenarioManager::traciModuleRemovedSignal, mod);
+    forget(mod);
+    mod->callFinish();
+    mod->deleteModule();
+}
+
+void VeinsInetHostSpawner::preInitialize(cModule* mod, const std::string& nodeId, const inet::Coord& position, const std::string& road_id, double speed, double heading)
+{
+    for (auto inetmm : getMobilityModules(mod)) {
+        inetmm->preInitialize(nodeId, position, road_id, speed, heading);
+    }
+}
+
+void VeinsInetHostSpawner::updatePosition(cModule* mod, const inet::Coord& p, const std::string& edge, double speed, double heading)
+{
+    for (auto inetmm : getMobilityModules(mod)) {
+        inetmm->nextPosition(p, edge, speed, heading);
+    }
+
+    if (nodeRegistry) {
+        nodeRegistry->updateNodePosition(mod, p);
+    }
+}
+
+void VeinsInetHostSpawner::forget(cModule* mod)
+{
+    mobilityModules.erase(mod->getId());
+    if (nodeRegistry) nodeRegistry->removeNode(mod);
+}
+
+const std::vector<VeinsInetMobility*>& VeinsInetHostSpawner::getMobilityModules(cModule* mod)
+{
+    auto it = mobilityModules.find(mod->getId());
+    if (it == mobilityModules.end()) {
+        it = mobilityModules.emplace(mod->getId(), getSubmodulesOfType<VeinsInetMobility>(mod)).first;
+    }
+    return it->second;
+}
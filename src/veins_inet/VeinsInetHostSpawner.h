@@ -0,0 +1,61 @@
+// Creates vehicle modules and feeds their mobility like TraCIScenarioManager, for the managers without TraCI
+
+#ifndef __VEINS_INET_HOSTSPAWNER_H_
+#define __VEINS_INET_HOSTSPAWNER_H_
+
+#include "veins_inet/veins_inet.h"
+#include "veins_inet/VeinsInetNodeRegistry.h"
+#include "inet/common/geometry/common/Coord.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace veins {
+
+class VeinsInetMobility;
+
+/**
+ * The vehicle module life cycle shared by the managers: the steps of
+ * TraCIScenarioManager::addModule() for those that replace it
+ * (VeinsInetSyntheticManager, VeinsInetReplayManager), and the
+ * VeinsInetMobility and node registry updates of preInitializeModule() /
+ * updateModulePosition() for all of them, VeinsInetManagerBase included.
+ *
+ * The TraCIScenarioManager signals are emitted as the owner module's, so
+ * listeners see the same signals as with the TraCI manager.
+ */
+class VEINS_INET_API VeinsInetHostSpawner {
+protected:
+    cModule* owner = nullptr;
+    VeinsInetNodeRegistry* nodeRegistry = nullptr;  // spatial index to keep current, if the network has one
+    // VeinsInetMobility submodules of each vehicle, by module id; saves a submodule walk per vehicle and step
+    std::unordered_map<int, std::vector<VeinsInetMobility*>> mobilityModules;
+
+public:
+    /** @brief use owner for signals and as parent of the vehicles; call in initialize() */
+    void configure(cModule* owner);
+
+    /** @brief create and build the vehicle module (index < 0: not a vector), not initialized yet */
+    cModule* createHost(const char* type, const char* name, int index, const std::string& displayString = "");
+
+    /** @brief pre-initialize and initialize a module from createHost() and announce it */
+    void initializeHost(cModule* mod, const std::string& nodeId, const inet::Coord& position, const std::string& road_id, double speed, double heading);
+
+    /** @brief announce the removal of mod, forget it and delete it */
+    void deleteHost(cModule* mod);
+
+    /** @brief hand the initial position to the vehicle's VeinsInetMobility modules */
+    void preInitialize(cModule* mod, const std::string& nodeId, const inet::Coord& position, const std::string& road_id, double speed, double heading);
+
+    /** @brief move the vehicle's VeinsInetMobility modules and its node registry entry */
+    void updatePosition(cModule* mod, const inet::Coord& p, const std::string& edge, double speed, double heading);
+
+    /** @brief drop the cached mobility modules and the node registry entry of a vehicle about to be deleted */
+    void forget(cModule* mod);
+
+    const std::vector<VeinsInetMobility*>& getMobilityModules(cModule* mod);
+};
+
+} // namespace veins
+
+#endif
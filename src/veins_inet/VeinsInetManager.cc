@@ -34,4 +34,20 @@ void VeinsInetManager::initialize(int stage)
 {
     TraCIScenarioManagerLaunchd::initialize(stage);
     VeinsInetManagerBase::initialize(stage);
+
+    // SUMO is launched on connect, after initialization; until then its launch config can still change
+    if (stage == 1 && par("warmStart").boolValue() && firstStepAt > 0) {
+        warmStart.prepare(launchConfig, firstStepAt, par("warmStartCacheDir").stdstringValue());
+    }
+}
+
+void VeinsInetManager::finish()
+{
+    finishMobilityRecording();
+    TraCIScenarioManagerLaunchd::finish();
+    recordCommandQueueStats();
+    if (par("warmStart").boolValue()) {
+        recordScalar("sumoWarmStartLoaded", warmStart.isLoading());
+    }
+    warmStart.finish();
 }
@@ -26,6 +26,7 @@
 
 #include "veins/modules/mobility/traci/TraCIScenarioManagerLaunchd.h"
 #include "veins_inet/VeinsInetManagerBase.h"
+#include "veins_inet/VeinsInetSumoWarmStart.h"
 
 namespace veins {
 
@@ -40,6 +41,10 @@ namespace veins {
  */
 class VEINS_INET_API VeinsInetManager : public VeinsInetManagerBase, public TraCIScenarioManagerLaunchd {
     virtual void initialize(int stage) override;
+    virtual void finish() override;
+
+protected:
+    SumoWarmStart warmStart;
 };
 
 class VEINS_INET_API VeinsInetManagerAccess {
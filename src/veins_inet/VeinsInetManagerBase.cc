@@ -23,7 +23,6 @@
 #include "veins_inet/VeinsInetManagerBase.h"
 
 #include "veins/base/utils/Coord.h"
-#include "veins_inet/VeinsInetMobility.h"
 #include "inet/common/scenario/ScenarioManager.h"
 
 using veins::VeinsInetManagerBase;
@@ -39,6 +38,33 @@ void VeinsInetManagerBase::initialize(int stage)
     if (stage != 1)
         return;
 
+    coalesceVehicleCommands = par("coalesceVehicleCommands");
+
+    std::string recordFile = par("mobilityRecordFile").stdstringValue();
+    if (!recordFile.empty()) {
+        try {
+            mobilityRecorder.open(recordFile, SimTime::getScaleExp());
+        }
+        catch (const std::runtime_error& e) {
+            throw cRuntimeError("%s", e.what());
+        }
+    }
+
+    // forget vehicles that leave the simulation (cached mobility modules, spatial index, queued commands)
+    spawner.configure(this);
+    signalManager.subscribeCallback(this, TraCIScenarioManager::traciModuleRemovedSignal, [this](SignalPayload<cObject*> payload) {
+        cModule* module = dynamic_cast<cModule*>(payload.p);
+        ASSERT(module);
+        spawner.forget(module);
+        commandQueue.remove(module->getId());
+        auto recorded = recordedNodes.find(module->getId());
+        if (recorded != recordedNodes.end()) {
+            mobilityRecorder.step(simTime().raw());
+            mobilityRecorder.remove(recorded->second);
+            recordedNodes.erase(recorded);
+        }
+    });
+
 #if INET_VERSION >= 0x0402
     signalManager.subscribeCallback(this, TraCIScenarioManager::traciModulePreInitSignal, [this](SignalPayload<cObject*> payload) {
         cModule* module = dynamic_cast<cModule*>(payload.p);
@@ -53,14 +79,55 @@ void VeinsInetManagerBase::initialize(int stage)
 #endif
 }
 
+void VeinsInetManagerBase::finish()
+{
+    finishMobilityRecording();
+    TraCIScenarioManager::finish();
+    recordCommandQueueStats();
+}
+
+void VeinsInetManagerBase::finishMobilityRecording()
+{
+    // vehicles removed by the shutdown itself are not part of the recording; the replay tears them down the same way
+    if (!mobilityRecorder.isOpen()) return;
+    recordedNodes.clear();
+    try {
+        mobilityRecorder.close();
+    }
+    catch (const std::runtime_error& e) {
+        throw cRuntimeError("%s", e.what());
+    }
+    recordScalar("mobilityRecords", mobilityRecorder.getNumRecords());
+    recordScalar("mobilityRecordBytes", mobilityRecorder.getNumBytes());
+}
+
+void VeinsInetManagerBase::recordCommandQueueStats()
+{
+    if (!coalesceVehicleCommands) return;
+    recordScalar("vehicleCommandsQueued", commandQueue.getNumQueued());
+    recordScalar("vehicleCommandsSent", commandQueue.getNumSent());
+    recordScalar("vehicleCommandMessages", commandQueue.getNumMessages());
+}
+
+void VeinsInetManagerBase::handleSelfMsg(cMessage* msg)
+{
+    // vehicle commands of the last step go out in one exchange, before SUMO advances
+    if (connection && !commandQueue.empty()) {
+        commandQueue.flush(*connection);
+    }
+    TraCIScenarioManager::handleSelfMsg(msg);
+}
+
 void VeinsInetManagerBase::preInitializeModule(cModule* mod, const std::string& nodeId, const Coord& position, const std::string& road_id, double speed, Heading heading, VehicleSignalSet signals)
 {
     TraCIScenarioManager::preInitializeModule(mod, nodeId, position, road_id, speed, heading, signals);
 
     // pre-initialize VeinsInetMobility
-    auto mobilityModules = getSubmodulesOfType<VeinsInetMobility>(mod);
-    for (auto inetmm : mobilityModules) {
-        inetmm->preInitialize(nodeId, inet::Coord(position.x, position.y), road_id, speed, heading.getRad());
+    spawner.preInitialize(mod, nodeId, inet::Coord(position.x, position.y), road_id, speed, heading.getRad());
+
+    if (mobilityRecorder.isOpen()) {
+        mobilityRecorder.step(simTime().raw());
+        recordedNodes[mod->getId()] = mobilityRecorder.create(nodeId, mod->getNedTypeName(), mod->getName(), mod->isVector() ? mod->getIndex() : -1, mod->getDisplayString().str(), road_id, position.x, position.y, speed, heading.getRad());
     }
 }
 
@@ -68,9 +135,12 @@ void VeinsInetManagerBase::updateModulePosition(cModule* mod, const Coord& p, co
 {
     TraCIScenarioManager::updateModulePosition(mod, p, edge, speed, heading, signals);
 
-    // update position in VeinsInetMobility
-    auto mobilityModules = getSubmodulesOfType<VeinsInetMobility>(mod);
-    for (auto inetmm : mobilityModules) {
-        inetmm->nextPosition(inet::Coord(p.x, p.y), edge, speed, heading.getRad());
+    // update position in VeinsInetMobility and the node registry
+    spawner.updatePosition(mod, inet::Coord(p.x, p.y), edge, speed, heading.getRad());
+
+    auto recorded = recordedNodes.find(mod->getId());
+    if (recorded != recordedNodes.end()) {
+        mobilityRecorder.step(simTime().raw());
+        mobilityRecorder.update(recorded->second, edge, p.x, p.y, speed, heading.getRad());
     }
 }
@@ -23,10 +23,15 @@
 #pragma once
 
 #include "veins_inet/veins_inet.h"
+#include "veins_inet/VeinsInetHostSpawner.h"
+#include "veins_inet/VeinsInetMobilityTrace.h"
+#include "veins_inet/VeinsInetVehicleCommandQueue.h"
 
 #include "veins/modules/mobility/traci/TraCIScenarioManager.h"
 #include "veins/modules/utility/SignalManager.h"
 
+#include <unordered_map>
+
 namespace veins {
 
 /**
@@ -43,12 +48,32 @@ public:
     virtual ~VeinsInetManagerBase();
 
     void initialize(int stage) override;
+    void finish() override;
 
     virtual void preInitializeModule(cModule* mod, const std::string& nodeId, const Coord& position, const std::string& road_id, double speed, Heading heading, VehicleSignalSet signals) override;
     virtual void updateModulePosition(cModule* mod, const Coord& p, const std::string& edge, double speed, Heading heading, VehicleSignalSet signals) override;
 
+    /** @brief queue for vehicle commands of this step, or nullptr if they should be sent right away */
+    VehicleCommandQueue* getVehicleCommandQueue()
+    {
+        return coalesceVehicleCommands ? &commandQueue : nullptr;
+    }
+
 protected:
     SignalManager signalManager;
+    VeinsInetHostSpawner spawner;  // VeinsInetMobility and node registry updates; modules are created by TraCIScenarioManager
+
+    bool coalesceVehicleCommands = false;
+    VehicleCommandQueue commandQueue;
+
+    // Recording of the vehicles' mobility for VeinsInetReplayManager
+    MobilityTraceWriter mobilityRecorder;
+    std::unordered_map<int, uint32_t> recordedNodes;  // module id -> recorder handle
+
+    virtual void handleSelfMsg(cMessage* msg) override;
+    void recordCommandQueueStats();
+    /** @brief close the mobility recording; call before the managed modules are torn down */
+    void finishMobilityRecording();
 };
 
 class VEINS_INET_API VeinsInetManagerBaseAccess {
@@ -31,3 +31,10 @@ void VeinsInetManagerForker::initialize(int stage)
     TraCIScenarioManagerForker::initialize(stage);
     VeinsInetManagerBase::initialize(stage);
 }
+
+void VeinsInetManagerForker::finish()
+{
+    finishMobilityRecording();
+    TraCIScenarioManagerForker::finish();
+    recordCommandQueueStats();
+}
@@ -26,11 +26,17 @@
 //
 
 #include "veins_inet/VeinsInetMobility.h"
+#include "veins_inet/VeinsInetHeadless.h"
+#include "veins_inet/VeinsInetManagerBase.h"
+#include "veins_inet/VeinsInetSyntheticManager.h"
 
 #include "inet/common/INETMath.h"
 #include "inet/common/Units.h"
 #include "inet/common/geometry/common/GeographicCoordinateSystem.h"
 
+#include <algorithm>
+#include <climits>
+
 namespace veins {
 
 using namespace inet::units::values;
@@ -61,23 +67,43 @@ void VeinsInetMobility::initialize(int stage)
 
     // We patch the OMNeT++ Display String to set the initial position. Make sure this works.
     ASSERT(hasPar("initFromDisplayString") && par("initFromDisplayString"));
+
+    if (stage == inet::INITSTAGE_LOCAL) {
+        headless = isHeadless();
+    }
 }
 
 void VeinsInetMobility::nextPosition(const inet::Coord& position, std::string road_id, double speed, double angle)
 {
     Enter_Method_Silent();
 
+    odometer += position.distance(lastPosition);
     lastPosition = position;
     lastVelocity = inet::Coord(cos(angle), -sin(angle)) * speed;
     lastOrientation = inet::Quaternion(inet::EulerAngles(rad(-angle), rad(0.0), rad(0.0)));
 
-    // Update display string to show node is getting updates
-    auto hostMod = getParentModule();
-    if (std::string(hostMod->getDisplayString().getTagArg("veins", 0)) == ". ") {
-        hostMod->getDisplayString().setTagArg("veins", 0, " .");
+    // Follow the vehicle along its cached route (junction-internal edges start with ':')
+    routeChangeQueued = false; // queued commands were sent before this step
+    roadId = std::move(road_id);
+    if (routeValid && !roadId.empty() && roadId[0] != ':' && roadId != plannedRoute[routeIndex]) {
+        auto it = std::find(plannedRoute.begin() + routeIndex, plannedRoute.end(), roadId);
+        if (it != plannedRoute.end()) {
+            routeIndex = it - plannedRoute.begin();
+        }
+        else {
+            routeValid = false; // SUMO changed the route by itself
+        }
     }
-    else {
-        hostMod->getDisplayString().setTagArg("veins", 0, ". ");
+
+    // Update display string to show node is getting updates
+    if (!headless) {
+        auto hostMod = getParentModule();
+        if (std::string(hostMod->getDisplayString().getTagArg("veins", 0)) == ". ") {
+            hostMod->getDisplayString().setTagArg("veins", 0, " .");
+        }
+        else {
+            hostMod->getDisplayString().setTagArg("veins", 0, ". ");
+        }
     }
 
     emitMobilityStateChangedSignal();
@@ -156,6 +182,92 @@ void VeinsInetMobility::handleSelfMessage(cMessage* message)
 {
 }
 
+int VeinsInetMobility::getRemainingRoadCount()
+{
+    // SUMO does not know the new route before the queued command is sent; report it as unfinished
+    if (routeChangeQueued) return INT_MAX;
+    if (VeinsInetSyntheticManager* synthetic = getSyntheticManager()) return synthetic->getRemainingRoadCount(getParentModule());
+    // A replayed vehicle has no route to ask for; it is never at its destination
+    if (!getVehicleCommandInterface()) return INT_MAX;
+    if (!routeValid) fetchPlannedRoute();
+    return plannedRoute.size() - routeIndex;
+}
+
+void VeinsInetMobility::changeTarget(const std::string& edge)
+{
+    if (VeinsInetSyntheticManager* synthetic = getSyntheticManager()) {
+        synthetic->changeTarget(getParentModule(), edge);
+    }
+    else if (VehicleCommandQueue* queue = getCommandQueue()) {
+        queue->changeTarget(getParentModule()->getId(), getExternalId(), edge);
+        routeChangeQueued = true;
+    }
+    else if (auto vehicle = getVehicleCommandInterface()) {
+        vehicle->changeTarget(edge);
+    }
+    // Same target: SUMO's new route normally matches the cached one, and a vehicle leaving it
+    // is caught in the position update; only a new target needs the route to be fetched again
+    if (routeValid && plannedRoute.back() != edge) routeValid = false;
+}
+
+void VeinsInetMobility::setSpeed(double speed)
+{
+    if (VeinsInetSyntheticManager* synthetic = getSyntheticManager()) {
+        synthetic->setSpeed(getParentModule(), speed);
+    }
+    else if (VehicleCommandQueue* queue = getCommandQueue()) {
+        queue->setSpeed(getParentModule()->getId(), getExternalId(), speed);
+    }
+    else if (auto vehicle = getVehicleCommandInterface()) {
+        vehicle->setSpeed(speed);
+    }
+}
+
+void VeinsInetMobility::setColor(const TraCIColor& color)
+{
+    if (VehicleCommandQueue* queue = getCommandQueue()) {
+        queue->setColor(getParentModule()->getId(), getExternalId(), color);
+    }
+    else if (auto vehicle = getVehicleCommandInterface()) {
+        vehicle->setColor(color);
+    }
+}
+
+VehicleCommandQueue* VeinsInetMobility::getCommandQueue() const
+{
+    if (!commandQueueResolved) {
+        auto inetManager = dynamic_cast<VeinsInetManagerBase*>(getManager());
+        commandQueue = inetManager ? inetManager->getVehicleCommandQueue() : nullptr;
+        commandQueueResolved = true;
+    }
+    return commandQueue;
+}
+
+VeinsInetSyntheticManager* VeinsInetMobility::getSyntheticManager() const
+{
+    if (!syntheticManagerResolved) {
+        syntheticManager = VeinsInetSyntheticManagerAccess().get();
+        syntheticManagerResolved = true;
+    }
+    return syntheticManager;
+}
+
+bool VeinsInetMobility::isControllable() const
+{
+    return getSyntheticManager() || getVehicleCommandInterface();
+}
+
+void VeinsInetMobility::fetchPlannedRoute()
+{
+    auto roads = getVehicleCommandInterface()->getPlannedRoadIds();
+    plannedRoute.assign(roads.begin(), roads.end());
+
+    // On a junction-internal edge count from the start of the route until the next regular edge
+    auto it = std::find(plannedRoute.begin(), plannedRoute.end(), roadId);
+    routeIndex = it != plannedRoute.end() ? it - plannedRoute.begin() : 0;
+    routeValid = !plannedRoute.empty();
+}
+
 std::string VeinsInetMobility::getExternalId() const
 {
     if (external_id == "") throw cRuntimeError("TraCIMobility::getExternalId called with no external_id set yet");
@@ -164,19 +276,22 @@ std::string VeinsInetMobility::getExternalId() const
 
 TraCIScenarioManager* VeinsInetMobility::getManager() const
 {
-    if (!manager) manager = TraCIScenarioManagerAccess().get();
+    if (!managerResolved) {
+        manager = TraCIScenarioManagerAccess().get();
+        managerResolved = true;
+    }
     return manager;
 }
 
 TraCICommandInterface* VeinsInetMobility::getCommandInterface() const
 {
-    if (!commandInterface) commandInterface = getManager()->getCommandInterface();
+    if (!commandInterface && getManager()) commandInterface = getManager()->getCommandInterface();
     return commandInterface;
 }
 
 TraCICommandInterface::Vehicle* VeinsInetMobility::getVehicleCommandInterface() const
 {
-    if (!vehicleCommandInterface) vehicleCommandInterface = new TraCICommandInterface::Vehicle(getCommandInterface()->vehicle(getExternalId()));
+    if (!vehicleCommandInterface && getCommandInterface()) vehicleCommandInterface = new TraCICommandInterface::Vehicle(getCommandInterface()->vehicle(getExternalId()));
     return vehicleCommandInterface;
 }
 
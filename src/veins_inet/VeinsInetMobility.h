@@ -37,9 +37,16 @@ using namespace omnetpp;
 
 #include "veins/modules/mobility/traci/TraCIScenarioManager.h"
 #include "veins/modules/mobility/traci/TraCICommandInterface.h"
+#include "veins/modules/mobility/traci/TraCIColor.h"
+
+#include <string>
+#include <vector>
 
 namespace veins {
 
+class VehicleCommandQueue;
+class VeinsInetSyntheticManager;
+
 class VEINS_INET_API VeinsInetMobility : public inet::MobilityBase {
 public:
     VeinsInetMobility();
@@ -72,7 +79,41 @@ public:
     virtual inet::Quaternion getCurrentAngularAcceleration() override;
 #endif
 
+    /** @brief edge of the last position update from SUMO */
+    virtual const std::string& getRoadId() const { return roadId; }
+
+    /** @brief distance driven in m, summed over the position updates since preInitialize() */
+    virtual double getOdometer() const { return odometer; }
+
+    /**
+     * @brief number of edges of the planned route from the current one to the end (at least 1 while on the route)
+     *
+     * The route is fetched from SUMO once, on the first call after the vehicle appeared or its
+     * target was changed to another edge through changeTarget(); after that, progress along it is
+     * tracked from the edge ids of the regular position updates, without further TraCI queries.
+     */
+    virtual int getRemainingRoadCount();
+
+    /**
+     * @brief let SUMO route the vehicle to edge; use this instead of the vehicle command interface so the cached route stays valid
+     *
+     * This and the other vehicle commands below go through the manager's
+     * command queue if it has one: they take effect with the next
+     * simulation step, and only the last command of each kind per step is sent.
+     */
+    virtual void changeTarget(const std::string& edge);
+
+    /** @brief set the vehicle's speed in m/s; -1 hands control back to SUMO */
+    virtual void setSpeed(double speed);
+
+    /** @brief set the vehicle's color in the SUMO GUI */
+    virtual void setColor(const TraCIColor& color);
+
+    /** @brief whether the vehicle commands above have an effect: a TraCI vehicle or one of the VeinsInetSyntheticManager */
+    virtual bool isControllable() const;
+
     virtual std::string getExternalId() const;
+    /** @brief the TraCI manager; these three return nullptr for vehicles replayed or moved without SUMO */
     virtual TraCIScenarioManager* getManager() const;
     virtual TraCICommandInterface* getCommandInterface() const;
     virtual TraCICommandInterface::Vehicle* getVehicleCommandInterface() const;
@@ -84,12 +125,32 @@ protected:
     /** @brief The last angular velocity that was set by nextPosition(). */
     inet::Quaternion lastAngularVelocity;
 
-    mutable TraCIScenarioManager* manager = nullptr; /**< cached value */
+    mutable TraCIScenarioManager* manager = nullptr; /**< cached value; stays nullptr when replaying a recorded trace */
+    mutable bool managerResolved = false;
     mutable TraCICommandInterface* commandInterface = nullptr; /**< cached value */
     mutable TraCICommandInterface::Vehicle* vehicleCommandInterface = nullptr; /**< cached value */
 
     std::string external_id; /**< identifier used by TraCI server to refer to this node */
 
+    bool headless = false; /**< skip the display string update in nextPosition() */
+
+    std::string roadId; /**< edge of the last update */
+    double odometer = 0; /**< straight-line distance between consecutive updates, summed */
+    std::vector<std::string> plannedRoute; /**< route as last fetched from SUMO */
+    size_t routeIndex = 0; /**< position of roadId in plannedRoute */
+    bool routeValid = false; /**< plannedRoute is still the vehicle's route */
+    bool routeChangeQueued = false; /**< a changeTarget() is waiting in the command queue */
+
+    mutable VehicleCommandQueue* commandQueue = nullptr; /**< cached value */
+    mutable bool commandQueueResolved = false;
+
+    mutable VeinsInetSyntheticManager* syntheticManager = nullptr; /**< cached value; moves the vehicle instead of SUMO if set */
+    mutable bool syntheticManagerResolved = false;
+
+    void fetchPlannedRoute();
+    VehicleCommandQueue* getCommandQueue() const;
+    VeinsInetSyntheticManager* getSyntheticManager() const;
+
 protected:
     virtual void setInitialPosition() override;
 
@@ -0,0 +1,302 @@
+// Binary vehicle mobility trace (.evmob): writer and reader; no OMNeT++ dependency
+
+#include "veins_inet/VeinsInetMobilityTrace.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using namespace veins;
+
+namespace {
+
+const size_t WRITE_BUFFER_SIZE = 1 << 16;
+const size_t READ_BUFFER_SIZE = 1 << 16;
+
+} // namespace
+
+MobilityTraceWriter::~MobilityTraceWriter()
+{
+    // Without close() the trace stays readable, just not marked complete
+    if (file) {
+        writeBuffer();
+        fclose(file);
+    }
+}
+
+void MobilityTraceWriter::open(const std::string& path, int simtimeScaleExp)
+{
+    if (file) throw std::runtime_error("mobility trace " + this->path + " is already open");
+    file = fopen(path.c_str(), "wb");
+    if (!file) throw std::runtime_error("cannot open mobility trace " + path + " for writing");
+    this->path = path;
+
+    uint32_t version = MOBILITY_TRACE_VERSION;
+    int32_t scaleExp = simtimeScaleExp;
+    buffer.append(MOBILITY_TRACE_MAGIC, sizeof(MOBILITY_TRACE_MAGIC));
+    buffer.append(reinterpret_cast<const char*>(&version), sizeof(version));
+    buffer.append(reinterpret_cast<const char*>(&scaleExp), sizeof(scaleExp));
+}
+
+void MobilityTraceWriter::close()
+{
+    if (!file) return;
+    buffer.push_back('E');
+    writeBuffer();
+    bool failed = ferror(file) != 0;
+    if (fclose(file) != 0) failed = true;
+    file = nullptr;
+    if (failed) throw std::runtime_error("error writing mobility trace " + path);
+}
+
+void MobilityTraceWriter::step(int64_t time)
+{
+    if (hasTime && time == currentTime) return;
+    buffer.push_back('T');
+    buffer.append(reinterpret_cast<const char*>(&time), sizeof(time));
+    currentTime = time;
+    hasTime = true;
+}
+
+uint32_t MobilityTraceWriter::create(const std::string& nodeId, const std::string& moduleType, const std::string& moduleName, int moduleIndex, const std::string& displayString, const std::string& roadId, double x, double y, double speed, double heading)
+{
+    // Strings first: their definitions must precede the record that uses them
+    Node node{intern(nodeId), intern(roadId), roadId};
+    uint32_t type = intern(moduleType);
+    uint32_t name = intern(moduleName);
+    uint32_t display = intern(displayString);
+
+    buffer.push_back('C');
+    putVarint(node.nodeId);
+    putVarint(type);
+    putVarint(name);
+    putVarint(moduleIndex + 1);
+    putVarint(display);
+    putVarint(node.roadId);
+    putDouble(x);
+    putDouble(y);
+    putDouble(speed);
+    putDouble(heading);
+    numRecords++;
+
+    nodes.push_back(std::move(node));
+    if (buffer.size() >= WRITE_BUFFER_SIZE) writeBuffer();
+    return nodes.size() - 1;
+}
+
+void MobilityTraceWriter::update(uint32_t handle, const std::string& roadId, double x, double y, double speed, double heading)
+{
+    Node& node = nodes.at(handle);
+    if (roadId != node.road) {
+        node.roadId = intern(roadId);
+        node.road = roadId;
+    }
+
+    buffer.push_back('U');
+    putVarint(node.nodeId);
+    putVarint(node.roadId);
+    putDouble(x);
+    putDouble(y);
+    putDouble(speed);
+    putDouble(heading);
+    numRecords++;
+
+    if (buffer.size() >= WRITE_BUFFER_SIZE) writeBuffer();
+}
+
+void MobilityTraceWriter::remove(uint32_t handle)
+{
+    buffer.push_back('D');
+    putVarint(nodes.at(handle).nodeId);
+    numRecords++;
+}
+
+uint32_t MobilityTraceWriter::intern(const std::string& s)
+{
+    auto it = strings.find(s);
+    if (it != strings.end()) return it->second;
+
+    uint32_t id = strings.size();
+    strings.emplace(s, id);
+    buffer.push_back('S');
+    putVarint(s.size());
+    buffer.append(s);
+    return id;
+}
+
+void MobilityTraceWriter::putVarint(uint64_t value)
+{
+    while (value >= 0x80) {
+        buffer.push_back((char) ((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back((char) value);
+}
+
+void MobilityTraceWriter::putDouble(double value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void MobilityTraceWriter::writeBuffer()
+{
+    if (buffer.empty()) return;
+    fwrite(buffer.data(), 1, buffer.size(), file);
+    numBytes += buffer.size();
+    buffer.clear();
+}
+
+MobilityTraceReader::~MobilityTraceReader()
+{
+    if (file) fclose(file);
+}
+
+void MobilityTraceReader::open(const std::string& path)
+{
+    if (file) throw std::runtime_error("mobility trace " + this->path + " is already open");
+    file = fopen(path.c_str(), "rb");
+    if (!file) throw std::runtime_error("cannot open mobility trace " + path);
+    this->path = path;
+    buffer.resize(READ_BUFFER_SIZE);
+    long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) throw std::runtime_error("cannot determine the size of mobility trace " + path);
+    unread = size;
+
+    char magic[sizeof(MOBILITY_TRACE_MAGIC)];
+    uint32_t version;
+    int32_t scaleExp;
+    if (!fill(sizeof(magic) + sizeof(version) + sizeof(scaleExp))) throw std::runtime_error(path + " is not a mobility trace");
+    read(magic, sizeof(magic));
+    read(&version, sizeof(version));
+    read(&scaleExp, sizeof(scaleExp));
+    if (memcmp(magic, MOBILITY_TRACE_MAGIC, sizeof(magic)) != 0) throw std::runtime_error(path + " is not a mobility trace");
+    if (version != MOBILITY_TRACE_VERSION) throw std::runtime_error("unsupported mobility trace version in " + path);
+    simtimeScaleExp = scaleExp;
+}
+
+bool MobilityTraceReader::next(Record& record)
+{
+    try {
+        return readRecord(record);
+    }
+    catch (const std::runtime_error&) {
+        // A record cut off by the end of the file ends the trace; anything else is an error
+        if (truncated) return false;
+        throw;
+    }
+}
+
+bool MobilityTraceReader::readRecord(Record& record)
+{
+    uint8_t tag;
+    while (!complete && !truncated && readByte(tag)) {
+        switch (tag) {
+        case 'S': {
+            uint64_t length = readVarint();
+            // Checked before allocating: a corrupt length must not ask for gigabytes
+            if (length > unread + (end - pos)) {
+                truncated = true;
+                throw std::runtime_error("mobility trace " + path + " ends within a string of length " + std::to_string(length));
+            }
+            std::string s(length, '\0');
+            read(&s[0], length);
+            strings.push_back(std::move(s));
+            break;
+        }
+        case 'T':
+            read(&currentTime, sizeof(currentTime));
+            break;
+        case 'C': {
+            record.kind = RECORD_CREATE;
+            record.time = currentTime;
+            record.nodeId = readStringId();
+            record.moduleType = readStringId();
+            record.moduleName = readStringId();
+            record.moduleIndex = (int) readVarint() - 1;
+            record.displayString = readStringId();
+            record.roadId = readStringId();
+            record.x = readDouble();
+            record.y = readDouble();
+            record.speed = readDouble();
+            record.heading = readDouble();
+            return true;
+        }
+        case 'U':
+            record.kind = RECORD_UPDATE;
+            record.time = currentTime;
+            record.nodeId = readStringId();
+            record.roadId = readStringId();
+            record.x = readDouble();
+            record.y = readDouble();
+            record.speed = readDouble();
+            record.heading = readDouble();
+            return true;
+        case 'D':
+            record.kind = RECORD_DELETE;
+            record.time = currentTime;
+            record.nodeId = readStringId();
+            return true;
+        case 'E':
+            complete = true;
+            break;
+        default:
+            throw std::runtime_error("malformed mobility trace " + path + ": unknown record tag " + std::to_string(tag));
+        }
+    }
+    return false;
+}
+
+bool MobilityTraceReader::fill(size_t n)
+{
+    if (end - pos >= n) return true;
+    memmove(buffer.data(), buffer.data() + pos, end - pos);
+    end -= pos;
+    pos = 0;
+    if (buffer.size() < n) buffer.resize(n);
+    size_t count = fread(buffer.data() + end, 1, buffer.size() - end, file);
+    end += count;
+    unread -= std::min<uint64_t>(count, unread);
+    return end >= n;
+}
+
+bool MobilityTraceReader::readByte(uint8_t& value)
+{
+    if (!fill(1)) return false;
+    value = buffer[pos++];
+    return true;
+}
+
+void MobilityTraceReader::read(void* out, size_t n)
+{
+    if (!fill(n)) {
+        truncated = true;
+        throw std::runtime_error("mobility trace " + path + " ends within a record");
+    }
+    memcpy(out, buffer.data() + pos, n);
+    pos += n;
+}
+
+uint64_t MobilityTraceReader::readVarint()
+{
+    uint64_t value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        uint8_t byte;
+        read(&byte, 1);
+        value |= (uint64_t) (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    throw std::runtime_error("malformed mobility trace " + path + ": varint too long");
+}
+
+uint32_t MobilityTraceReader::readStringId()
+{
+    uint64_t id = readVarint();
+    if (id >= strings.size()) throw std::runtime_error("malformed mobility trace " + path + ": undefined string id");
+    return id;
+}
+
+double MobilityTraceReader::readDouble()
+{
+    double value;
+    read(&value, sizeof(value));
+    return value;
+}
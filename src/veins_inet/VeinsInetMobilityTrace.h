@@ -0,0 +1,165 @@
+// Binary vehicle mobility trace (.evmob): writer and reader; no OMNeT++ dependency
+
+#ifndef __VEINS_INET_MOBILITYTRACE_H_
+#define __VEINS_INET_MOBILITYTRACE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// Mobility trace file layout (version 1). Integers are little-endian,
+// varints are unsigned LEB128, doubles are IEEE 754 binary64. Fixed-size
+// values are copied in host byte order, so big-endian hosts are rejected
+// at compile time below.
+//
+//   file   := magic[8] = "EVMOBTR\0", u32 version, i32 simtimeScaleExp, record*
+//   record := u8 tag, payload
+//
+//   'S' string  varint length, bytes; gets the next string id (0, 1, ...)
+//   'T' step    i64 raw simulation time of the records that follow
+//   'C' create  varint nodeId, varint moduleType, varint moduleName,
+//               varint moduleIndex + 1 (0: not a vector), varint displayString,
+//               varint roadId, f64 x, f64 y, f64 speed, f64 heading
+//   'U' update  varint nodeId, varint roadId, f64 x, f64 y, f64 speed, f64 heading
+//   'D' delete  varint nodeId
+//   'E' end of trace
+//
+// All names (TraCI ids, edges, module types) are string ids. Positions,
+// speeds (m/s) and headings (rad) are stored exactly as the manager passed
+// them on, so a replay moves the nodes bit-identically to the recorded run.
+// A trace without 'E' was cut short; it is readable up to its last record.
+//
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "The mobility trace format is written in host byte order and requires a little-endian host"
+#endif
+
+namespace veins {
+
+static const char MOBILITY_TRACE_MAGIC[8] = {'E', 'V', 'M', 'O', 'B', 'T', 'R', '\0'};
+static const uint32_t MOBILITY_TRACE_VERSION = 1;
+
+/**
+ * Appends mobility records to a trace file. Strings are interned on first
+ * use, and each node's edge is only looked up again when it changes.
+ * Throws std::runtime_error if the file cannot be written.
+ */
+class MobilityTraceWriter {
+public:
+    MobilityTraceWriter() = default;
+    ~MobilityTraceWriter();
+    MobilityTraceWriter(const MobilityTraceWriter&) = delete;
+    MobilityTraceWriter& operator=(const MobilityTraceWriter&) = delete;
+
+    void open(const std::string& path, int simtimeScaleExp);
+    bool isOpen() const { return file != nullptr; }
+
+    /** @brief write the end record and close the file */
+    void close();
+
+    /** @brief start the records of a new time step, unless time is the current one */
+    void step(int64_t time);
+
+    /** @brief record a new node; returns the handle for its update() and remove() records */
+    uint32_t create(const std::string& nodeId, const std::string& moduleType, const std::string& moduleName, int moduleIndex, const std::string& displayString, const std::string& roadId, double x, double y, double speed, double heading);
+    void update(uint32_t handle, const std::string& roadId, double x, double y, double speed, double heading);
+    void remove(uint32_t handle);
+
+    uint64_t getNumRecords() const { return numRecords; }
+    uint64_t getNumBytes() const { return numBytes + buffer.size(); }
+
+protected:
+    struct Node {
+        uint32_t nodeId;
+        uint32_t roadId;
+        std::string road;
+    };
+
+    FILE* file = nullptr;
+    std::string path;
+    std::string buffer;
+    std::unordered_map<std::string, uint32_t> strings;
+    std::vector<Node> nodes;
+    int64_t currentTime = 0;
+    bool hasTime = false;
+    uint64_t numRecords = 0;
+    uint64_t numBytes = 0;
+
+    uint32_t intern(const std::string& s);
+    void putVarint(uint64_t value);
+    void putDouble(double value);
+    void writeBuffer();
+};
+
+/**
+ * Reads a mobility trace record by record, without loading the whole
+ * file. Throws std::runtime_error on malformed files.
+ */
+class MobilityTraceReader {
+public:
+    enum Kind {
+        RECORD_CREATE,
+        RECORD_UPDATE,
+        RECORD_DELETE,
+    };
+
+    // String fields are ids for getString()
+    struct Record {
+        Kind kind;
+        int64_t time;
+        uint32_t nodeId;
+        uint32_t moduleType;     // CREATE only
+        uint32_t moduleName;     // CREATE only
+        int moduleIndex;         // CREATE only; -1 if not a vector
+        uint32_t displayString;  // CREATE only
+        uint32_t roadId;         // CREATE and UPDATE
+        double x;
+        double y;
+        double speed;
+        double heading;
+    };
+
+    MobilityTraceReader() = default;
+    ~MobilityTraceReader();
+    MobilityTraceReader(const MobilityTraceReader&) = delete;
+    MobilityTraceReader& operator=(const MobilityTraceReader&) = delete;
+
+    void open(const std::string& path);
+    int getSimtimeScaleExp() const { return simtimeScaleExp; }
+
+    /** @brief read the next create, update or delete record; false at the end of the trace or at a cut-off record */
+    bool next(Record& record);
+
+    const std::string& getString(uint32_t id) const { return strings.at(id); }
+
+    /** @brief whether the end record was reached (false for a trace that was cut short) */
+    bool isComplete() const { return complete; }
+
+protected:
+    FILE* file = nullptr;
+    std::string path;
+    std::vector<char> buffer;
+    size_t pos = 0;
+    size_t end = 0;
+    uint64_t unread = 0;  // bytes of the file not yet in buffer
+    std::vector<std::string> strings;
+    int simtimeScaleExp = 0;
+    int64_t currentTime = 0;
+    bool complete = false;
+    bool truncated = false;
+
+    bool readRecord(Record& record);
+    bool fill(size_t n);
+    bool readByte(uint8_t& value);
+    void read(void* out, size_t n);
+    uint64_t readVarint();
+    uint32_t readStringId();
+    double readDouble();
+};
+
+} // namespace veins
+
+#endif
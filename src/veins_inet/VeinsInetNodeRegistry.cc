@@ -0,0 +1,118 @@
+// Network-wide registry of node mobility handles
+
+#include "veins_inet/VeinsInetNodeRegistry.h"
+#include <cstdlib>
+#include <cstring>
+#include <set>
+
+using namespace veins;
+
+Define_Module(VeinsInetNodeRegistry);
+
+void VeinsInetNodeRegistry::initialize()
+{
+    setup();
+}
+
+void VeinsInetNodeRegistry::setup()
+{
+    // Apps declared before us in the network may query before our initialize()
+    if (ready) return;
+    ready = true;
+
+    gridCellSize = par("gridCellSize").doubleValueInUnit("m");
+
+    std::set<std::string> names;
+    cStringTokenizer tokenizer(par("staticNodes"));
+    while (tokenizer.hasMoreTokens()) names.insert(tokenizer.nextToken());
+
+    for (cModule::SubmoduleIterator it(getSimulation()->getSystemModule()); !it.end(); ++it) {
+        cModule* node = *it;
+        if (names.count(node->getName()) == 0) continue;
+        auto mobility = dynamic_cast<inet::IMobility*>(node->getSubmodule("mobility"));
+        if (mobility) staticMobility[node->getFullName()] = mobility;
+    }
+    EV_INFO << "NodeRegistry: cached " << staticMobility.size() << " static node(s)" << endl;
+}
+
+void VeinsInetNodeRegistry::handleMessage(cMessage* msg)
+{
+    throw cRuntimeError("This module does not handle messages");
+}
+
+inet::IMobility* VeinsInetNodeRegistry::getMobility(const char* nodeName)
+{
+    setup();
+    auto it = staticMobility.find(nodeName);
+    return it != staticMobility.end() ? it->second : resolveMobility(nodeName);
+}
+
+inet::IMobility* VeinsInetNodeRegistry::resolveMobility(const char* nodeName)
+{
+    // "name[index]" or "name", as a direct child of the network
+    cModule* network = getSimulation()->getSystemModule();
+    cModule* node = nullptr;
+    const char* bracket = strchr(nodeName, '[');
+    if (bracket) {
+        std::string name(nodeName, bracket - nodeName);
+        node = network->getSubmodule(name.c_str(), atoi(bracket + 1));
+    }
+    else {
+        node = network->getSubmodule(nodeName);
+    }
+    return node ? dynamic_cast<inet::IMobility*>(node->getSubmodule("mobility")) : nullptr;
+}
+
+void VeinsInetNodeRegistry::indexStaticNodes()
+{
+    // Deferred to the first query: static positions are only valid after all mobility modules initialized
+    setup();
+    if (staticIndexed) return;
+    staticIndexed = true;
+
+    for (auto& entry : staticMobility) {
+        cModule* node = check_and_cast<cModule*>(entry.second)->getParentModule();
+        inet::Coord position = entry.second->getCurrentPosition();
+        getGrid(node->getName()).update(node->getId(), position.x, position.y);
+    }
+}
+
+SpatialGrid& VeinsInetNodeRegistry::getGrid(const char* nodeType)
+{
+    auto it = grids.find(nodeType);
+    if (it == grids.end()) it = grids.emplace(nodeType, SpatialGrid(gridCellSize)).first;
+    return it->second;
+}
+
+void VeinsInetNodeRegistry::updateNodePosition(cModule* node, const inet::Coord& position)
+{
+    setup();
+    getGrid(node->getName()).update(node->getId(), position.x, position.y);
+}
+
+void VeinsInetNodeRegistry::removeNode(cModule* node)
+{
+    auto it = grids.find(node->getName());
+    if (it != grids.end()) it->second.remove(node->getId());
+}
+
+void VeinsInetNodeRegistry::getNodesInRange(const char* nodeType, const inet::Coord& position, double range, std::vector<cModule*>& nodes)
+{
+    indexStaticNodes();
+    auto it = grids.find(nodeType);
+    if (it == grids.end()) return;
+
+    queryIds.clear();
+    it->second.queryRange(position.x, position.y, range, queryIds);
+    for (int id : queryIds) nodes.push_back(getSimulation()->getModule(id));
+}
+
+cModule* VeinsInetNodeRegistry::getNearestNode(const char* nodeType, const inet::Coord& position, double maxRange, double* distance)
+{
+    indexStaticNodes();
+    auto it = grids.find(nodeType);
+    if (it == grids.end()) return nullptr;
+
+    int id = it->second.queryNearest(position.x, position.y, maxRange, distance);
+    return id >= 0 ? getSimulation()->getModule(id) : nullptr;
+}
@@ -0,0 +1,78 @@
+// Network-wide registry of node mobility handles
+
+#ifndef __VEINS_INET_NODEREGISTRY_H_
+#define __VEINS_INET_NODEREGISTRY_H_
+
+#include "veins_inet/veins_inet.h"
+#include "veins_inet/VeinsInetSpatialGrid.h"
+#include "inet/mobility/contract/IMobility.h"
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Cached IMobility handles of the static nodes of the network, and a
+ * spatial index of all nodes for range queries.
+ *
+ * Nodes named in staticNodes are resolved in one pass over the network's
+ * submodules, on initialize() or on the first query, whichever comes
+ * first. Other (dynamic) nodes are looked up on every query and not
+ * cached, since the manager may delete them at any time.
+ *
+ * The spatial index keeps one SpatialGrid per node type (module name:
+ * "cs", "rsu", "ev"). Static nodes enter it on the first spatial query,
+ * once their mobility modules have initialized; vehicles are added, moved
+ * and removed by the VeinsInetManager as SUMO reports them.
+ */
+class VEINS_INET_API VeinsInetNodeRegistry : public cSimpleModule {
+protected:
+    bool ready = false;
+    bool staticIndexed = false;
+    double gridCellSize;
+    std::map<std::string, inet::IMobility*> staticMobility;  // by full name, e.g. "cs[0]"
+    std::map<std::string, SpatialGrid, std::less<>> grids;  // by node type
+    std::vector<int> queryIds;
+
+public:
+    /** @brief mobility of the network-level node nodeName ("cs[0]"); nullptr if there is none */
+    inet::IMobility* getMobility(const char* nodeName);
+
+    /** @brief uncached lookup of a network-level node's mobility; nullptr if there is none */
+    static inet::IMobility* resolveMobility(const char* nodeName);
+
+    /** @brief node (a vehicle) is now at position; adds it to the spatial index if it is new */
+    void updateNodePosition(cModule* node, const inet::Coord& position);
+
+    /** @brief node leaves the simulation */
+    void removeNode(cModule* node);
+
+    /** @brief append all nodes of type nodeType ("cs") within range of position to nodes, in no particular order */
+    void getNodesInRange(const char* nodeType, const inet::Coord& position, double range, std::vector<cModule*>& nodes);
+
+    /** @brief node of type nodeType closest to position within maxRange, or nullptr; its distance goes to *distance */
+    cModule* getNearestNode(const char* nodeType, const inet::Coord& position, double maxRange = INFINITY, double* distance = nullptr);
+
+protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage* msg) override;
+
+    void setup();
+    void indexStaticNodes();
+    SpatialGrid& getGrid(const char* nodeType);
+};
+
+class VEINS_INET_API VeinsInetNodeRegistryAccess {
+public:
+    /** @brief the network's nodeRegistry, or nullptr if apps should resolve nodes themselves */
+    VeinsInetNodeRegistry* get()
+    {
+        return dynamic_cast<VeinsInetNodeRegistry*>(getSimulation()->getSystemModule()->getSubmodule("nodeRegistry"));
+    };
+};
+
+} // namespace veins
+
+#endif
@@ -0,0 +1,121 @@
+// Per-module receive rate limiter: token bucket or sliding/fixed window, without timers
+
+#include "veins_inet/VeinsInetRateLimiter.h"
+#include "veins_inet/ChargingProtocol_m.h"
+#include "inet/networklayer/common/L3AddressTag_m.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+
+using namespace veins;
+
+namespace {
+
+// Indexed by RateLimiter::getCommTypeCode(); same names as getCommunicationType()
+const char* const COMM_TYPE_NAMES[8] = {"UNKNOWN", "BSM", "EV2EV", "EV2CS", "EV2RSU", "ChargeReq", "ChargeResp", "ChargeDone"};
+
+} // namespace
+
+void RateLimiter::configure(cComponent* module)
+{
+    this->module = module;
+    droppedSignal = cComponent::registerSignal("rateLimitDropped");
+
+    rate = module->par("maxPktPerSecond").intValue();
+    if (rate < 0) throw cRuntimeError("maxPktPerSecond must not be negative");
+    int burstPar = module->par("rateLimitBurst");
+    if (burstPar < 0) throw cRuntimeError("rateLimitBurst must not be negative");
+    burst = burstPar > 0 ? burstPar : rate;
+
+    std::string modeName = module->par("rateLimitMode").stdstringValue();
+    if (modeName == "tokenBucket")
+        mode = TOKEN_BUCKET;
+    else if (modeName == "slidingWindow")
+        mode = SLIDING_WINDOW;
+    else if (modeName == "fixedWindow")
+        mode = FIXED_WINDOW;
+    else
+        throw cRuntimeError("Unknown rateLimitMode '%s' (expected tokenBucket, slidingWindow or fixedWindow)", modeName.c_str());
+
+    keyBySource = keyByCommType = false;
+    for (const std::string& key : cStringTokenizer(module->par("rateLimitKey")).asVector()) {
+        if (key == "source")
+            keyBySource = true;
+        else if (key == "commType")
+            keyByCommType = true;
+        else
+            throw cRuntimeError("Unknown rateLimitKey '%s' (expected source and/or commType)", key.c_str());
+    }
+}
+
+bool RateLimiter::accept(const inet::Packet* packet)
+{
+    if (rate <= 0) return true;
+
+    int commType = keyByCommType ? getCommTypeCode(packet) : -1;  // otherwise only needed for a drop
+    Bucket* selected = &bucket;
+    if (keyBySource || keyByCommType) {
+        uint64_t key = keyByCommType ? commType : 0;
+        if (keyBySource) {
+            uint64_t source = 0;
+            if (auto addressInd = packet->findTag<inet::L3AddressInd>()) {
+                const inet::L3Address& address = addressInd->getSrcAddress();
+                source = address.getType() == inet::L3Address::IPv4 ? address.toIpv4().getInt() : std::hash<std::string>()(address.str());
+            }
+            key |= source << 8;
+        }
+        selected = &buckets[key];
+    }
+
+    if (admit(*selected, simTime().dbl())) return true;
+    dropped++;
+    droppedByCommType[commType >= 0 ? commType : getCommTypeCode(packet)]++;
+    module->emit(droppedSignal, dropped);
+    return false;
+}
+
+bool RateLimiter::admit(Bucket& b, double now)
+{
+    if (mode == TOKEN_BUCKET) {
+        b.tokens = b.tokens < 0 ? burst : std::min(burst, b.tokens + (now - b.last) * rate);
+        b.last = now;
+        if (b.tokens < 1) return false;
+        b.tokens -= 1;
+        return true;
+    }
+
+    // Windows are whole simulated seconds
+    double second = std::floor(now);
+    if (second != b.last) {
+        b.previous = second == b.last + 1 ? b.current : 0;
+        b.current = 0;
+        b.last = second;
+    }
+    double count = b.current;
+    if (mode == SLIDING_WINDOW) count += b.previous * (1 - (now - second));
+    if (count >= rate) return false;
+    b.current++;
+    return true;
+}
+
+void RateLimiter::recordScalars()
+{
+    for (int i = 0; i < 8; i++) {
+        if (droppedByCommType[i] > 0) module->recordScalar((std::string("rateLimitDropped:") + COMM_TYPE_NAMES[i]).c_str(), droppedByCommType[i]);
+    }
+}
+
+int RateLimiter::getCommTypeCode(const inet::Packet* packet)
+{
+    auto payload = peekEvPayload(packet);
+    if (!payload) return 0;
+    switch (payload->getMessageType()) {
+        case EV_MSG_BSM: return 1;
+        case EV_MSG_ATTACK: return 2 + std::min(std::max((int) static_cast<const AttackPayload&>(*payload).getTarget(), 0), 2);
+        case EV_MSG_CHARGE_REQUEST: return 5;
+        case EV_MSG_CHARGE_RESPONSE: return 6;
+        case EV_MSG_CHARGE_DONE: return 7;
+        default: return 0;
+    }
+}
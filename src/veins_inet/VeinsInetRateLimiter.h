@@ -0,0 +1,78 @@
+// Per-module receive rate limiter: token bucket or sliding/fixed window, without timers
+
+#ifndef __VEINS_INET_RATELIMITER_H_
+#define __VEINS_INET_RATELIMITER_H_
+
+#include "veins_inet/veins_inet.h"
+#include "inet/common/packet/Packet.h"
+#include <cstdint>
+#include <unordered_map>
+
+namespace veins {
+
+/**
+ * Decides per received packet whether it passes, from the packet's arrival
+ * time alone: no self-messages, O(1) per packet. Configured from the
+ * module parameters maxPktPerSecond (0: everything passes), rateLimitMode,
+ * rateLimitBurst and rateLimitKey.
+ *
+ * Modes:
+ *  - "tokenBucket": refills maxPktPerSecond tokens per second up to
+ *    rateLimitBurst (default maxPktPerSecond); a packet takes one token.
+ *  - "slidingWindow": the count of the previous second, weighted by its
+ *    overlap with the last 1 s, plus the count of the current second must
+ *    stay below maxPktPerSecond; no double bursts at second boundaries.
+ *  - "fixedWindow": the first maxPktPerSecond packets of each simulated
+ *    second (the former per-second counter, without its reset timer).
+ *
+ * With rateLimitKey, each source address and/or communication type
+ * ("source", "commType" or "source commType") gets its own bucket.
+ * Every drop is emitted as the module's rateLimitDropped signal (value:
+ * drops so far).
+ */
+class VEINS_INET_API RateLimiter {
+protected:
+    enum Mode { TOKEN_BUCKET, SLIDING_WINDOW, FIXED_WINDOW };
+
+    struct Bucket {
+        double tokens = -1;  // tokenBucket; -1: not used yet (starts full)
+        double last = 0;  // tokenBucket: last refill; windows: start of the current second
+        long current = 0;  // windows: packets passed in the current second
+        long previous = 0;  // slidingWindow: packets passed in the second before
+    };
+
+    cComponent* module = nullptr;
+    simsignal_t droppedSignal = 0;
+    Mode mode = TOKEN_BUCKET;
+    double rate = 0;  // packets per second; 0: disabled
+    double burst = 0;
+    bool keyBySource = false;
+    bool keyByCommType = false;
+    Bucket bucket;  // without a key
+    std::unordered_map<uint64_t, Bucket> buckets;  // with a key
+    long dropped = 0;
+    long droppedByCommType[8] = {};  // by getCommTypeCode()
+
+public:
+    /** @brief read the rate limit parameters of module, which must declare the rateLimitDropped signal */
+    void configure(cComponent* module);
+
+    bool isEnabled() const { return rate > 0; }
+
+    /** @brief whether packet, received now, passes; a drop is counted and signalled */
+    bool accept(const inet::Packet* packet);
+
+    /** @brief number of packets dropped so far */
+    long getNumDropped() const { return dropped; }
+
+    /** @brief record the drops per communication type as scalars rateLimitDropped:<commType> */
+    void recordScalars();
+
+protected:
+    bool admit(Bucket& bucket, double now);
+    static int getCommTypeCode(const inet::Packet* packet);
+};
+
+} // namespace veins
+
+#endif
@@ -0,0 +1,96 @@
+// Per-node receive filter: own IPv4 addresses and joined multicast groups
+
+#include "veins_inet/VeinsInetReceiveFilter.h"
+#include "inet/common/Simsignals.h"
+#include "inet/networklayer/ipv4/Ipv4InterfaceData.h"
+#include <algorithm>
+
+using namespace veins;
+
+namespace {
+
+const uint32_t LOCAL_GROUP_BASE = 0xE0000000;  // 224.0.0.0
+const uint32_t LOCAL_GROUP_MASK = 0xFFFFFFE0;  // /27 -> 32 groups in groupMask
+
+} // namespace
+
+VeinsInetReceiveFilter::~VeinsInetReceiveFilter()
+{
+    release();
+}
+
+void VeinsInetReceiveFilter::resolve(cModule* host, inet::IInterfaceTable* ift)
+{
+    release();
+    this->host = host;
+    this->ift = ift;
+    host->subscribe(inet::interfaceCreatedSignal, this);
+    host->subscribe(inet::interfaceDeletedSignal, this);
+    host->subscribe(inet::interfaceIpv4ConfigChangedSignal, this);
+    rebuild();
+}
+
+void VeinsInetReceiveFilter::release()
+{
+    if (host == nullptr) return;
+    host->unsubscribe(inet::interfaceCreatedSignal, this);
+    host->unsubscribe(inet::interfaceDeletedSignal, this);
+    host->unsubscribe(inet::interfaceIpv4ConfigChangedSignal, this);
+    host = nullptr;
+    ift = nullptr;
+}
+
+void VeinsInetReceiveFilter::acceptGroup(const inet::L3Address& group)
+{
+    if (group.getType() != inet::L3Address::IPv4 || !group.isMulticast()) return;
+    uint32_t addr = group.toIpv4().getInt();
+    if ((addr & LOCAL_GROUP_MASK) == LOCAL_GROUP_BASE) {
+        groupMask |= 1u << (addr & ~LOCAL_GROUP_MASK);
+    }
+    else if (std::find(otherGroups.begin(), otherGroups.end(), addr) == otherGroups.end()) {
+        otherGroups.push_back(addr);
+    }
+}
+
+bool VeinsInetReceiveFilter::isFromSelf(const inet::L3Address& srcAddr) const
+{
+    // Multicast self-loopback arrives with an unspecified source
+    if (srcAddr.isUnspecified()) return true;
+    if (srcAddr.getType() != inet::L3Address::IPv4) return false;
+    uint32_t addr = srcAddr.toIpv4().getInt();
+    if (addr == inet::Ipv4Address::LOOPBACK_ADDRESS.getInt()) return true;
+    for (uint32_t own : ownAddresses) {
+        if (own == addr) return true;
+    }
+    return false;
+}
+
+bool VeinsInetReceiveFilter::isJoinedGroup(const inet::L3Address& destAddr) const
+{
+    if (destAddr.getType() != inet::L3Address::IPv4 || !destAddr.isMulticast()) return false;
+    uint32_t addr = destAddr.toIpv4().getInt();
+    if ((addr & LOCAL_GROUP_MASK) == LOCAL_GROUP_BASE) {
+        return (groupMask >> (addr & ~LOCAL_GROUP_MASK)) & 1u;
+    }
+    return std::find(otherGroups.begin(), otherGroups.end(), addr) != otherGroups.end();
+}
+
+void VeinsInetReceiveFilter::rebuild()
+{
+    ownAddresses.clear();
+    if (ift == nullptr) return;
+    for (int i = 0; i < ift->getNumInterfaces(); i++) {
+        auto iface = ift->getInterface(i);
+        if (iface == nullptr) continue;
+        auto ipv4Data = iface->getProtocolData<inet::Ipv4InterfaceData>();
+        if (ipv4Data == nullptr) continue;
+        auto ownAddr = ipv4Data->getIPAddress();
+        if (!ownAddr.isUnspecified()) ownAddresses.push_back(ownAddr.getInt());
+    }
+}
+
+void VeinsInetReceiveFilter::receiveSignal(cComponent* source, simsignal_t signalID, cObject* obj, cObject* details)
+{
+    // Interface signals are rare (address assignment, interface up/down); a full rebuild is cheap
+    rebuild();
+}
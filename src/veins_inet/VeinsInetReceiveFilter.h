@@ -0,0 +1,63 @@
+// Per-node receive filter: own IPv4 addresses and joined multicast groups
+
+#ifndef __VEINS_INET_RECEIVEFILTER_H_
+#define __VEINS_INET_RECEIVEFILTER_H_
+
+#include "veins_inet/veins_inet.h"
+#include "inet/networklayer/common/L3Address.h"
+#include "inet/networklayer/contract/IInterfaceTable.h"
+#include <cstdint>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Answers "is this packet an echo of my own transmission?" and "did I join
+ * this group?" without touching the interface table on the receive path.
+ *
+ * The own-address set is built once in resolve() (called from the app's
+ * handleStartOperation) and rebuilt only when the host's interface table
+ * emits a create/delete/IPv4-config-change notification. Groups in
+ * 224.0.0.0/27, which covers all EV/CS/RSU groups, are kept as a bitmask.
+ */
+class VEINS_INET_API VeinsInetReceiveFilter : public cListener {
+protected:
+    cModule* host = nullptr;
+    inet::IInterfaceTable* ift = nullptr;
+
+    std::vector<uint32_t> ownAddresses;  // IPv4 addresses of all local interfaces
+    uint32_t groupMask = 0;              // bit n set: joined 224.0.0.n
+    std::vector<uint32_t> otherGroups;   // joined groups outside 224.0.0.0/27
+
+public:
+    virtual ~VeinsInetReceiveFilter();
+
+    /** @brief snapshot the interface table and subscribe to its change notifications */
+    void resolve(cModule* host, inet::IInterfaceTable* ift);
+
+    /** @brief unsubscribe; the filter keeps its last state */
+    void release();
+
+    /** @brief accept multicast traffic for group (call next to socket.joinMulticastGroup) */
+    void acceptGroup(const inet::L3Address& group);
+
+    /** @brief loopback, unspecified or one of our own interface addresses */
+    bool isFromSelf(const inet::L3Address& srcAddr) const;
+
+    /** @brief destAddr is a multicast group accepted by acceptGroup() */
+    bool isJoinedGroup(const inet::L3Address& destAddr) const;
+
+    /** @brief unicast, or a multicast group accepted by acceptGroup() */
+    bool acceptsDestination(const inet::L3Address& destAddr) const
+    {
+        return !destAddr.isMulticast() || isJoinedGroup(destAddr);
+    }
+
+protected:
+    void rebuild();
+    virtual void receiveSignal(cComponent* source, simsignal_t signalID, cObject* obj, cObject* details) override;
+};
+
+} // namespace veins
+
+#endif
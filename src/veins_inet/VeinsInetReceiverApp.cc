@@ -5,30 +5,21 @@
 #include "inet/common/packet/Packet.h"
 #include "inet/networklayer/common/L3AddressTag_m.h"
 #include "inet/networklayer/common/L3AddressResolver.h"
+#include "inet/networklayer/contract/IInterfaceTable.h"
 #include "inet/transportlayer/common/L4PortTag_m.h"
-#include "inet/applications/base/ApplicationPacket_m.h"
 #include <sstream>
 #include <iomanip>
-#include <sys/stat.h>
-#ifdef _WIN32
-#include <direct.h>
-#define MKDIR(d) _mkdir(d)
-#else
-#define MKDIR(d) mkdir(d, 0755)
-#endif
 
 using namespace veins;
 
 Define_Module(VeinsInetReceiverApp);
 
 VeinsInetReceiverApp::VeinsInetReceiverApp()
-    : maxPktPerSecond(0), pktsReceivedThisSec(0), rsuSecTimer(nullptr)
 {
 }
 
 VeinsInetReceiverApp::~VeinsInetReceiverApp()
 {
-    cancelAndDelete(rsuSecTimer);
     closeCSVLogging();
 }
 
@@ -41,9 +32,9 @@ void VeinsInetReceiverApp::initialize(int stage)
         lastPacketTime = 0;
         totalEnergyConsumed = 0.0;
 
-        maxPktPerSecond = par("maxPktPerSecond");
-        pktsReceivedThisSec = 0;
-        rsuSecTimer = new cMessage("rsuSecTimer");
+        rateLimiter.configure(this);
+        heavyHitters.configure(this);
+        dosDetector.configure(this);
 
         packetReceivedSignal = registerSignal("packetReceived");
         packetSizeSignal = registerSignal("packetSize");
@@ -51,6 +42,9 @@ void VeinsInetReceiverApp::initialize(int stage)
         energyConsumptionSignal = registerSignal("energyConsumption");
         txDurationSignal = registerSignal("txDuration");
         
+        mobility = dynamic_cast<inet::IMobility*>(getParentModule()->getSubmodule("mobility"));
+
+        traceFilter.configure(this);
         initializeCSVLogging();
     }
 }
@@ -60,6 +54,8 @@ void VeinsInetReceiverApp::handleStartOperation(inet::LifecycleOperation* operat
     socket.setOutputGate(gate("socketOut"));
     socket.setCallback(this);
     socket.bind(9001);
+    receiveFilter.resolve(inet::getContainingNode(this),
+        inet::getModuleFromPar<inet::IInterfaceTable>(par("interfaceTableModule"), this));
     
     // Join appropriate multicast group based on node type
     inet::L3Address mcastAddr;
@@ -77,39 +73,33 @@ void VeinsInetReceiverApp::handleStartOperation(inet::LifecycleOperation* operat
     }
     
     socket.joinMulticastGroup(mcastAddr);
+    receiveFilter.acceptGroup(mcastAddr);
     joinedMulticastGroup = mcastAddr;
     
     // Also join BSM multicast group (224.0.0.1) to receive normal V2X traffic
     // This is needed for binary classification (attack vs normal)
     inet::L3AddressResolver().tryResolve("224.0.0.1", bsmMulticastGroup);
     socket.joinMulticastGroup(bsmMulticastGroup);
-
-    // Start rate-limit counter reset (1 second interval)
-    scheduleAt(simTime() + 1.0, rsuSecTimer);
+    receiveFilter.acceptGroup(bsmMulticastGroup);
 }
 
 void VeinsInetReceiverApp::handleStopOperation(inet::LifecycleOperation* operation)
 {
-    cancelEvent(rsuSecTimer);
+    receiveFilter.release();
     socket.close();
     closeCSVLogging();
 }
 
 void VeinsInetReceiverApp::handleCrashOperation(inet::LifecycleOperation* operation)
 {
-    cancelEvent(rsuSecTimer);
+    receiveFilter.release();
     socket.destroy();
     closeCSVLogging();
 }
 
 void VeinsInetReceiverApp::handleMessageWhenUp(cMessage* msg)
 {
-    if (msg == rsuSecTimer) {
-        // Reset per-second receive counter for rate limiting
-        pktsReceivedThisSec = 0;
-        scheduleAt(simTime() + 1.0, rsuSecTimer);
-    }
-    else if (socket.belongsToSocket(msg)) {
+    if (socket.belongsToSocket(msg)) {
         socket.processMessage(msg);
     }
     else {
@@ -119,19 +109,27 @@ void VeinsInetReceiverApp::handleMessageWhenUp(cMessage* msg)
 
 void VeinsInetReceiverApp::socketDataArrived(inet::UdpSocket* socket, inet::Packet* packet)
 {
-    // Rate limiting: drop packet if over per-second cap
-    if (maxPktPerSecond > 0 && pktsReceivedThisSec >= maxPktPerSecond) {
+    dosDetector.observe(packet);
+
+    // Per-source flood detection: drop packet if its sender is above heavyHitterDropRate
+    if (!heavyHitters.accept(packet)) {
+        EV_INFO << getParentModule()->getFullName()
+                << " RSU HEAVY HITTER: dropping packet (" << heavyHitters.getNumDropped() << " dropped)" << endl;
+        delete packet;
+        return;
+    }
+
+    // Rate limiting: drop packet if over the receive rate
+    if (!rateLimiter.accept(packet)) {
         EV_INFO << getParentModule()->getFullName()
-                << " RSU RATE LIMIT: dropping packet (" << pktsReceivedThisSec
-                << " >= " << maxPktPerSecond << " pkts/s)" << endl;
+                << " RSU RATE LIMIT: dropping packet (" << rateLimiter.getNumDropped() << " dropped)" << endl;
         delete packet;
         return;
     }
-    pktsReceivedThisSec++;
 
     // Accept packets from both the specific multicast group AND BSM group
-    auto destAddr = packet->getTag<inet::L3AddressInd>()->getDestAddress();
-    if (destAddr != joinedMulticastGroup && destAddr != bsmMulticastGroup) {
+    auto addressInd = packet->getTag<inet::L3AddressInd>();
+    if (!receiveFilter.isJoinedGroup(addressInd->getDestAddress())) {
         delete packet;
         return;
     }
@@ -142,22 +140,17 @@ void VeinsInetReceiverApp::socketDataArrived(inet::UdpSocket* socket, inet::Pack
     
     packetsReceived++;
     
-    auto srcAddr = packet->getTag<inet::L3AddressInd>()->getSrcAddress();
-    
-    // Determine communication type from packet name
-    std::string pktName = packet->getName();
-    std::string commType = "UNKNOWN";
-    if (pktName.find("EV2EV") != std::string::npos) commType = "EV2EV";
-    else if (pktName.find("EV2CS") != std::string::npos) commType = "EV2CS";
-    else if (pktName.find("EV2RSU") != std::string::npos) commType = "EV2RSU";
-    else if (pktName.find("BSM") != std::string::npos) commType = "BSM";
+    auto srcAddr = addressInd->getSrcAddress();
     
-    // Extract sequence number from packet payload
-    int seqNum = packetsReceived;
-    try {
-        const auto& payload = packet->peekAtFront<inet::ApplicationPacket>();
-        seqNum = payload->getSequenceNumber();
-    } catch (...) {}
+    // Dispatch on the typed application header
+    const char* pktName = packet->getName();
+    auto payload = peekEvPayload(packet);
+    int seqNum = payload ? (int)payload->getSequenceNumber() : packetsReceived;
+    const char* commType = "UNKNOWN";
+    if (payload && (payload->getMessageType() == EV_MSG_ATTACK
+                    || payload->getMessageType() == EV_MSG_BSM)) {
+        commType = getCommunicationType(*payload);
+    }
     
     // Calculate receive energy
     double recvEnergy = calculateReceiveEnergy(pktSize);
@@ -172,9 +165,9 @@ void VeinsInetReceiverApp::socketDataArrived(inet::UdpSocket* socket, inet::Pack
     emit(energyConsumptionSignal, recvEnergy);
     emit(txDurationSignal, txDur);
     
-    logPacketToCSV(commType.c_str(), pktSize, iat.dbl(), recvEnergy,
+    logPacketToCSV(getTraceEventClass(payload.get()), commType, pktSize, iat.dbl(), recvEnergy,
                   srcAddr.str().c_str(), getParentModule()->getFullName(),
-                  seqNum, pktName.c_str());
+                  seqNum, pktName);
     
     delete packet;
 }
@@ -190,38 +183,26 @@ void VeinsInetReceiverApp::socketClosed(inet::UdpSocket* socket)
 
 void VeinsInetReceiverApp::initializeCSVLogging()
 {
-    // Ensure results directory exists (static modules init before OMNeT++ creates it)
-    struct stat st;
-    if (stat("results", &st) != 0) {
-        MKDIR("results");
+    // One shared trace for the whole network if the scenario has a traceCollector
+    if (VeinsInetTraceCollector* collector = VeinsInetTraceCollectorAccess().get()) {
+        traceChannel = collector->acquire(getParentModule()->getName());
+        traceShared = true;
+        return;
     }
 
     std::ostringstream filename;
     
     const char* configName = getEnvir()->getConfigEx()->getActiveConfigName();
+    TraceFormat format = TraceSink::parseFormat(par("traceFormat"));
+    TraceCompression compression = TraceSink::parseCompression(par("traceCompression"));
     
-    filename << "results/" << configName << "_" 
+    filename << configName << "_" 
              << getParentModule()->getName() 
              << getParentModule()->getIndex() 
-             << ".csv";
-    
-    csvFilePath = filename.str();
-    csvFile.open(csvFilePath.c_str());
-
-    if (!csvFile.is_open()) {
-        EV_ERROR << "RSU: Failed to open CSV file: " << csvFilePath << endl;
-    }
+             << TraceSink::getFileExtension(format, compression);
     
-    if (csvFile.is_open()) {
-        csvFile << "timestamp,event_type,node_id,node_type,communication_type,"
-                << "packet_size,inter_arrival_time,battery_level,"
-                << "energy_consumption,source_address,target_address,"
-                << "is_attacker,is_charging,"
-                << "sequence_number,packet_name,"
-                << "pos_x,pos_y,speed,"
-                << "tx_duration_est,"
-                << "cumulative_packets_sent,cumulative_packets_received\n";
-    }
+    csvFilePath = TraceSink::getResultPath(filename.str());
+    traceChannel = TraceSink::getInstance().openChannel(csvFilePath, TRACE_SCHEMA_BASE, format, compression, par("traceCompressionLevel"));
 }
 
 double VeinsInetReceiverApp::calculateReceiveEnergy(int pktSize)
@@ -240,78 +221,82 @@ double VeinsInetReceiverApp::calculateReceiveEnergy(int pktSize)
     return energy;
 }
 
-void VeinsInetReceiverApp::logPacketToCSV(const char* commType, int pktSize,
+void VeinsInetReceiverApp::logPacketToCSV(TraceEventClass eventClass, const char* commType, int pktSize,
                                           double iat, double energy,
                                           const char* srcAddress,
                                           const char* targetAddress,
                                           int seqNum,
                                           const char* pktName)
 {
-    if (!csvFile.is_open()) {
-        return;
-    }
+    // Filter first: rejected rows cost no formatting
+    if (!traceChannel || !traceFilter.accept(eventClass)) return;
     
-    // Get position and speed of this node
+    // Get position of this node
     inet::Coord myPos = getMyPosition();
-    double mySpeed = getMySpeed();
-    double txDur = (pktSize * 8.0) / 6e6;
-    
-    csvFile << std::fixed << std::setprecision(6)
-            << simTime().dbl() << ","
-            << "RECEIVED" << ","
-            << getParentModule()->getIndex() << ","
-            << getParentModule()->getName() << ","
-            << commType << ","
-            << pktSize << ","
-            << iat << ","
-            << "0" << ","
-            << energy << ","
-            << srcAddress << ","
-            << targetAddress << ","
-            << "0" << ","
-            << "0" << ","
-            << seqNum << ","
-            << pktName << ","
-            << myPos.x << ","
-            << myPos.y << ","
-            << mySpeed << ","
-            << txDur << ","
-            << "0" << ","
-            << packetsReceived << "\n";
     
-    csvFile.flush();
+    TraceRecord& r = TraceSink::getInstance().beginRecord(traceChannel);
+    r.flags = TRACE_NO_BATTERY;
+    r.timestamp = simTime().dbl();
+    TraceRecord::copy(r.eventType, "RECEIVED");
+    r.nodeId = getParentModule()->getIndex();
+    TraceRecord::copy(r.nodeType, getParentModule()->getName());
+    TraceRecord::copy(r.commType, commType);
+    r.packetSize = pktSize;
+    r.interArrivalTime = iat;
+    r.energy = energy;
+    TraceRecord::copy(r.srcAddress, srcAddress);
+    TraceRecord::copy(r.tgtAddress, targetAddress);
+    r.isAttacker = false;
+    r.isCharging = 0;
+    r.sequenceNumber = seqNum;
+    TraceRecord::copy(r.packetName, pktName);
+    r.posX = myPos.x;
+    r.posY = myPos.y;
+    r.speed = getMySpeed();
+    r.txDuration = (pktSize * 8.0) / 6e6;
+    r.packetsSent = 0;
+    r.packetsReceived = packetsReceived;
+    TraceSink::getInstance().commitRecord();
 }
 
 void VeinsInetReceiverApp::closeCSVLogging()
 {
-    if (csvFile.is_open()) {
-        csvFile.close();
+    if (traceChannel) {
+        if (!traceShared) {
+            TraceSink::getInstance().closeChannel(traceChannel);
+        }
+        else if (VeinsInetTraceCollector* collector = VeinsInetTraceCollectorAccess().get()) {
+            collector->release(traceChannel);
+        }
+        traceChannel = nullptr;
     }
 }
 
 inet::Coord VeinsInetReceiverApp::getMyPosition()
 {
-    auto mob = dynamic_cast<inet::IMobility*>(getParentModule()->getSubmodule("mobility"));
-    if (mob) return mob->getCurrentPosition();
+    if (mobility) return mobility->getCurrentPosition();
     return inet::Coord::ZERO;
 }
 
 double VeinsInetReceiverApp::getMySpeed()
 {
-    auto mob = dynamic_cast<inet::IMobility*>(getParentModule()->getSubmodule("mobility"));
-    if (mob) return mob->getCurrentVelocity().length();
+    if (mobility) return mobility->getCurrentVelocity().length();
     return 0.0;
 }
 
 void VeinsInetReceiverApp::finish()
 {
-    ApplicationBase::finish();
+    VeinsInetEventCountingApp::finish();
     
     recordScalar("packetsReceived", packetsReceived);
     recordScalar("packetsSent", 0);  // Receiver-only node, never sends
     recordScalar("totalEnergyConsumed", totalEnergyConsumed);
+    rateLimiter.recordScalars();
+    heavyHitters.recordScalars();
+    dosDetector.recordScalars();
     recordScalar("avgPacketRate", simTime() > 0 ? packetsReceived / simTime().dbl() : 0);
     recordScalar("finalBatteryLevel", 0);  // Infrastructure node, no battery
+    recordScalar("traceRowsFiltered", traceFilter.getNumRejected());
     
     closeCSVLogging();
 }
@@ -4,15 +4,22 @@
 #define VEINS_INET_RECEIVER_APP_H
 
 #include "veins_inet/veins_inet.h"
-#include "inet/applications/base/ApplicationBase.h"
+#include "veins_inet/ChargingProtocol_m.h"
+#include "veins_inet/VeinsInetDosDetector.h"
+#include "veins_inet/VeinsInetEventCountingApp.h"
+#include "veins_inet/VeinsInetHeavyHitterTracker.h"
+#include "veins_inet/VeinsInetRateLimiter.h"
+#include "veins_inet/VeinsInetReceiveFilter.h"
+#include "veins_inet/VeinsInetTraceCollector.h"
+#include "veins_inet/VeinsInetTraceFilter.h"
+#include "veins_inet/VeinsInetTraceSink.h"
 #include "inet/transportlayer/contract/udp/UdpSocket.h"
 #include "inet/mobility/contract/IMobility.h"
 #include "inet/common/geometry/common/Coord.h"
-#include <fstream>
 
 namespace veins {
 
-class VEINS_INET_API VeinsInetReceiverApp : public inet::ApplicationBase, public inet::UdpSocket::ICallback
+class VEINS_INET_API VeinsInetReceiverApp : public VeinsInetEventCountingApp, public inet::UdpSocket::ICallback
 {
   protected:
     inet::UdpSocket socket;
@@ -27,16 +34,20 @@ class VEINS_INET_API VeinsInetReceiverApp : public inet::ApplicationBase, public
     simsignal_t energyConsumptionSignal;
     simsignal_t txDurationSignal;
     
-    std::ofstream csvFile;
+    TraceChannel* traceChannel = nullptr;
+    bool traceShared = false;   // traceChannel belongs to the network's traceCollector
+    TraceFilter traceFilter;
     std::string csvFilePath;
+    inet::IMobility* mobility = nullptr;  // own node, resolved once
     
     inet::L3Address joinedMulticastGroup;
     inet::L3Address bsmMulticastGroup;  // BSM group 224.0.0.1 for normal traffic
+    VeinsInetReceiveFilter receiveFilter;
 
     // Rate limiting
-    int maxPktPerSecond;        // max recv pkts/s (0=unlimited)
-    int pktsReceivedThisSec;    // rolling counter, reset each second
-    cMessage* rsuSecTimer;      // 1-second reset timer
+    RateLimiter rateLimiter;
+    HeavyHitterTracker heavyHitters;  // per-source rates; may drop floods before the rate limiter
+    DosDetector dosDetector;  // sees all traffic, before any drop
     
   protected:
     virtual void initialize(int stage) override;
@@ -54,7 +65,7 @@ class VEINS_INET_API VeinsInetReceiverApp : public inet::ApplicationBase, public
     
     void initializeCSVLogging();
     double calculateReceiveEnergy(int pktSize);
-    void logPacketToCSV(const char* commType, int pktSize, double iat,
+    void logPacketToCSV(TraceEventClass eventClass, const char* commType, int pktSize, double iat,
                         double energy, const char* srcAddress, 
                         const char* targetAddress,
                         int seqNum, const char* pktName);
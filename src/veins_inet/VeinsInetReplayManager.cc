@@ -0,0 +1,117 @@
+// Replays a recorded mobility trace in place of SUMO and the TraCI manager
+
+#include "veins_inet/VeinsInetReplayManager.h"
+#include <algorithm>
+#include <stdexcept>
+
+using namespace veins;
+
+Define_Module(VeinsInetReplayManager);
+
+VeinsInetReplayManager::~VeinsInetReplayManager()
+{
+    cancelAndDelete(stepMsg);
+}
+
+void VeinsInetReplayManager::initialize()
+{
+    std::string traceFile = par("traceFile").stdstringValue();
+    if (traceFile.empty()) throw cRuntimeError("VeinsInetReplayManager: parameter traceFile is not set");
+    try {
+        reader.open(traceFile);
+    }
+    catch (const std::runtime_error& e) {
+        throw cRuntimeError("%s", e.what());
+    }
+    if (reader.getSimtimeScaleExp() != SimTime::getScaleExp()) {
+        throw cRuntimeError("Mobility trace %s was recorded with simtime-resolution 10^%d s, this run uses 10^%d s", traceFile.c_str(), reader.getSimtimeScaleExp(), SimTime::getScaleExp());
+    }
+
+    spawner.configure(this);
+    stepMsg = new cMessage("replayStep");
+    readNext();
+    scheduleNextStep();
+}
+
+void VeinsInetReplayManager::handleMessage(cMessage* msg)
+{
+    if (msg != stepMsg) throw cRuntimeError("This module only handles its own step timer");
+
+    // All records of the current step, in recorded order
+    int64_t time = pending.time;
+    do {
+        switch (pending.kind) {
+        case MobilityTraceReader::RECORD_CREATE:
+            addModule(pending);
+            break;
+        case MobilityTraceReader::RECORD_UPDATE:
+            spawner.updatePosition(getManagedModule(pending.nodeId), inet::Coord(pending.x, pending.y), reader.getString(pending.roadId), pending.speed, pending.heading);
+            numUpdates++;
+            break;
+        case MobilityTraceReader::RECORD_DELETE:
+            deleteManagedModule(pending.nodeId);
+            break;
+        }
+        readNext();
+    } while (hasPending && pending.time == time);
+    scheduleNextStep();
+}
+
+void VeinsInetReplayManager::finish()
+{
+    // Like the TraCI manager: remaining vehicles are finished and deleted in order of their TraCI ids
+    std::vector<std::pair<std::string, uint32_t>> remaining;
+    for (auto& host : hosts) remaining.emplace_back(reader.getString(host.first), host.first);
+    std::sort(remaining.begin(), remaining.end());
+    for (auto& host : remaining) deleteManagedModule(host.second);
+
+    recordScalar("replayedVehicles", numCreated);
+    recordScalar("replayedUpdates", numUpdates);
+    recordScalar("replayTraceComplete", reader.isComplete());
+}
+
+void VeinsInetReplayManager::readNext()
+{
+    try {
+        hasPending = reader.next(pending);
+    }
+    catch (const std::runtime_error& e) {
+        throw cRuntimeError("%s", e.what());
+    }
+}
+
+void VeinsInetReplayManager::scheduleNextStep()
+{
+    if (!hasPending) {
+        EV_INFO << "ReplayManager: end of mobility trace" << (reader.isComplete() ? "" : " (trace was cut short)") << endl;
+        return;
+    }
+    simtime_t next = SimTime::fromRaw(pending.time);
+    if (next < simTime()) throw cRuntimeError("Mobility trace goes back in time to t=%s", next.str().c_str());
+    scheduleAt(next, stepMsg);
+}
+
+void VeinsInetReplayManager::addModule(const MobilityTraceReader::Record& record)
+{
+    const std::string& nodeId = reader.getString(record.nodeId);
+    if (hosts.find(record.nodeId) != hosts.end()) throw cRuntimeError("Mobility trace creates vehicle \"%s\" twice", nodeId.c_str());
+
+    cModule* mod = spawner.createHost(reader.getString(record.moduleType).c_str(), reader.getString(record.moduleName).c_str(), record.moduleIndex, reader.getString(record.displayString));
+    spawner.initializeHost(mod, nodeId, inet::Coord(record.x, record.y), reader.getString(record.roadId), record.speed, record.heading);
+    hosts[record.nodeId] = mod;
+    numCreated++;
+}
+
+void VeinsInetReplayManager::deleteManagedModule(uint32_t nodeId)
+{
+    cModule* mod = getManagedModule(nodeId);
+    hosts.erase(nodeId);
+    spawner.deleteHost(mod);
+}
+
+cModule* VeinsInetReplayManager::getManagedModule(uint32_t nodeId)
+{
+    auto it = hosts.find(nodeId);
+    if (it == hosts.end()) throw cRuntimeError("Mobility trace refers to vehicle \"%s\", which does not exist", reader.getString(nodeId).c_str());
+    return it->second;
+}
@@ -0,0 +1,54 @@
+// Replays a recorded mobility trace in place of SUMO and the TraCI manager
+
+#ifndef __VEINS_INET_REPLAYMANAGER_H_
+#define __VEINS_INET_REPLAYMANAGER_H_
+
+#include "veins_inet/veins_inet.h"
+#include "veins_inet/VeinsInetHostSpawner.h"
+#include "veins_inet/VeinsInetMobilityTrace.h"
+#include <unordered_map>
+
+namespace veins {
+
+/**
+ * Creates, moves and deletes the vehicle modules of a run recorded by a
+ * VeinsInetManager (parameter mobilityRecordFile), without SUMO.
+ *
+ * Every step of the trace becomes one event at the recorded simulation
+ * time. Vehicles get the recorded module type, name, index and display
+ * string, and their VeinsInetMobility modules and the node registry see
+ * the same preInitializeModule() / updateModulePosition() calls as in the
+ * recorded run. The replay is open-loop: vehicle commands (reroute, speed,
+ * color) have nothing to act on and are dropped.
+ */
+class VEINS_INET_API VeinsInetReplayManager : public cSimpleModule {
+public:
+    virtual ~VeinsInetReplayManager();
+
+    /** @brief number of vehicles currently in the simulation */
+    size_t getManagedHostsCount() const { return hosts.size(); }
+
+protected:
+    MobilityTraceReader reader;
+    MobilityTraceReader::Record pending;  // first record of the next step
+    bool hasPending = false;
+    cMessage* stepMsg = nullptr;
+    std::unordered_map<uint32_t, cModule*> hosts;  // by string id of the TraCI id
+    VeinsInetHostSpawner spawner;
+    long numCreated = 0;
+    long numUpdates = 0;
+
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage* msg) override;
+    virtual void finish() override;
+
+    void readNext();
+    void scheduleNextStep();
+    void addModule(const MobilityTraceReader::Record& record);
+    void deleteManagedModule(uint32_t nodeId);
+    cModule* getManagedModule(uint32_t nodeId);
+};
+
+} // namespace veins
+
+#endif
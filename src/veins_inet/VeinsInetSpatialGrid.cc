@@ -0,0 +1,161 @@
+// Uniform grid spatial index of node positions
+
+#include "veins_inet/VeinsInetSpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace veins;
+
+SpatialGrid::SpatialGrid(double cellSize)
+    : cellSize(cellSize)
+{
+    if (!(cellSize > 0)) throw cRuntimeError("SpatialGrid: cell size must be positive, got %g", cellSize);
+}
+
+int64_t SpatialGrid::cellCoord(double v) const
+{
+    // Clamp so that far-off or non-finite positions still map to a valid cell
+    double c = std::floor(v / cellSize);
+    if (!(c > -1e9)) return -1000000000;
+    if (c > 1e9) return 1000000000;
+    return (int64_t) c;
+}
+
+void SpatialGrid::update(int id, double x, double y)
+{
+    int64_t cx = cellCoord(x), cy = cellCoord(y);
+    uint64_t cell = cellKey(cx, cy);
+
+    auto it = slots.find(id);
+    if (it != slots.end()) {
+        Slot& slot = it->second;
+        if (slot.cell == cell) {
+            Entry& entry = cells[cell][slot.index];
+            entry.x = x;
+            entry.y = y;
+            return;
+        }
+        remove(id);
+    }
+
+    std::vector<Entry>& entries = cells[cell];
+    slots[id] = Slot{cell, entries.size()};
+    entries.push_back(Entry{id, x, y});
+    minCellX = std::min(minCellX, cx);
+    maxCellX = std::max(maxCellX, cx);
+    minCellY = std::min(minCellY, cy);
+    maxCellY = std::max(maxCellY, cy);
+}
+
+void SpatialGrid::remove(int id)
+{
+    auto it = slots.find(id);
+    if (it == slots.end()) return;
+    Slot slot = it->second;
+    slots.erase(it);
+
+    auto cellIt = cells.find(slot.cell);
+    std::vector<Entry>& entries = cellIt->second;
+    if (slot.index != entries.size() - 1) {
+        entries[slot.index] = entries.back();
+        slots[entries[slot.index].id].index = slot.index;
+    }
+    entries.pop_back();
+    if (entries.empty()) cells.erase(cellIt);
+}
+
+void SpatialGrid::scanCell(int64_t cx, int64_t cy, double x, double y, double range2, std::vector<int>& ids) const
+{
+    auto it = cells.find(cellKey(cx, cy));
+    if (it == cells.end()) return;
+    for (const Entry& entry : it->second) {
+        double dx = entry.x - x, dy = entry.y - y;
+        if (dx * dx + dy * dy <= range2) ids.push_back(entry.id);
+    }
+}
+
+void SpatialGrid::queryRange(double x, double y, double range, std::vector<int>& ids) const
+{
+    if (slots.empty() || range < 0) return;
+    double range2 = range * range;
+
+    int64_t cx0 = std::max(cellCoord(x - range), minCellX), cx1 = std::min(cellCoord(x + range), maxCellX);
+    int64_t cy0 = std::max(cellCoord(y - range), minCellY), cy1 = std::min(cellCoord(y + range), maxCellY);
+    if (cx0 > cx1 || cy0 > cy1) return;
+
+    // A range covering more cells than are occupied is cheaper as a scan of the occupied ones
+    if ((double) (cx1 - cx0 + 1) * (cy1 - cy0 + 1) > cells.size()) {
+        for (auto& cell : cells) {
+            for (const Entry& entry : cell.second) {
+                double dx = entry.x - x, dy = entry.y - y;
+                if (dx * dx + dy * dy <= range2) ids.push_back(entry.id);
+            }
+        }
+        return;
+    }
+    for (int64_t cx = cx0; cx <= cx1; cx++) {
+        for (int64_t cy = cy0; cy <= cy1; cy++) scanCell(cx, cy, x, y, range2, ids);
+    }
+}
+
+void SpatialGrid::nearestInCell(int64_t cx, int64_t cy, double x, double y, int& bestId, double& best2) const
+{
+    auto it = cells.find(cellKey(cx, cy));
+    if (it == cells.end()) return;
+    for (const Entry& entry : it->second) {
+        double dx = entry.x - x, dy = entry.y - y;
+        double d2 = dx * dx + dy * dy;
+        if (d2 < best2 || (bestId < 0 && d2 <= best2)) {
+            bestId = entry.id;
+            best2 = d2;
+        }
+    }
+}
+
+int SpatialGrid::queryNearest(double x, double y, double maxRange, double* distance) const
+{
+    int bestId = -1;
+    double best2 = maxRange * maxRange;
+    if (slots.empty() || maxRange < 0) return -1;
+
+    // Search square rings of cells around the query cell, starting at the first one touching occupied cells
+    int64_t cx = cellCoord(x), cy = cellCoord(y);
+    int64_t first = std::max({(int64_t) 0, minCellX - cx, cx - maxCellX, minCellY - cy, cy - maxCellY});
+    int64_t last = std::max({cx - minCellX, maxCellX - cx, cy - minCellY, maxCellY - cy});
+    for (int64_t k = first; k <= last; k++) {
+        // Every point of ring k is at least (k - 1) cells away
+        double ringDistance = (k - 1) * cellSize;
+        if (k > 0 && ringDistance * ringDistance > best2) break;
+
+        int64_t x0 = std::max(cx - k, minCellX), x1 = std::min(cx + k, maxCellX);
+        int64_t y0 = std::max(cy - k + 1, minCellY), y1 = std::min(cy + k - 1, maxCellY);
+        if (2.0 * (x1 - x0 + 1) + 2.0 * (y1 - y0 + 1) > cells.size()) {
+            // Sparse grid: checking all occupied cells is cheaper than the rest of the rings
+            for (auto& cell : cells) {
+                for (const Entry& entry : cell.second) {
+                    double dx = entry.x - x, dy = entry.y - y;
+                    double d2 = dx * dx + dy * dy;
+                    if (d2 < best2 || (bestId < 0 && d2 <= best2)) {
+                        bestId = entry.id;
+                        best2 = d2;
+                    }
+                }
+            }
+            break;
+        }
+        if (k == 0) {
+            nearestInCell(cx, cy, x, y, bestId, best2);
+            continue;
+        }
+        for (int64_t i = x0; i <= x1; i++) {
+            if (cy - k >= minCellY) nearestInCell(i, cy - k, x, y, bestId, best2);
+            if (cy + k <= maxCellY) nearestInCell(i, cy + k, x, y, bestId, best2);
+        }
+        for (int64_t j = y0; j <= y1; j++) {
+            if (cx - k >= minCellX) nearestInCell(cx - k, j, x, y, bestId, best2);
+            if (cx + k <= maxCellX) nearestInCell(cx + k, j, x, y, bestId, best2);
+        }
+    }
+    if (bestId >= 0 && distance) *distance = std::sqrt(best2);
+    return bestId;
+}
@@ -0,0 +1,67 @@
+// Uniform grid spatial index of node positions
+
+#ifndef __VEINS_INET_SPATIALGRID_H_
+#define __VEINS_INET_SPATIALGRID_H_
+
+#include "veins_inet/veins_inet.h"
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Points (by integer id) bucketed into square cells of a fixed size.
+ *
+ * Moving a point within its cell is a hash lookup; moving it to another
+ * cell is an O(1) swap-remove and append. Range and nearest queries only
+ * visit the cells around the query position, so their cost depends on the
+ * local node density, not on the total number of points. The cell size
+ * should be in the order of the typical query range.
+ */
+class VEINS_INET_API SpatialGrid {
+public:
+    explicit SpatialGrid(double cellSize = 1000);
+
+    /** @brief insert point id at (x, y), or move it there */
+    void update(int id, double x, double y);
+
+    /** @brief remove point id, if present */
+    void remove(int id);
+
+    bool contains(int id) const { return slots.count(id) != 0; }
+    size_t size() const { return slots.size(); }
+
+    /** @brief append the ids of all points within range of (x, y) to ids, in no particular order */
+    void queryRange(double x, double y, double range, std::vector<int>& ids) const;
+
+    /** @brief id of the point closest to (x, y) within maxRange, or -1; its distance goes to *distance */
+    int queryNearest(double x, double y, double maxRange, double* distance = nullptr) const;
+
+protected:
+    struct Entry {
+        int id;
+        double x;
+        double y;
+    };
+    struct Slot {
+        uint64_t cell;
+        size_t index;  // in cells[cell]
+    };
+
+    double cellSize;
+    std::unordered_map<uint64_t, std::vector<Entry>> cells;  // only non-empty cells
+    std::unordered_map<int, Slot> slots;
+    // Cell coordinates ever occupied (never shrinks); bounds the nearest search
+    int64_t minCellX = INT64_MAX, maxCellX = INT64_MIN;
+    int64_t minCellY = INT64_MAX, maxCellY = INT64_MIN;
+
+    int64_t cellCoord(double v) const;
+    static uint64_t cellKey(int64_t cx, int64_t cy) { return (uint64_t) (uint32_t) cx << 32 | (uint32_t) cy; }
+    void scanCell(int64_t cx, int64_t cy, double x, double y, double range2, std::vector<int>& ids) const;
+    void nearestInCell(int64_t cx, int64_t cy, double x, double y, int& bestId, double& best2) const;
+};
+
+} // namespace veins
+
+#endif
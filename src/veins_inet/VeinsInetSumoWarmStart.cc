@@ -0,0 +1,203 @@
+// SUMO state snapshot at firstStepAt, cached per scenario, for launchd-started runs
+
+#include "veins_inet/VeinsInetSumoWarmStart.h"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace veins;
+
+namespace {
+
+const uint64_t FNV_OFFSET = 0xcbf29ce484222325ull;
+const uint64_t FNV_PRIME = 0x100000001b3ull;
+
+bool isAbsolutePath(const std::string& path)
+{
+    return (!path.empty() && (path[0] == '/' || path[0] == '\\')) || (path.size() > 1 && path[1] == ':');
+}
+
+void makeDirectory(const std::string& path)
+{
+#ifdef _WIN32
+    _mkdir(path.c_str());
+#else
+    mkdir(path.c_str(), 0777);
+#endif
+}
+
+bool fileExists(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    fclose(file);
+    return true;
+}
+
+std::string xmlEscape(const std::string& s)
+{
+    std::string out;
+    for (char c : s) {
+        if (c == '&') out += "&amp;";
+        else if (c == '<') out += "&lt;";
+        else if (c == '"') out += "&quot;";
+        else out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+SumoWarmStart::~SumoWarmStart()
+{
+    restoreLaunchConfig();
+}
+
+void SumoWarmStart::prepare(cXMLElement* launchConfig, simtime_t firstStepAt, const std::string& cacheDir)
+{
+    cXMLElement* basedirNode = launchConfig->getFirstChildWithTag("basedir");
+    if (!basedirNode || !basedirNode->getAttribute("path")) throw cRuntimeError("SumoWarmStart: launch config has no <basedir path=...>");
+    std::string basedir = basedirNode->getAttribute("path");
+    if (!basedir.empty() && basedir.back() != '/') basedir += '/';
+    cXMLElement* seedNode = launchConfig->getFirstChildWithTag("seed");
+    const char* seed = seedNode ? seedNode->getAttribute("value") : nullptr;
+
+    // Everything SUMO's state at firstStepAt depends on, as far as the launch config tells
+    std::string key = firstStepAt.str() + "|" + (seed ? seed : "");
+    uint64_t hash = hashBytes(FNV_OFFSET, key.data(), key.size() + 1);
+    configNode = nullptr;
+    for (cXMLElement* copy : launchConfig->getChildrenByTagName("copy")) {
+        const char* file = copy->getAttribute("file");
+        if (!file) continue;
+        const char* type = copy->getAttribute("type");
+        if (type && strcmp(type, "config") == 0) configNode = copy;
+        hash = hashBytes(hash, file, strlen(file) + 1);
+        hash = hashFile(hash, basedir + file);
+    }
+    if (!configNode) throw cRuntimeError("SumoWarmStart: launch config has no <copy file=... type=\"config\">");
+
+    // SUMO runs in a temporary directory, so all paths it gets are absolute
+    std::string dir = isAbsolutePath(cacheDir) ? cacheDir : basedir + cacheDir;
+    makeDirectory(dir);
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long) hash);
+    statePath = dir + "/" + name + ".state.xml.gz";
+    std::string pid = std::to_string(getpid());
+
+    std::string options;
+    std::string begin;
+    loading = fileExists(statePath);
+    if (loading) {
+        options = "        <load-state value=\"" + xmlEscape(statePath) + "\"/>\n";
+        begin = firstStepAt.str();
+        EV_INFO << "SumoWarmStart: SUMO starts at t=" << firstStepAt << " from " << statePath << endl;
+    }
+    else {
+        savedStatePath = dir + "/" + name + "." + pid + ".partial.xml.gz";
+        options = "        <save-state.times value=\"" + firstStepAt.str() + "\"/>\n"
+                  "        <save-state.files value=\"" + xmlEscape(savedStatePath) + "\"/>\n"
+                  "        <save-state.rng value=\"true\"/>\n";
+        EV_INFO << "SumoWarmStart: no state in cache, SUMO saves it at t=" << firstStepAt << " to " << statePath << endl;
+    }
+
+    // The copy sits next to the original, so relative paths in it still resolve
+    std::string file = configNode->getAttribute("file");
+    size_t extension = file.rfind('.');
+    if (extension == std::string::npos || file.find('/', extension) != std::string::npos) extension = file.size();
+    std::string generatedFile = file.substr(0, extension) + ".warmstart-" + pid + file.substr(extension);
+    std::string config = writeOptions(readFile(basedir + file), options, begin);
+
+    generatedConfig = basedir + generatedFile;
+    FILE* out = fopen(generatedConfig.c_str(), "wb");
+    if (!out) throw cRuntimeError("SumoWarmStart: cannot write %s", generatedConfig.c_str());
+    bool written = fwrite(config.data(), 1, config.size(), out) == config.size();
+    if (fclose(out) != 0 || !written) throw cRuntimeError("SumoWarmStart: error writing %s", generatedConfig.c_str());
+    originalConfig = file;
+    configNode->setAttribute("file", generatedFile.c_str());
+}
+
+void SumoWarmStart::finish()
+{
+    if (!savedStatePath.empty()) {
+        if (fileExists(savedStatePath)) {
+            // Another run may have published the same state in the meantime; either copy is fine
+            if (std::rename(savedStatePath.c_str(), statePath.c_str()) != 0) std::remove(savedStatePath.c_str());
+            else EV_INFO << "SumoWarmStart: saved SUMO state to " << statePath << endl;
+        }
+        else {
+            EV_WARN << "SumoWarmStart: SUMO did not save its state (simulation ended before firstStepAt?)" << endl;
+        }
+        savedStatePath.clear();
+    }
+    restoreLaunchConfig();
+}
+
+void SumoWarmStart::restoreLaunchConfig()
+{
+    // The parsed launch config is cached across the runs of a process; the next run must see the original
+    if (configNode) {
+        configNode->setAttribute("file", originalConfig.c_str());
+        configNode = nullptr;
+    }
+    if (!generatedConfig.empty()) {
+        std::remove(generatedConfig.c_str());
+        generatedConfig.clear();
+    }
+}
+
+uint64_t SumoWarmStart::hashBytes(uint64_t hash, const void* data, size_t length)
+{
+    // FNV-1a
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < length; i++) hash = (hash ^ p[i]) * FNV_PRIME;
+    return hash;
+}
+
+uint64_t SumoWarmStart::hashFile(uint64_t hash, const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) throw cRuntimeError("SumoWarmStart: cannot read %s", path.c_str());
+    std::vector<char> buffer(1 << 16);
+    size_t n;
+    while ((n = fread(buffer.data(), 1, buffer.size(), file)) > 0) hash = hashBytes(hash, buffer.data(), n);
+    fclose(file);
+    return hash;
+}
+
+std::string SumoWarmStart::readFile(const std::string& path)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) throw cRuntimeError("SumoWarmStart: cannot read %s", path.c_str());
+    std::string contents;
+    char buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) contents.append(buffer, n);
+    fclose(file);
+    return contents;
+}
+
+std::string SumoWarmStart::writeOptions(std::string config, const std::string& options, const std::string& begin)
+{
+    // SUMO reads every element with a value attribute as an option, whatever section it is in;
+    // only begin may already be set and is changed in place
+    std::string added = options;
+    if (!begin.empty()) {
+        size_t tag = config.find("<begin ");
+        size_t value = tag == std::string::npos ? tag : config.find("value=\"", tag);
+        size_t end = value == std::string::npos ? value : config.find('"', value + 7);
+        if (end != std::string::npos) config.replace(value + 7, end - value - 7, begin);
+        else added = "        <begin value=\"" + begin + "\"/>\n" + added;
+    }
+    size_t close = config.rfind("</configuration>");
+    if (close == std::string::npos) throw cRuntimeError("SumoWarmStart: SUMO config has no </configuration>");
+    config.insert(close, "    <!-- added by VeinsInetManager (warmStart) -->\n    <warm_start>\n" + added + "    </warm_start>\n");
+    return config;
+}
@@ -0,0 +1,66 @@
+// SUMO state snapshot at firstStepAt, cached per scenario, for launchd-started runs
+
+#ifndef __VEINS_INET_SUMOWARMSTART_H_
+#define __VEINS_INET_SUMOWARMSTART_H_
+
+#include "veins_inet/veins_inet.h"
+#include <cstdint>
+#include <string>
+
+namespace veins {
+
+/**
+ * Lets SUMO skip the fast-forward to firstStepAt on all but the first run
+ * of a scenario.
+ *
+ * prepare() hashes everything that determines SUMO's state at firstStepAt
+ * (the contents of all files of the launch config, the seed and
+ * firstStepAt itself) and looks for "<hash>.state.xml.gz" in the cache
+ * directory. It then writes a copy of the launch config's SUMO config next
+ * to the original, with either load-state (cache hit) or save-state at
+ * firstStepAt (cache miss) added, and points the launch config at it.
+ *
+ * A saving run writes to a file private to the process and only moves it
+ * to its cache name in finish(), so concurrent runs never load a partially
+ * written state.
+ */
+class VEINS_INET_API SumoWarmStart {
+public:
+    SumoWarmStart() = default;
+    ~SumoWarmStart();
+    SumoWarmStart(const SumoWarmStart&) = delete;
+    SumoWarmStart& operator=(const SumoWarmStart&) = delete;
+
+    /**
+     * @brief rewrite launchConfig (after TraCIScenarioManagerLaunchd added basedir and seed) to load or save the state
+     *
+     * cacheDir is relative to the launch config's basedir unless absolute.
+     */
+    void prepare(cXMLElement* launchConfig, simtime_t firstStepAt, const std::string& cacheDir);
+
+    /** @brief publish a state saved by this run and delete the generated SUMO config; call once SUMO is done */
+    void finish();
+
+    bool isLoading() const { return loading; }
+    bool isSaving() const { return !savedStatePath.empty(); }
+    const std::string& getStatePath() const { return statePath; }
+
+protected:
+    bool loading = false;
+    std::string statePath;       // cache entry
+    std::string savedStatePath;  // where this run's SUMO saves the state (saving runs only)
+    std::string generatedConfig; // SUMO config written by prepare()
+    cXMLElement* configNode = nullptr;  // copy element changed by prepare()
+    std::string originalConfig;          // its file attribute before
+
+    void restoreLaunchConfig();
+
+    static uint64_t hashBytes(uint64_t hash, const void* data, size_t length);
+    static uint64_t hashFile(uint64_t hash, const std::string& path);
+    static std::string readFile(const std::string& path);
+    static std::string writeOptions(std::string config, const std::string& options, const std::string& begin);
+};
+
+} // namespace veins
+
+#endif
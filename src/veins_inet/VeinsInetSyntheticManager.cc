@@ -0,0 +1,284 @@
+// Moves vehicles on a built-in Manhattan grid in place of SUMO and the TraCI manager
+
+#include "veins_inet/VeinsInetSyntheticManager.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <deque>
+
+using namespace veins;
+
+Define_Module(VeinsInetSyntheticManager);
+
+VeinsInetSyntheticManager::~VeinsInetSyntheticManager()
+{
+    cancelAndDelete(stepMsg);
+}
+
+void VeinsInetSyntheticManager::initialize()
+{
+    numVehicles = par("numVehicles");
+    moduleType = par("moduleType").stdstringValue();
+    moduleName = par("moduleName").stdstringValue();
+    columns = par("gridColumns");
+    rows = par("gridRows");
+    spacing = par("gridSpacing");
+    originX = par("gridOriginX");
+    originY = par("gridOriginY");
+    minSpeed = par("minSpeed");
+    maxSpeed = par("maxSpeed");
+    updateInterval = par("updateInterval");
+    firstStepAt = par("firstStepAt");
+    spawnInterval = par("spawnInterval");
+
+    if (columns < 1 || columns > 26 || rows < 1 || columns * rows < 2) throw cRuntimeError("VeinsInetSyntheticManager: need 1..26 grid columns and at least 2 junctions, got %d x %d", columns, rows);
+    if (spacing <= 0) throw cRuntimeError("VeinsInetSyntheticManager: gridSpacing must be positive");
+    if (minSpeed < 0 || maxSpeed < minSpeed) throw cRuntimeError("VeinsInetSyntheticManager: need 0 <= minSpeed <= maxSpeed");
+    if (updateInterval <= 0) throw cRuntimeError("VeinsInetSyntheticManager: updateInterval must be positive");
+    if (!cModuleType::get(moduleType.c_str())) throw cRuntimeError("Module Type \"%s\" not found", moduleType.c_str());
+
+    spawner.configure(this);
+    vehicles.reserve(numVehicles);
+    stepMsg = new cMessage("syntheticStep");
+    scheduleAt(firstStepAt, stepMsg);
+}
+
+void VeinsInetSyntheticManager::handleMessage(cMessage* msg)
+{
+    if (msg != stepMsg) throw cRuntimeError("This module only handles its own step timer");
+
+    // Move the vehicles that were there at the last step, then add the ones due now
+    double dt = (simTime() - lastStep).dbl();
+    size_t numMoving = vehicles.size();
+    for (size_t i = 0; i < numMoving; i++) {
+        Vehicle& vehicle = vehicles[i];
+        moveVehicle(vehicle, dt);
+        spawner.updatePosition(vehicle.mod, position(vehicle), edgeName(vehicle.from, vehicle.to), vehicle.speedOverride >= 0 ? vehicle.speedOverride : vehicle.speed, heading(vehicle));
+        numUpdates++;
+    }
+    while ((int) vehicles.size() < numVehicles && firstStepAt + spawnInterval * (double) vehicles.size() <= simTime()) addVehicle();
+
+    lastStep = simTime();
+    scheduleAt(simTime() + updateInterval, stepMsg);
+}
+
+void VeinsInetSyntheticManager::finish()
+{
+    for (auto& vehicle : vehicles) deleteVehicle(vehicle);
+    vehicles.clear();
+    vehicleIndex.clear();
+
+    recordScalar("syntheticVehicles", numVehicles);
+    recordScalar("syntheticUpdates", numUpdates);
+    recordScalar("syntheticTargetChanges", numTargetChanges);
+}
+
+void VeinsInetSyntheticManager::changeTarget(cModule* mod, const std::string& edge)
+{
+    Vehicle* vehicle = findVehicle(mod);
+    if (!vehicle) return;
+    int targetFrom, targetTo;
+    std::vector<int> route;
+    if (!parseEdge(edge, targetFrom, targetTo) || !findRoute(vehicle->from, vehicle->to, targetFrom, targetTo, route)) {
+        EV_WARN << "SyntheticManager: " << vehicle->id << " cannot reach edge \"" << edge << "\" on the grid, target ignored" << endl;
+        return;
+    }
+    vehicle->route = std::move(route);
+    vehicle->routePos = 0;
+    vehicle->hasTarget = true;
+    numTargetChanges++;
+}
+
+void VeinsInetSyntheticManager::setSpeed(cModule* mod, double speed)
+{
+    if (Vehicle* vehicle = findVehicle(mod)) vehicle->speedOverride = speed < 0 ? -1 : speed;
+}
+
+int VeinsInetSyntheticManager::getRemainingRoadCount(cModule* mod) const
+{
+    const Vehicle* vehicle = findVehicle(mod);
+    if (!vehicle || !vehicle->hasTarget) return INT_MAX;
+    return 1 + (vehicle->route.size() - vehicle->routePos);
+}
+
+void VeinsInetSyntheticManager::addVehicle()
+{
+    int index = vehicles.size();
+    Vehicle vehicle;
+    vehicle.id = "syn" + std::to_string(index);
+    vehicle.from = intuniform(0, columns * rows - 1);
+    do {
+        vehicle.to = neighbor(vehicle.from, intuniform(EAST, SOUTH));
+    } while (vehicle.to < 0);
+    vehicle.offset = uniform(0, spacing);
+    vehicle.speed = uniform(minSpeed, maxSpeed);
+
+    // Known before initialization, so the vehicle's apps can already change its target or speed
+    cModule* mod = spawner.createHost(moduleType.c_str(), moduleName.c_str(), index);
+    vehicle.mod = mod;
+    vehicleIndex[mod->getId()] = vehicles.size();
+    vehicles.push_back(std::move(vehicle));
+
+    const Vehicle& added = vehicles.back();
+    spawner.initializeHost(mod, added.id, position(added), edgeName(added.from, added.to), added.speed, heading(added));
+}
+
+void VeinsInetSyntheticManager::moveVehicle(Vehicle& vehicle, double dt)
+{
+    vehicle.offset += (vehicle.speedOverride >= 0 ? vehicle.speedOverride : vehicle.speed) * dt;
+    while (vehicle.offset >= spacing) {
+        vehicle.offset -= spacing;
+        int next = nextJunction(vehicle);
+        vehicle.from = vehicle.to;
+        vehicle.to = next;
+    }
+}
+
+int VeinsInetSyntheticManager::nextJunction(Vehicle& vehicle)
+{
+    if (vehicle.hasTarget) {
+        if (vehicle.routePos < vehicle.route.size()) return vehicle.route[vehicle.routePos++];
+        // End of the target edge: SUMO would take the vehicle out, here it drives on at random
+        vehicle.hasTarget = false;
+        vehicle.route.clear();
+        vehicle.routePos = 0;
+    }
+
+    int candidates[4];
+    int numCandidates = 0;
+    for (int direction = EAST; direction <= SOUTH; direction++) {
+        int next = neighbor(vehicle.to, direction);
+        if (next >= 0 && next != vehicle.from) candidates[numCandidates++] = next;
+    }
+    // Turn back only at a dead end
+    if (numCandidates == 0) return vehicle.from;
+    return candidates[intuniform(0, numCandidates - 1)];
+}
+
+void VeinsInetSyntheticManager::deleteVehicle(Vehicle& vehicle)
+{
+    spawner.deleteHost(vehicle.mod);
+    vehicle.mod = nullptr;
+}
+
+VeinsInetSyntheticManager::Vehicle* VeinsInetSyntheticManager::findVehicle(cModule* mod)
+{
+    auto it = vehicleIndex.find(mod->getId());
+    return it == vehicleIndex.end() ? nullptr : &vehicles[it->second];
+}
+
+const VeinsInetSyntheticManager::Vehicle* VeinsInetSyntheticManager::findVehicle(cModule* mod) const
+{
+    auto it = vehicleIndex.find(mod->getId());
+    return it == vehicleIndex.end() ? nullptr : &vehicles[it->second];
+}
+
+int VeinsInetSyntheticManager::neighbor(int junction, int direction) const
+{
+    int column = junction / rows;
+    int row = junction % rows;
+    switch (direction) {
+    case EAST:
+        return column + 1 < columns ? this->junction(column + 1, row) : -1;
+    case NORTH:
+        return row + 1 < rows ? this->junction(column, row + 1) : -1;
+    case WEST:
+        return column > 0 ? this->junction(column - 1, row) : -1;
+    case SOUTH:
+        return row > 0 ? this->junction(column, row - 1) : -1;
+    }
+    return -1;
+}
+
+inet::Coord VeinsInetSyntheticManager::junctionPosition(int junction) const
+{
+    // Rows count upwards as in SUMO, OMNeT++ y downwards
+    return inet::Coord(originX + (junction / rows) * spacing, originY + (rows - 1 - junction % rows) * spacing);
+}
+
+std::string VeinsInetSyntheticManager::junctionName(int junction) const
+{
+    return std::string(1, (char) ('A' + junction / rows)) + std::to_string(junction % rows);
+}
+
+bool VeinsInetSyntheticManager::parseEdge(const std::string& edge, int& from, int& to) const
+{
+    // Two junction names, e.g. "B1B2"; anything else (SUMO-internal or other nets' edges) is not on the grid
+    int parsed[2];
+    size_t pos = 0;
+    for (int& junction : parsed) {
+        if (pos >= edge.size() || edge[pos] < 'A' || edge[pos] >= 'A' + columns) return false;
+        int column = edge[pos++] - 'A';
+        size_t digits = pos;
+        int row = 0;
+        while (pos < edge.size() && isdigit((unsigned char) edge[pos]) && row < rows) row = row * 10 + (edge[pos++] - '0');
+        if (pos == digits || row >= rows) return false;
+        junction = this->junction(column, row);
+    }
+    if (pos != edge.size()) return false;
+    from = parsed[0];
+    to = parsed[1];
+    for (int direction = EAST; direction <= SOUTH; direction++) {
+        if (neighbor(from, direction) == to) return true;
+    }
+    return false;
+}
+
+bool VeinsInetSyntheticManager::findRoute(int from, int to, int targetFrom, int targetTo, std::vector<int>& route) const
+{
+    // Breadth-first search over directed edges (state: junction * 4 + direction), so no path turns back
+    route.clear();
+    auto state = [this](int a, int b) {
+        for (int direction = EAST; direction <= SOUTH; direction++) {
+            if (neighbor(a, direction) == b) return a * 4 + direction;
+        }
+        return -1;
+    };
+    int start = state(from, to);
+    int goal = state(targetFrom, targetTo);
+    if (start < 0 || goal < 0) return false;
+    if (start == goal) return true;
+
+    std::vector<int> parent(columns * rows * 4, -1);
+    parent[start] = start;
+    std::deque<int> queue{start};
+    while (!queue.empty()) {
+        int current = queue.front();
+        queue.pop_front();
+        int tail = current / 4;
+        int head = neighbor(tail, current % 4);
+        int numNext = 0;
+        int next[4];
+        for (int direction = EAST; direction <= SOUTH; direction++) {
+            int junction = neighbor(head, direction);
+            if (junction >= 0 && junction != tail) next[numNext++] = head * 4 + direction;
+        }
+        if (numNext == 0) next[numNext++] = state(head, tail);
+        for (int i = 0; i < numNext; i++) {
+            if (parent[next[i]] >= 0) continue;
+            parent[next[i]] = current;
+            if (next[i] == goal) {
+                for (int s = goal; s != start; s = parent[s]) route.push_back(neighbor(s / 4, s % 4));
+                std::reverse(route.begin(), route.end());
+                return true;
+            }
+            queue.push_back(next[i]);
+        }
+    }
+    return false;
+}
+
+inet::Coord VeinsInetSyntheticManager::position(const Vehicle& vehicle) const
+{
+    inet::Coord a = junctionPosition(vehicle.from);
+    inet::Coord b = junctionPosition(vehicle.to);
+    return a + (b - a) * (vehicle.offset / spacing);
+}
+
+double VeinsInetSyntheticManager::heading(const Vehicle& vehicle) const
+{
+    // Veins heading: counterclockwise from east, in the OMNeT++ coordinate frame (y downwards)
+    inet::Coord d = junctionPosition(vehicle.to) - junctionPosition(vehicle.from);
+    return std::atan2(-d.y, d.x);
+}
@@ -0,0 +1,116 @@
+// Moves vehicles on a built-in Manhattan grid in place of SUMO and the TraCI manager
+
+#ifndef __VEINS_INET_SYNTHETICMANAGER_H_
+#define __VEINS_INET_SYNTHETICMANAGER_H_
+
+#include "veins_inet/veins_inet.h"
+#include "veins_inet/VeinsInetHostSpawner.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Creates numVehicles vehicle modules and moves them on a Manhattan grid,
+ * without SUMO.
+ *
+ * Vehicles get the same preInitializeModule() / updateModulePosition()
+ * calls as from the TraCI manager, one update of all vehicles per
+ * updateInterval. Their VeinsInetMobility modules forward changeTarget()
+ * and setSpeed() here, where they change the local route or speed.
+ */
+class VEINS_INET_API VeinsInetSyntheticManager : public cSimpleModule {
+public:
+    virtual ~VeinsInetSyntheticManager();
+
+    /** @brief route the vehicle along the shortest grid path to edge; unknown edges are ignored with a warning */
+    void changeTarget(cModule* mod, const std::string& edge);
+
+    /** @brief override the vehicle's speed in m/s; -1 restores its own speed */
+    void setSpeed(cModule* mod, double speed);
+
+    /** @brief edges left to the target, counting the current one; INT_MAX while driving at random */
+    int getRemainingRoadCount(cModule* mod) const;
+
+    /** @brief number of vehicles currently in the simulation */
+    size_t getManagedHostsCount() const { return vehicles.size(); }
+
+protected:
+    enum Direction {
+        EAST,
+        NORTH,
+        WEST,
+        SOUTH,
+    };
+
+    struct Vehicle {
+        cModule* mod;
+        std::string id;
+        int from;  // junctions of the current edge
+        int to;
+        double offset;  // m driven on the current edge
+        double speed;  // own speed, m/s
+        double speedOverride = -1;  // from setSpeed(); -1: none
+        std::vector<int> route;  // junctions to drive to after `to` (only while having a target)
+        size_t routePos = 0;
+        bool hasTarget = false;
+    };
+
+    int numVehicles = 0;
+    std::string moduleType;
+    std::string moduleName;
+    int columns = 0;
+    int rows = 0;
+    double spacing = 0;
+    double originX = 0;
+    double originY = 0;
+    double minSpeed = 0;
+    double maxSpeed = 0;
+    simtime_t updateInterval;
+    simtime_t firstStepAt;
+    simtime_t spawnInterval;
+
+    cMessage* stepMsg = nullptr;
+    simtime_t lastStep;
+    std::vector<Vehicle> vehicles;
+    std::unordered_map<int, size_t> vehicleIndex;  // by module id
+    VeinsInetHostSpawner spawner;
+    long numUpdates = 0;
+    long numTargetChanges = 0;
+
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage* msg) override;
+    virtual void finish() override;
+
+    void addVehicle();
+    void moveVehicle(Vehicle& vehicle, double dt);
+    int nextJunction(Vehicle& vehicle);
+    void deleteVehicle(Vehicle& vehicle);
+    Vehicle* findVehicle(cModule* mod);
+    const Vehicle* findVehicle(cModule* mod) const;
+
+    // Grid
+    int junction(int column, int row) const { return column * rows + row; }
+    int neighbor(int junction, int direction) const;  // -1 at the border
+    inet::Coord junctionPosition(int junction) const;
+    std::string junctionName(int junction) const;
+    std::string edgeName(int from, int to) const { return junctionName(from) + junctionName(to); }
+    bool parseEdge(const std::string& edge, int& from, int& to) const;
+    bool findRoute(int from, int to, int targetFrom, int targetTo, std::vector<int>& route) const;
+    inet::Coord position(const Vehicle& vehicle) const;
+    double heading(const Vehicle& vehicle) const;
+};
+
+class VEINS_INET_API VeinsInetSyntheticManagerAccess {
+public:
+    /** @brief the network's syntheticManager, or nullptr if vehicles come from SUMO or a trace */
+    VeinsInetSyntheticManager* get()
+    {
+        return dynamic_cast<VeinsInetSyntheticManager*>(getSimulation()->getSystemModule()->getSubmodule("syntheticManager"));
+    };
+};
+
+} // namespace veins
+
+#endif
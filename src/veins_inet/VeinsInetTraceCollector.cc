@@ -0,0 +1,81 @@
+// Network-wide trace collector: one trace file (or one per node type) for all apps
+
+#include "veins_inet/VeinsInetTraceCollector.h"
+
+using namespace veins;
+
+Define_Module(VeinsInetTraceCollector);
+
+VeinsInetTraceCollector::~VeinsInetTraceCollector()
+{
+    for (auto& entry : shards) closeShard(entry.second);
+}
+
+void VeinsInetTraceCollector::initialize()
+{
+    setup();
+}
+
+void VeinsInetTraceCollector::setup()
+{
+    if (ready) return;
+    ready = true;
+
+    // The result dir is created either way, also for a filePrefix inside it
+    std::string defaultPrefix = TraceSink::getResultPath(std::string(getEnvir()->getConfigEx()->getActiveConfigName()) + "_trace");
+    filePrefix = par("filePrefix").stdstringValue();
+    if (filePrefix.empty()) {
+        filePrefix = defaultPrefix;
+    }
+    shardByNodeType = par("shardByNodeType");
+    format = TraceSink::parseFormat(par("traceFormat"));
+    compression = TraceSink::parseCompression(par("traceCompression"));
+    compressionLevel = par("traceCompressionLevel");
+}
+
+void VeinsInetTraceCollector::handleMessage(cMessage* msg)
+{
+    throw cRuntimeError("This module does not handle messages");
+}
+
+TraceChannel* VeinsInetTraceCollector::acquire(const char* nodeType)
+{
+    // Apps declared before us in the network may call this before our initialize()
+    setup();
+
+    Shard& shard = shards[shardByNodeType ? nodeType : ""];
+    if (!shard.channel) {
+        std::string path = filePrefix;
+        if (shardByNodeType) path += std::string("_") + nodeType;
+        path += TraceSink::getFileExtension(format, compression);
+        shard.channel = TraceSink::getInstance().openChannel(path, TRACE_SCHEMA_SOC, format, compression, compressionLevel);
+    }
+    shard.users++;
+    return shard.channel;
+}
+
+void VeinsInetTraceCollector::release(TraceChannel* channel)
+{
+    for (auto& entry : shards) {
+        Shard& shard = entry.second;
+        if (shard.channel != channel) continue;
+        shard.users--;
+        if (finished && shard.users == 0) closeShard(shard);
+        return;
+    }
+}
+
+void VeinsInetTraceCollector::finish()
+{
+    finished = true;
+    for (auto& entry : shards) {
+        if (entry.second.users == 0) closeShard(entry.second);
+    }
+}
+
+void VeinsInetTraceCollector::closeShard(Shard& shard)
+{
+    if (!shard.channel) return;
+    TraceSink::getInstance().closeChannel(shard.channel);
+    shard.channel = nullptr;
+}
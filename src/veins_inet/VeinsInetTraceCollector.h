@@ -0,0 +1,67 @@
+// Network-wide trace collector: one trace file (or one per node type) for all apps
+
+#ifndef __VEINS_INET_TRACECOLLECTOR_H_
+#define __VEINS_INET_TRACECOLLECTOR_H_
+
+#include "veins_inet/veins_inet.h"
+#include "veins_inet/VeinsInetTraceSink.h"
+#include <map>
+#include <string>
+
+namespace veins {
+
+/**
+ * Owns the shared trace channels of all apps in the network.
+ *
+ * Apps acquire() a channel for their node type on startup and release()
+ * it when their own trace would have been closed. Channels are opened on
+ * the first acquire() and closed once the collector has finished and no
+ * app uses them any more, so apps of dynamic vehicles that finish after
+ * the collector can still log.
+ */
+class VEINS_INET_API VeinsInetTraceCollector : public cSimpleModule {
+protected:
+    struct Shard {
+        TraceChannel* channel = nullptr;
+        int users = 0;
+    };
+
+    std::string filePrefix;
+    bool shardByNodeType;
+    TraceFormat format;
+    TraceCompression compression;
+    int compressionLevel;
+    bool ready = false;
+    bool finished = false;
+    std::map<std::string, Shard> shards;   // by node type, or "" if not sharded
+
+public:
+    virtual ~VeinsInetTraceCollector();
+
+    /** @brief shared channel for rows of nodes of this type; throws if the file cannot be opened */
+    TraceChannel* acquire(const char* nodeType);
+
+    /** @brief the caller no longer logs to channel */
+    void release(TraceChannel* channel);
+
+protected:
+    virtual void initialize() override;
+    virtual void handleMessage(cMessage* msg) override;
+    virtual void finish() override;
+
+    void setup();
+    void closeShard(Shard& shard);
+};
+
+class VEINS_INET_API VeinsInetTraceCollectorAccess {
+public:
+    /** @brief the network's traceCollector, or nullptr if apps should write per-node files */
+    VeinsInetTraceCollector* get()
+    {
+        return dynamic_cast<VeinsInetTraceCollector*>(getSimulation()->getSystemModule()->getSubmodule("traceCollector"));
+    };
+};
+
+} // namespace veins
+
+#endif
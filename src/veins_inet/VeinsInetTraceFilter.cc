@@ -0,0 +1,108 @@
+// Per-module trace row filter: sampling, key events only, time window, per-second caps
+
+#include "veins_inet/VeinsInetTraceFilter.h"
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <string>
+
+using namespace veins;
+
+namespace {
+
+const char* const EVENT_CLASS_NAMES[TRACE_EVENT_NUM_CLASSES] = {"bsm", "attack", "charging", "tick", "other"};
+
+} // namespace
+
+TraceEventClass veins::getTraceEventClass(const EvPayload* payload)
+{
+    if (!payload) return TRACE_EVENT_OTHER;
+    switch (payload->getMessageType()) {
+        case EV_MSG_BSM: return TRACE_EVENT_BSM;
+        case EV_MSG_ATTACK: return TRACE_EVENT_ATTACK;
+        case EV_MSG_CHARGE_REQUEST:
+        case EV_MSG_CHARGE_RESPONSE:
+        case EV_MSG_CHARGE_DONE: return TRACE_EVENT_CHARGING;
+        default: return TRACE_EVENT_OTHER;
+    }
+}
+
+TraceFilter::TraceFilter()
+{
+    for (int i = 0; i < TRACE_EVENT_NUM_CLASSES; i++) {
+        sampleRate[i] = 1;
+        sampleCredit[i] = 0;
+        rowsPerSecond[i] = -1;
+        rowsThisSecond[i] = 0;
+    }
+}
+
+void TraceFilter::configure(cComponent* module)
+{
+    parseClassValues(module->par("traceSampleRates"), "traceSampleRates", sampleRate, 1);
+    parseClassValues(module->par("traceRowsPerSecond"), "traceRowsPerSecond", rowsPerSecond, HUGE_VAL);
+    keyEventsOnly = module->par("traceKeyEventsOnly");
+
+    simtime_t center = module->par("traceWindowCenter").doubleValue();
+    double before = module->par("traceWindowBefore");
+    double after = module->par("traceWindowAfter");
+    windowStart = before >= 0 ? center - before : SIMTIME_ZERO;
+    windowEnd = after >= 0 ? center + after : SimTime::getMaxTime();
+
+    enabled = keyEventsOnly || before >= 0 || after >= 0;
+    for (int i = 0; i < TRACE_EVENT_NUM_CLASSES; i++) {
+        enabled = enabled || sampleRate[i] < 1 || rowsPerSecond[i] >= 0;
+    }
+}
+
+bool TraceFilter::check(TraceEventClass eventClass)
+{
+    if (keyEventsOnly && eventClass != TRACE_EVENT_ATTACK && eventClass != TRACE_EVENT_CHARGING) return false;
+
+    simtime_t now = simTime();
+    if (now < windowStart || now > windowEnd) return false;
+
+    // Error diffusion: keep a row whenever the accumulated rate reaches one
+    if (sampleRate[eventClass] < 1) {
+        sampleCredit[eventClass] += sampleRate[eventClass];
+        if (sampleCredit[eventClass] < 1) return false;
+        sampleCredit[eventClass] -= 1;
+    }
+
+    if (rowsPerSecond[eventClass] >= 0) {
+        int64_t second = (int64_t) floor(now.dbl());
+        if (second != currentSecond) {
+            currentSecond = second;
+            for (auto& rows : rowsThisSecond) rows = 0;
+        }
+        if (rowsThisSecond[eventClass] >= rowsPerSecond[eventClass]) return false;
+        rowsThisSecond[eventClass]++;
+    }
+    return true;
+}
+
+void TraceFilter::parseClassValues(const char* spec, const char* parName, double* values, double max)
+{
+    // "bsm=0.1 tick=0.5": whitespace-separated class=value pairs
+    cStringTokenizer tokenizer(spec);
+    while (tokenizer.hasMoreTokens()) {
+        std::string token = tokenizer.nextToken();
+        size_t eq = token.find('=');
+        if (eq == std::string::npos)
+            throw cRuntimeError("%s: expected class=value, got \"%s\"", parName, token.c_str());
+        std::string name = token.substr(0, eq);
+        int eventClass = 0;
+        while (eventClass < TRACE_EVENT_NUM_CLASSES && name != EVENT_CLASS_NAMES[eventClass]) eventClass++;
+        if (eventClass == TRACE_EVENT_NUM_CLASSES)
+            throw cRuntimeError("%s: unknown event class \"%s\" (expected bsm, attack, charging, tick or other)", parName, name.c_str());
+        const char* number = token.c_str() + eq + 1;
+        char* end;
+        errno = 0;
+        double value = strtod(number, &end);
+        if (end == number || *end != '\0' || errno == ERANGE || std::isnan(value))
+            throw cRuntimeError("%s: expected a number after \"%s=\", got \"%s\"", parName, name.c_str(), token.c_str());
+        if (value < 0 || value > max)
+            throw cRuntimeError("%s: value of \"%s\" must be in [0, %g], got \"%s\"", parName, name.c_str(), max, token.c_str());
+        values[eventClass] = value;
+    }
+}
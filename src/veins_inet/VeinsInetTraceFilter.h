@@ -0,0 +1,74 @@
+// Per-module trace row filter: sampling, key events only, time window, per-second caps
+
+#ifndef __VEINS_INET_TRACEFILTER_H_
+#define __VEINS_INET_TRACEFILTER_H_
+
+#include "veins_inet/veins_inet.h"
+#include "veins_inet/ChargingProtocol_m.h"
+#include <cstdint>
+
+namespace veins {
+
+// What a trace row is about; the unit of the filter parameters
+enum TraceEventClass {
+    TRACE_EVENT_BSM,        // background BSM traffic ("bsm")
+    TRACE_EVENT_ATTACK,     // DoS attack packets ("attack")
+    TRACE_EVENT_CHARGING,   // charging protocol and battery state changes ("charging")
+    TRACE_EVENT_TICK,       // periodic state rows: ChargingTick, BatteryTick ("tick")
+    TRACE_EVENT_OTHER,      // packets without a known payload ("other")
+    TRACE_EVENT_NUM_CLASSES
+};
+
+/** @brief event class of a received packet with this payload (may be nullptr) */
+TraceEventClass getTraceEventClass(const EvPayload* payload);
+
+/**
+ * Decides per trace row whether it is written, before anything is
+ * formatted. Configured from the module parameters traceSampleRates,
+ * traceKeyEventsOnly, traceWindowCenter/Before/After and traceRowsPerSecond;
+ * with their defaults every row passes.
+ *
+ * Sampling is deterministic error diffusion (a rate of 0.25 keeps exactly
+ * every 4th row of the class), so it draws no random numbers and does not
+ * change the simulation's RNG streams.
+ */
+class VEINS_INET_API TraceFilter {
+protected:
+    bool enabled = false;                       // some rule is set
+    bool keyEventsOnly = false;
+    double sampleRate[TRACE_EVENT_NUM_CLASSES];
+    double sampleCredit[TRACE_EVENT_NUM_CLASSES];
+    simtime_t windowStart;
+    simtime_t windowEnd;
+    double rowsPerSecond[TRACE_EVENT_NUM_CLASSES];  // negative: no cap
+    long rowsThisSecond[TRACE_EVENT_NUM_CLASSES];
+    int64_t currentSecond = -1;
+    long rejected = 0;
+
+public:
+    TraceFilter();
+
+    /** @brief read the trace filter parameters of module */
+    void configure(cComponent* module);
+
+    /** @brief whether a row of this class, logged now, is written */
+    bool accept(TraceEventClass eventClass)
+    {
+        if (!enabled) return true;
+        if (check(eventClass)) return true;
+        rejected++;
+        return false;
+    }
+
+    /** @brief number of rows rejected so far */
+    long getNumRejected() const { return rejected; }
+
+protected:
+    bool check(TraceEventClass eventClass);
+    /** @brief parse "class=value ..." of parameter parName into values by event class; throws on a malformed token or a value outside [0, max] */
+    static void parseClassValues(const char* spec, const char* parName, double* values, double max);
+};
+
+} // namespace veins
+
+#endif
@@ -0,0 +1,110 @@
+// Fixed-size trace row shared by the trace sink, encoders and readers
+
+#ifndef __VEINS_INET_TRACERECORD_H_
+#define __VEINS_INET_TRACERECORD_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace veins {
+
+class TraceChannel;
+
+// Column set of a trace file: 21 columns, or 22 with soc (charging apps)
+enum TraceSchema {
+    TRACE_SCHEMA_BASE,
+    TRACE_SCHEMA_SOC,
+};
+
+// Encoding of a trace file
+enum TraceFormat {
+    TRACE_FORMAT_CSV,        // text, one row per line (.csv)
+    TRACE_FORMAT_COLUMNAR,   // typed row groups, see VeinsInetColumnarTraceFormat.h (.evtc)
+};
+
+// Stream compression of a CSV trace file
+enum TraceCompression {
+    TRACE_COMPRESSION_NONE,
+    TRACE_COMPRESSION_GZIP,   // zlib (.gz)
+    TRACE_COMPRESSION_ZSTD,   // libzstd (.zst); needs a build with WITH_ZSTD=1
+};
+
+// Header line of the shared 21-column EV/CS/RSU schema
+static const char* const TRACE_CSV_HEADER =
+    "timestamp,event_type,node_id,node_type,communication_type,"
+    "packet_size,inter_arrival_time,battery_level,"
+    "energy_consumption,source_address,target_address,"
+    "is_attacker,is_charging,"
+    "sequence_number,packet_name,"
+    "pos_x,pos_y,speed,"
+    "tx_duration_est,"
+    "cumulative_packets_sent,cumulative_packets_received\n";
+
+// Header line of the 22-column schema (charging apps, with soc)
+static const char* const TRACE_CSV_HEADER_SOC =
+    "timestamp,event_type,node_id,node_type,communication_type,"
+    "packet_size,inter_arrival_time,battery_level,"
+    "energy_consumption,source_address,target_address,"
+    "is_attacker,is_charging,"
+    "sequence_number,packet_name,"
+    "pos_x,pos_y,speed,"
+    "tx_duration_est,"
+    "cumulative_packets_sent,cumulative_packets_received,"
+    "soc\n";
+
+// Column flags of a TraceRecord
+enum TraceRecordFlags : uint16_t {
+    TRACE_HAS_SOC = 1 << 0,       // 22-column schema: append soc
+    TRACE_NO_BATTERY = 1 << 1,    // battery_level written as literal 0 (RSU), NaN in columnar traces
+    TRACE_NO_SPEED = 1 << 2,      // speed written as literal 0 (CS), NaN in columnar traces
+};
+
+/**
+ * One CSV row of the shared EV/CS/RSU schema, as plain fixed-size data.
+ *
+ * Apps fill a record in place in the sink's ring buffer; the writer thread
+ * turns it into text. Strings longer than their field are truncated.
+ */
+struct TraceRecord {
+    enum Kind : uint8_t { ROW, OPEN, CLOSE };
+
+    Kind kind;
+    uint16_t flags;
+    TraceChannel* channel;
+
+    double timestamp;
+    int32_t nodeId;
+    int32_t packetSize;
+    int32_t isCharging;           // 0/1 for EVs, number of charging EVs for a CS
+    int32_t sequenceNumber;
+    int32_t packetsSent;
+    int32_t packetsReceived;
+    bool isAttacker;
+    double interArrivalTime;
+    double battery;
+    double energy;
+    double posX;
+    double posY;
+    double speed;
+    double txDuration;
+    double soc;
+
+    char eventType[24];
+    char nodeType[8];
+    char commType[16];
+    char srcAddress[32];
+    char tgtAddress[32];
+    char packetName[48];
+
+    template <size_t N>
+    static void copy(char (&field)[N], const char* value)
+    {
+        size_t i = 0;
+        for (; i < N - 1 && value[i]; i++) field[i] = value[i];
+        field[i] = '\0';
+    }
+};
+
+} // namespace veins
+
+#endif
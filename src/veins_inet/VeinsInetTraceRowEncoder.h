@@ -0,0 +1,129 @@
+// CSV row encoder for trace records; header-only, no OMNeT++ dependency
+
+#ifndef __VEINS_INET_TRACEROWENCODER_H_
+#define __VEINS_INET_TRACEROWENCODER_H_
+
+#include "veins_inet/VeinsInetTraceRecord.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+namespace veins {
+
+/**
+ * Turns a TraceRecord into one CSV line in a caller-supplied char buffer,
+ * without locales, streams or heap allocation.
+ *
+ * Output is byte-identical to printf("%.6f") / printf("%d"): doubles whose
+ * rounding to 6 decimals is decided by plain integer arithmetic take the
+ * fast path; exact ties, NaN, infinities and magnitudes beyond 9e9 fall
+ * back to snprintf.
+ */
+class TraceRowEncoder {
+public:
+    // Upper bound of one encoded row (13 worst-case "%.6f" doubles plus strings)
+    static const size_t MAX_ROW_SIZE = 4608;
+
+    /** @brief write value as "%.6f" at p, return the end */
+    static char* putFixed6(char* p, double value)
+    {
+        bool negative = std::signbit(value);
+        double scaled = std::fabs(value) * 1e6;
+        if (scaled < 9e15) {
+            double whole = std::floor(scaled);
+            double fraction = scaled - whole;
+            // The product carries at most 2^-53 relative error; only round if that cannot flip the result
+            if (std::fabs(fraction - 0.5) > scaled * 2.3e-16) {
+                uint64_t units = (uint64_t) whole + (fraction > 0.5 ? 1 : 0);
+                if (negative) *p++ = '-';
+                p = putUnsigned(p, units / 1000000);
+                *p++ = '.';
+                uint32_t micros = units % 1000000;
+                for (int i = 5; i >= 0; i--) {
+                    p[i] = '0' + micros % 10;
+                    micros /= 10;
+                }
+                return p + 6;
+            }
+        }
+        return p + snprintf(p, MAX_ROW_SIZE, "%.6f", value);
+    }
+
+    /** @brief write value in decimal at p, return the end */
+    static char* putInt(char* p, long long value)
+    {
+        if (value < 0) {
+            *p++ = '-';
+            return putUnsigned(p, 0 - (unsigned long long) value);
+        }
+        return putUnsigned(p, value);
+    }
+
+    static char* putUnsigned(char* p, unsigned long long value)
+    {
+        char digits[20];
+        int n = 0;
+        do {
+            digits[n++] = '0' + value % 10;
+            value /= 10;
+        } while (value);
+        while (n) *p++ = digits[--n];
+        return p;
+    }
+
+    static char* putString(char* p, const char* s)
+    {
+        size_t length = strlen(s);
+        memcpy(p, s, length);
+        return p + length;
+    }
+
+    /**
+     * @brief encode r as one CSV line including '\n' into out (at least MAX_ROW_SIZE bytes); returns its length
+     *
+     * A SOC-schema row without TRACE_HAS_SOC gets an empty soc field.
+     */
+    static size_t encode(const TraceRecord& r, TraceSchema schema, char* out)
+    {
+        char* p = out;
+        p = putFixed6(p, r.timestamp); *p++ = ',';
+        p = putString(p, r.eventType); *p++ = ',';
+        p = putInt(p, r.nodeId); *p++ = ',';
+        p = putString(p, r.nodeType); *p++ = ',';
+        p = putString(p, r.commType); *p++ = ',';
+        p = putInt(p, r.packetSize); *p++ = ',';
+        p = putFixed6(p, r.interArrivalTime); *p++ = ',';
+        if (r.flags & TRACE_NO_BATTERY) *p++ = '0';
+        else p = putFixed6(p, r.battery);
+        *p++ = ',';
+        p = putFixed6(p, r.energy); *p++ = ',';
+        p = putString(p, r.srcAddress); *p++ = ',';
+        p = putString(p, r.tgtAddress); *p++ = ',';
+        *p++ = r.isAttacker ? '1' : '0'; *p++ = ',';
+        p = putInt(p, r.isCharging); *p++ = ',';
+        p = putInt(p, r.sequenceNumber); *p++ = ',';
+        p = putString(p, r.packetName); *p++ = ',';
+        p = putFixed6(p, r.posX); *p++ = ',';
+        p = putFixed6(p, r.posY); *p++ = ',';
+        if (r.flags & TRACE_NO_SPEED) *p++ = '0';
+        else p = putFixed6(p, r.speed);
+        *p++ = ',';
+        p = putFixed6(p, r.txDuration); *p++ = ',';
+        p = putInt(p, r.packetsSent); *p++ = ',';
+        p = putInt(p, r.packetsReceived);
+        if (r.flags & TRACE_HAS_SOC) {
+            *p++ = ',';
+            p = putFixed6(p, r.soc);
+        }
+        else if (schema == TRACE_SCHEMA_SOC) {
+            *p++ = ',';  // shared trace: no soc for this node
+        }
+        *p++ = '\n';
+        return p - out;
+    }
+};
+
+} // namespace veins
+
+#endif
@@ -0,0 +1,400 @@
+// Asynchronous trace writer shared by the EV, CS and RSU apps
+
+#include "veins_inet/VeinsInetTraceSink.h"
+#include "veins_inet/VeinsInetColumnarTraceWriter.h"
+#include "veins_inet/VeinsInetTraceRowEncoder.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <cerrno>
+#include <memory>
+#include <zlib.h>
+#ifdef WITH_ZSTD
+#include <zstd.h>
+#endif
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#define MKDIR(d) _mkdir(d)
+#else
+#define MKDIR(d) mkdir(d, 0755)
+#endif
+
+using namespace veins;
+
+Register_PerRunConfigOptionU(CFGID_TRACE_FLUSH_INTERVAL, "trace-flush-interval", "s", "1s", "Wall-clock interval after which buffered CSV trace rows are written to disk by the trace writer thread.");
+Register_PerRunConfigOption(CFGID_TRACE_RING_CAPACITY, "trace-ring-capacity", CFG_INT, "16384", "Number of trace rows buffered between the simulation and the trace writer thread (rounded up to a power of two). The simulation blocks while the buffer is full.");
+Register_PerRunConfigOption(CFGID_TRACE_ROW_GROUP_SIZE, "trace-row-group-size", CFG_INT, "16384", "Number of rows per row group in columnar (traceFormat=\"columnar\") trace files.");
+
+namespace veins {
+
+// Per-file state; owned by the writer thread between OPEN and CLOSE
+class TraceChannel {
+public:
+    FILE* file = nullptr;
+    std::string path;
+    TraceSchema schema = TRACE_SCHEMA_BASE;
+    std::string buffer;                            // CSV text not yet written
+    std::unique_ptr<ColumnarTraceWriter> columnar; // columnar channels only
+    TraceCompression compression = TRACE_COMPRESSION_NONE;
+    z_stream gzip;                                 // TRACE_COMPRESSION_GZIP
+#ifdef WITH_ZSTD
+    ZSTD_CCtx* zstd = nullptr;                     // TRACE_COMPRESSION_ZSTD
+#endif
+    std::vector<char> compressed;                  // encoder output block
+    bool unflushed = false;                        // compressor holds data of an open block
+    bool failed = false;                           // a write, flush or close failed; reported by closeChannel()
+    bool closed = false;  // set by the writer under TraceSink::mutex
+};
+
+} // namespace veins
+
+namespace {
+
+const size_t WRITE_BLOCK_SIZE = 256 * 1024;
+const auto IDLE_POLL_INTERVAL = std::chrono::milliseconds(5);
+
+// How far writeOut() pushes data through the compressor
+enum WriteMode {
+    WRITE_BLOCK,    // compressor may keep a partial block
+    WRITE_FLUSH,    // end the current compressed block
+    WRITE_FINISH,   // end the compressed stream (close)
+};
+
+bool openCompressor(TraceChannel* channel, TraceCompression compression, int level)
+{
+    channel->compression = compression;
+    switch (compression) {
+        case TRACE_COMPRESSION_NONE:
+            return true;
+        case TRACE_COMPRESSION_GZIP:
+            memset(&channel->gzip, 0, sizeof(channel->gzip));
+            // windowBits 15 + 16 selects the gzip container
+            if (deflateInit2(&channel->gzip, level > 0 ? std::min(level, 9) : Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) return false;
+            break;
+        case TRACE_COMPRESSION_ZSTD:
+#ifdef WITH_ZSTD
+            channel->zstd = ZSTD_createCCtx();
+            if (!channel->zstd) return false;
+            ZSTD_CCtx_setParameter(channel->zstd, ZSTD_c_compressionLevel, level > 0 ? level : ZSTD_CLEVEL_DEFAULT);
+            break;
+#else
+            return false;
+#endif
+    }
+    channel->compressed.resize(WRITE_BLOCK_SIZE / 4);
+    return true;
+}
+
+void closeCompressor(TraceChannel* channel)
+{
+    if (channel->compression == TRACE_COMPRESSION_GZIP) deflateEnd(&channel->gzip);
+#ifdef WITH_ZSTD
+    if (channel->compression == TRACE_COMPRESSION_ZSTD) ZSTD_freeCCtx(channel->zstd);
+#endif
+}
+
+void writeBytes(TraceChannel* channel, const void* data, size_t size)
+{
+    if (fwrite(data, 1, size, channel->file) != size) channel->failed = true;
+}
+
+void deflateOut(TraceChannel* channel, WriteMode mode)
+{
+    z_stream& z = channel->gzip;
+    z.next_in = reinterpret_cast<Bytef*>(&channel->buffer[0]);
+    z.avail_in = channel->buffer.size();
+    int flush = mode == WRITE_FINISH ? Z_FINISH : mode == WRITE_FLUSH ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+    do {
+        z.next_out = reinterpret_cast<Bytef*>(channel->compressed.data());
+        z.avail_out = channel->compressed.size();
+        if (deflate(&z, flush) == Z_STREAM_ERROR) {
+            channel->failed = true;
+            break;
+        }
+        writeBytes(channel, channel->compressed.data(), channel->compressed.size() - z.avail_out);
+    } while (z.avail_out == 0);
+}
+
+#ifdef WITH_ZSTD
+void zstdOut(TraceChannel* channel, WriteMode mode)
+{
+    ZSTD_inBuffer in = {channel->buffer.data(), channel->buffer.size(), 0};
+    ZSTD_EndDirective directive = mode == WRITE_FINISH ? ZSTD_e_end : mode == WRITE_FLUSH ? ZSTD_e_flush : ZSTD_e_continue;
+    size_t remaining;
+    do {
+        ZSTD_outBuffer out = {channel->compressed.data(), channel->compressed.size(), 0};
+        remaining = ZSTD_compressStream2(channel->zstd, &out, &in, directive);
+        if (ZSTD_isError(remaining)) {
+            channel->failed = true;
+            break;
+        }
+        writeBytes(channel, channel->compressed.data(), out.pos);
+    } while (directive == ZSTD_e_continue ? in.pos < in.size : remaining != 0);
+}
+#endif
+
+void writeOut(TraceChannel* channel, WriteMode mode)
+{
+    if (channel->compression == TRACE_COMPRESSION_NONE) {
+        if (channel->buffer.empty()) return;
+        writeBytes(channel, channel->buffer.data(), channel->buffer.size());
+    }
+    else {
+        // Idle channels must not emit an empty block on every periodic flush
+        if (channel->buffer.empty() && mode != WRITE_FINISH && (mode == WRITE_BLOCK || !channel->unflushed)) return;
+        if (channel->compression == TRACE_COMPRESSION_GZIP) deflateOut(channel, mode);
+#ifdef WITH_ZSTD
+        if (channel->compression == TRACE_COMPRESSION_ZSTD) zstdOut(channel, mode);
+#endif
+        channel->unflushed = mode == WRITE_BLOCK;
+    }
+    if (fflush(channel->file) != 0) channel->failed = true;
+    channel->buffer.clear();
+}
+
+} // namespace
+
+// ============================================================
+// Producer side (simulation thread)
+// ============================================================
+
+TraceSink& TraceSink::getInstance()
+{
+    static TraceSink instance;
+    return instance;
+}
+
+TraceSink::~TraceSink()
+{
+    if (writer.joinable()) stop();
+}
+
+TraceFormat TraceSink::parseFormat(const char* name)
+{
+    if (strcmp(name, "csv") == 0) return TRACE_FORMAT_CSV;
+    if (strcmp(name, "columnar") == 0) return TRACE_FORMAT_COLUMNAR;
+    throw cRuntimeError("Unknown trace format \"%s\" (expected \"csv\" or \"columnar\")", name);
+}
+
+TraceCompression TraceSink::parseCompression(const char* name)
+{
+    if (strcmp(name, "none") == 0) return TRACE_COMPRESSION_NONE;
+    if (strcmp(name, "gzip") == 0) return TRACE_COMPRESSION_GZIP;
+    if (strcmp(name, "zstd") == 0) {
+#ifdef WITH_ZSTD
+        return TRACE_COMPRESSION_ZSTD;
+#else
+        throw cRuntimeError("Trace compression \"zstd\" needs a build with WITH_ZSTD=1 (use \"gzip\" instead)");
+#endif
+    }
+    throw cRuntimeError("Unknown trace compression \"%s\" (expected \"none\", \"gzip\" or \"zstd\")", name);
+}
+
+std::string TraceSink::getResultPath(const std::string& name)
+{
+    std::string dir = getEnvir()->getConfigEx()->getVariable(CFGVAR_RESULTDIR);
+    if (dir.empty()) dir = ".";
+
+    // Create each missing component; a run farm nests result dirs per sweep and run
+    for (size_t slash = dir.find_first_of("/\\", 1); ; slash = dir.find_first_of("/\\", slash + 1)) {
+        std::string prefix = dir.substr(0, slash);
+        struct stat st;
+        if (stat(prefix.c_str(), &st) != 0) MKDIR(prefix.c_str());
+        if (slash == std::string::npos) break;
+    }
+    return dir + "/" + name;
+}
+
+const char* TraceSink::getFileExtension(TraceFormat format, TraceCompression compression)
+{
+    if (format == TRACE_FORMAT_COLUMNAR) return ".evtc";
+    switch (compression) {
+        case TRACE_COMPRESSION_GZIP: return ".csv.gz";
+        case TRACE_COMPRESSION_ZSTD: return ".csv.zst";
+        default: return ".csv";
+    }
+}
+
+TraceChannel* TraceSink::openChannel(const std::string& path, TraceSchema schema, TraceFormat format,
+                                     TraceCompression compression, int level)
+{
+    if (format == TRACE_FORMAT_COLUMNAR && compression != TRACE_COMPRESSION_NONE)
+        throw cRuntimeError("Trace compression is only supported for csv traces (%s)", path.c_str());
+
+    FILE* file = fopen(path.c_str(), format == TRACE_FORMAT_COLUMNAR || compression != TRACE_COMPRESSION_NONE ? "wb" : "w");
+    if (!file) throw cRuntimeError("Cannot open trace file %s: %s", path.c_str(), strerror(errno));
+
+    auto channel = new TraceChannel();
+    channel->file = file;
+    channel->path = path;
+    channel->schema = schema;
+    if (!openCompressor(channel, compression, level)) {
+        fclose(file);
+        delete channel;
+        throw cRuntimeError("Cannot set up the compressor of trace file %s", path.c_str());
+    }
+
+    if (openChannels++ == 0) start();
+
+    if (format == TRACE_FORMAT_COLUMNAR) {
+        channel->columnar.reset(new ColumnarTraceWriter(schema, rowGroupSize));
+        if (!channel->columnar->writeFileHeader(file)) channel->failed = true;
+    }
+    else {
+        // Goes through the compressor with the first rows
+        channel->buffer = schema == TRACE_SCHEMA_SOC ? TRACE_CSV_HEADER_SOC : TRACE_CSV_HEADER;
+    }
+    TraceRecord& r = reserve();
+    r.kind = TraceRecord::OPEN;
+    r.channel = channel;
+    publish();
+    return channel;
+}
+
+void TraceSink::closeChannel(TraceChannel* channel)
+{
+    TraceRecord& r = reserve();
+    r.kind = TraceRecord::CLOSE;
+    r.channel = channel;
+    publish();
+    wakeWriter();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        channelClosed.wait(lock, [channel] { return channel->closed; });
+    }
+    // The writer thread cannot throw into the simulation; its errors surface here
+    bool failed = channel->failed;
+    std::string path = channel->path;
+    delete channel;
+
+    if (--openChannels == 0) stop();
+    if (failed) throw cRuntimeError("Error writing trace file %s (disk full?); the trace is incomplete", path.c_str());
+}
+
+TraceRecord& TraceSink::beginRecord(TraceChannel* channel)
+{
+    TraceRecord& r = reserve();
+    r.kind = TraceRecord::ROW;
+    r.channel = channel;
+    r.flags = 0;
+    return r;
+}
+
+void TraceSink::commitRecord()
+{
+    publish();
+}
+
+TraceRecord& TraceSink::reserve()
+{
+    size_t h = head.load(std::memory_order_relaxed);
+    while (h - tail.load(std::memory_order_acquire) >= ring.size()) {
+        wakeWriter();
+        std::this_thread::yield();
+    }
+    return ring[h & mask];
+}
+
+void TraceSink::publish()
+{
+    size_t h = head.load(std::memory_order_relaxed) + 1;
+    head.store(h, std::memory_order_release);
+    // Only wake the writer when it falls behind; otherwise it polls
+    if (h - tail.load(std::memory_order_relaxed) == ring.size() / 2) wakeWriter();
+}
+
+void TraceSink::wakeWriter()
+{
+    // Taking the lock orders our head update before the writer's predicate check
+    { std::lock_guard<std::mutex> lock(mutex); }
+    writerWakeup.notify_one();
+}
+
+void TraceSink::start()
+{
+    cConfiguration* config = getEnvir()->getConfig();
+    flushInterval = config->getAsDouble(CFGID_TRACE_FLUSH_INTERVAL);
+    rowGroupSize = std::max<long>(1, config->getAsInt(CFGID_TRACE_ROW_GROUP_SIZE));
+    size_t capacity = 1;
+    while (capacity < (size_t) std::max<long>(2, config->getAsInt(CFGID_TRACE_RING_CAPACITY))) capacity <<= 1;
+
+    ring.assign(capacity, TraceRecord());
+    mask = capacity - 1;
+    head.store(0);
+    tail.store(0);
+    stopping.store(false);
+    writer = std::thread(&TraceSink::run, this);
+}
+
+void TraceSink::stop()
+{
+    stopping.store(true, std::memory_order_release);
+    wakeWriter();
+    writer.join();
+}
+
+// ============================================================
+// Writer thread
+// ============================================================
+
+void TraceSink::run()
+{
+    using clock = std::chrono::steady_clock;
+    const auto interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(flushInterval));
+    auto nextFlush = clock::now() + interval;
+    std::vector<TraceChannel*> active;
+    char line[TraceRowEncoder::MAX_ROW_SIZE];
+
+    while (true) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        size_t h = head.load(std::memory_order_acquire);
+
+        for (; t != h; t++) {
+            const TraceRecord& r = ring[t & mask];
+            TraceChannel* channel = r.channel;
+            switch (r.kind) {
+                case TraceRecord::ROW:
+                    if (channel->columnar) {
+                        channel->columnar->append(r);
+                        if (channel->columnar->isFull() && !channel->columnar->writeRowGroup(channel->file)) channel->failed = true;
+                    }
+                    else {
+                        channel->buffer.append(line, TraceRowEncoder::encode(r, channel->schema, line));
+                        if (channel->buffer.size() >= WRITE_BLOCK_SIZE) writeOut(channel, WRITE_BLOCK);
+                    }
+                    break;
+                case TraceRecord::OPEN:
+                    active.push_back(channel);
+                    break;
+                case TraceRecord::CLOSE:
+                    if (channel->columnar && !channel->columnar->writeRowGroup(channel->file)) channel->failed = true;
+                    writeOut(channel, WRITE_FINISH);
+                    closeCompressor(channel);
+                    if (fclose(channel->file) != 0) channel->failed = true;
+                    active.erase(std::remove(active.begin(), active.end(), channel), active.end());
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        channel->closed = true;
+                    }
+                    channelClosed.notify_all();
+                    break;
+            }
+        }
+        tail.store(t, std::memory_order_release);
+
+        if (clock::now() >= nextFlush) {
+            for (auto channel : active) writeOut(channel, WRITE_FLUSH);
+            nextFlush = clock::now() + interval;
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        if (head.load(std::memory_order_acquire) != t) continue;
+        if (stopping.load(std::memory_order_acquire)) break;
+        writerWakeup.wait_for(lock, IDLE_POLL_INTERVAL);
+    }
+
+    for (auto channel : active) writeOut(channel, WRITE_FLUSH);
+}
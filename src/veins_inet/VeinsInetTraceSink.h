@@ -0,0 +1,104 @@
+// Asynchronous trace writer shared by the EV, CS and RSU apps
+
+#ifndef __VEINS_INET_TRACESINK_H_
+#define __VEINS_INET_TRACESINK_H_
+
+#include "veins_inet/veins_inet.h"
+#include "veins_inet/VeinsInetTraceRecord.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace veins {
+
+class TraceChannel;
+
+/**
+ * Process-wide trace writer.
+ *
+ * The simulation thread is the only producer: rows go into a lock-free
+ * single-producer/single-consumer ring of TraceRecords. A background
+ * thread formats them into per-channel (per-file) buffers and writes them
+ * in large blocks, or after trace-flush-interval of wall-clock time.
+ * closeChannel() blocks until all rows of that channel are on disk, so
+ * calling it from finish() drains the channel cleanly.
+ *
+ * Channels are CSV text or columnar row groups (ColumnarTraceWriter);
+ * columnar channels are written whenever a row group is full. CSV channels
+ * can be gzip- or zstd-compressed; compression runs on the writer thread
+ * and every periodic flush ends a compressed block, so a trace that is
+ * still being written can be read up to its last flush.
+ *
+ * The ring size, flush interval and row group size are read from the
+ * per-run options trace-ring-capacity, trace-flush-interval and
+ * trace-row-group-size when the writer starts.
+ */
+class VEINS_INET_API TraceSink {
+public:
+    static TraceSink& getInstance();
+
+    /** @brief parse a traceFormat module parameter ("csv" or "columnar") */
+    static TraceFormat parseFormat(const char* name);
+
+    /** @brief parse a traceCompression module parameter ("none", "gzip" or "zstd") */
+    static TraceCompression parseCompression(const char* name);
+
+    /**
+     * @brief path of trace file name in the run's result-dir ("results" unless configured otherwise)
+     *
+     * Creates the directory, since apps open their traces before OMNeT++ creates it.
+     */
+    static std::string getResultPath(const std::string& name);
+
+    /** @brief file name extension including the dot (".csv", ".csv.gz", ".csv.zst", ".evtc") */
+    static const char* getFileExtension(TraceFormat format, TraceCompression compression = TRACE_COMPRESSION_NONE);
+
+    /**
+     * @brief create (truncate) the file at path, write the schema header and return its channel; throws if the file cannot be opened
+     *
+     * level is the gzip (1-9) or zstd (1-19) compression level; 0 selects the library default.
+     */
+    TraceChannel* openChannel(const std::string& path, TraceSchema schema, TraceFormat format = TRACE_FORMAT_CSV,
+                              TraceCompression compression = TRACE_COMPRESSION_NONE, int level = 0);
+
+    /** @brief write out all pending rows of channel, close its file and invalidate it; throws if a write to the file failed */
+    void closeChannel(TraceChannel* channel);
+
+    /** @brief reserve the next ring slot for a row of channel; blocks while the ring is full */
+    TraceRecord& beginRecord(TraceChannel* channel);
+
+    /** @brief publish the slot returned by beginRecord() to the writer thread */
+    void commitRecord();
+
+protected:
+    TraceSink() = default;
+    ~TraceSink();
+
+    void start();
+    void stop();
+    void run();
+    TraceRecord& reserve();
+    void publish();
+    void wakeWriter();
+
+    std::vector<TraceRecord> ring;
+    size_t mask = 0;
+    std::atomic<size_t> head{0};  // next slot to write (producer)
+    std::atomic<size_t> tail{0};  // next slot to read (writer)
+
+    std::thread writer;
+    std::atomic<bool> stopping{false};
+    std::mutex mutex;
+    std::condition_variable writerWakeup;
+    std::condition_variable channelClosed;
+    double flushInterval = 1.0;
+    size_t rowGroupSize = 16384;
+    int openChannels = 0;
+};
+
+} // namespace veins
+
+#endif
@@ -0,0 +1,96 @@
+// Coalescing queue of TraCI vehicle commands, sent pipelined once per step
+
+#include "veins_inet/VeinsInetVehicleCommandQueue.h"
+#include "veins/modules/mobility/traci/TraCIBuffer.h"
+#include "veins/modules/mobility/traci/TraCIConstants.h"
+
+using namespace veins;
+using namespace veins::TraCIConstants;
+
+void VehicleCommandQueue::changeTarget(int moduleId, const std::string& vehicleId, const std::string& edge)
+{
+    put(moduleId, vehicleId, CHANGE_TARGET, (TraCIBuffer() << CMD_CHANGETARGET << vehicleId << TYPE_STRING << edge).str());
+}
+
+void VehicleCommandQueue::setSpeed(int moduleId, const std::string& vehicleId, double speed)
+{
+    put(moduleId, vehicleId, SET_SPEED, (TraCIBuffer() << VAR_SPEED << vehicleId << TYPE_DOUBLE << speed).str());
+}
+
+void VehicleCommandQueue::setColor(int moduleId, const std::string& vehicleId, const TraCIColor& color)
+{
+    TraCIBuffer buf;
+    buf << VAR_COLOR << vehicleId << TYPE_COLOR << color.red << color.green << color.blue << color.alpha;
+    put(moduleId, vehicleId, SET_COLOR, buf.str());
+}
+
+void VehicleCommandQueue::put(int moduleId, const std::string& vehicleId, Kind kind, std::string command)
+{
+    auto it = vehicles.find(moduleId);
+    if (it == vehicles.end()) {
+        it = vehicles.emplace(moduleId, Vehicle()).first;
+        it->second.vehicleId = vehicleId;
+        order.push_back(moduleId);
+    }
+    std::string& slot = it->second.commands[kind];
+    if (slot.empty()) numPending++;
+    slot = std::move(command);  // replaces an earlier command of the same kind
+    numQueued++;
+}
+
+void VehicleCommandQueue::remove(int moduleId)
+{
+    auto it = vehicles.find(moduleId);
+    if (it == vehicles.end()) return;
+    for (auto& command : it->second.commands) {
+        if (!command.empty()) numPending--;
+    }
+    vehicles.erase(it);  // its id stays in order; flush() skips it
+}
+
+void VehicleCommandQueue::flush(TraCIConnection& connection)
+{
+    if (numPending == 0) {
+        order.clear();
+        return;
+    }
+
+    // All commands in one message; SUMO answers with one status response per command, in order
+    std::string message;
+    std::vector<const std::string*> senders;
+    for (int moduleId : order) {
+        auto it = vehicles.find(moduleId);
+        if (it == vehicles.end()) continue;
+        for (auto& command : it->second.commands) {
+            if (command.empty()) continue;
+            message += makeTraCICommand(CMD_SET_VEHICLE_VARIABLE, TraCIBuffer(command));
+            senders.push_back(&it->second.vehicleId);
+        }
+    }
+
+    connection.sendMessage(message);
+    TraCIBuffer response(connection.receiveMessage());
+    for (const std::string* vehicleId : senders) {
+        uint8_t cmdLength;
+        response >> cmdLength;
+        if (cmdLength == 0) {
+            uint32_t cmdLengthExt;
+            response >> cmdLengthExt;
+        }
+        uint8_t commandResp;
+        response >> commandResp;
+        uint8_t result;
+        response >> result;
+        std::string description;
+        response >> description;
+        if (commandResp != CMD_SET_VEHICLE_VARIABLE || result != RTYPE_OK) {
+            throw cRuntimeError("TraCI server rejected a queued command for vehicle %s: \"%s\"", vehicleId->c_str(), description.c_str());
+        }
+    }
+    numSent += senders.size();
+    numMessages++;
+
+    order.clear();
+    vehicles.clear();
+    numPending = 0;
+}
@@ -0,0 +1,67 @@
+// Coalescing queue of TraCI vehicle commands, sent pipelined once per step
+
+#ifndef __VEINS_INET_VEHICLECOMMANDQUEUE_H_
+#define __VEINS_INET_VEHICLECOMMANDQUEUE_H_
+
+#include "veins_inet/veins_inet.h"
+#include "veins/modules/mobility/traci/TraCIColor.h"
+#include "veins/modules/mobility/traci/TraCIConnection.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace veins {
+
+/**
+ * Vehicle state commands (new target, speed, color) collected during a
+ * simulation step.
+ *
+ * Only the last command of each kind per vehicle is kept, so e.g. several
+ * changeTarget calls of an app within one step reach SUMO as one. flush()
+ * sends all of them in a single TraCI message and reads the single
+ * answer, instead of one blocking round trip per command; the manager
+ * calls it right before the next simulationStep.
+ */
+class VEINS_INET_API VehicleCommandQueue {
+public:
+    void changeTarget(int moduleId, const std::string& vehicleId, const std::string& edge);
+    void setSpeed(int moduleId, const std::string& vehicleId, double speed);
+    void setColor(int moduleId, const std::string& vehicleId, const TraCIColor& color);
+
+    /** @brief drop the queued commands of a vehicle that left the simulation */
+    void remove(int moduleId);
+
+    bool empty() const { return numPending == 0; }
+
+    /** @brief send all queued commands in one message; throws if SUMO rejects one of them */
+    void flush(TraCIConnection& connection);
+
+    long getNumQueued() const { return numQueued; }      // commands issued by modules
+    long getNumSent() const { return numSent; }          // commands sent after coalescing
+    long getNumMessages() const { return numMessages; }  // TraCI round trips for them
+
+protected:
+    enum Kind {
+        CHANGE_TARGET,
+        SET_SPEED,
+        SET_COLOR,
+        NUM_KINDS
+    };
+    struct Vehicle {
+        std::string vehicleId;
+        std::string commands[NUM_KINDS];  // CMD_SET_VEHICLE_VARIABLE content; empty: none
+    };
+
+    std::vector<int> order;  // module ids, in order of their first command since the last flush
+    std::unordered_map<int, Vehicle> vehicles;
+    size_t numPending = 0;
+    long numQueued = 0;
+    long numSent = 0;
+    long numMessages = 0;
+
+    void put(int moduleId, const std::string& vehicleId, Kind kind, std::string command);
+};
+
+} // namespace veins
+
+#endif